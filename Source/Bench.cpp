@@ -0,0 +1,333 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "DirectoryReader.h"
+#include "EntryTable.h"
+#include "Listing.h"
+#include "Output.h"
+#include "RecordFormat.h"
+#include "TreeGenerator.h"
+#include "Walk.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+// Measures the stages of a listing one at a time over a tree.
+//
+//  ls_bench gen <wide|deep|mixed> <count> <dir> [seed]
+//  ls_bench run <dir> [repeat]
+//
+// Both write a single JSON object to standard output, so results from
+// two commits can be compared directly. Each stage reports the best
+// time of all repeats.
+
+enum BenchStage
+{
+    BS_ENUMERATE = 0,
+    BS_FILTER,
+    BS_SORT,
+    BS_COLUMNS,
+    BS_FORMAT,
+    BS_OUTPUT,
+    BS_MAX
+};
+
+const char* const StageNames[BS_MAX] = {
+    "enumerate",
+    "filter",
+    "sort",
+    "columns",
+    "format",
+    "output",
+};
+
+struct StageResult
+{
+    double   seconds;
+    uint64_t items;
+    uint64_t bytes;
+};
+
+typedef chrono::steady_clock clock_type;
+
+static double elapsed(clock_type::time_point from, clock_type::time_point to)
+{
+    return chrono::duration<double>(to - from).count();
+}
+
+static void usage()
+{
+    fputs("usage:\n", stderr);
+    fputs("    ls_bench gen <wide|deep|mixed> <count> <dir> [seed]\n", stderr);
+    fputs("    ls_bench run <dir> [repeat]\n", stderr);
+    exit(1);
+}
+
+static void appendJsonString(string& dest, const string& str)
+{
+    Output out(dest);
+    out.put('"');
+    writeJsonString(out, str.data(), str.size());
+    out.put('"');
+}
+
+static void appendf(string& dest, const char* fmt, double val)
+{
+    char buf[64];
+    int  len = snprintf(buf, sizeof buf, fmt, val);
+    if (len > 0)
+        dest.append(buf, (size_t)len);
+}
+
+// Runs every stage over one pass of the tree, adding to results.
+static void benchPass(const string& root, const Options& opts, StageResult* results)
+{
+    unique_ptr<DirectoryReader> reader(DirectoryReader::create());
+
+    string           text, scratch;
+    Output           formatted(text);
+    Output           out;
+    EntryTable       all;
+    DirectoryListing listing;
+    DirEntry         ent = {};
+    vector<string>   pending;
+
+    pending.push_back(string());
+    while (!pending.empty())
+    {
+        string subDir = std::move(pending.back());
+        pending.pop_back();
+
+        string path;
+        combinePath(path, root, subDir, "");
+
+        clock_type::time_point t0 = clock_type::now();
+
+        all.clear();
+        if (reader->open(path.c_str(), EM_FULL))
+        {
+            while (reader->next(ent))
+            {
+                if (isDotEntry(ent.name))
+                    continue;
+                all.add(ent);
+            }
+            reader->close();
+        }
+
+        clock_type::time_point t1 = clock_type::now();
+
+        listing.subDir = subDir;
+        listing.entries.clear();
+        listing.dirs.clear();
+        for (size_t i = 0; i < all.size(); ++i)
+        {
+            all.get((uint32_t)i, ent);
+            if (shouldDescend(ent, opts))
+                listing.dirs.push_back(string(ent.name, ent.nameLen));
+            if (shouldBeIncluded(ent, opts))
+                listing.entries.add(ent);
+        }
+
+        clock_type::time_point t2 = clock_type::now();
+
+        sortEntries(listing.entries, sortOptions(opts));
+
+        clock_type::time_point t3 = clock_type::now();
+
+        ColumnLayout layout;
+        calculateColumns(layout, listing.entries, opts);
+
+        clock_type::time_point t4 = clock_type::now();
+
+        ListReport         totals = {};
+        const EntryTable&  table  = listing.entries;
+        for (size_t i = 0; i < table.size(); ++i)
+        {
+            table.get(table.at(i), ent);
+            writeEntry(formatted, subDir, ent, opts, totals, scratch);
+        }
+        formatted.flush();
+
+        clock_type::time_point t5 = clock_type::now();
+
+        uint64_t before = out.bytesWritten();
+        writeDirectory(out, listing, opts, nullptr);
+        out.flush();
+
+        clock_type::time_point t6 = clock_type::now();
+
+        results[BS_ENUMERATE].seconds += elapsed(t0, t1);
+        results[BS_ENUMERATE].items += all.size();
+        results[BS_FILTER].seconds += elapsed(t1, t2);
+        results[BS_FILTER].items += all.size();
+        results[BS_SORT].seconds += elapsed(t2, t3);
+        results[BS_SORT].items += table.size();
+        results[BS_COLUMNS].seconds += elapsed(t3, t4);
+        results[BS_COLUMNS].items += table.size();
+        results[BS_FORMAT].seconds += elapsed(t4, t5);
+        results[BS_FORMAT].items += table.size();
+        results[BS_FORMAT].bytes += text.size();
+        results[BS_OUTPUT].seconds += elapsed(t5, t6);
+        results[BS_OUTPUT].items += table.size();
+        results[BS_OUTPUT].bytes += out.bytesWritten() - before;
+        text.clear();
+
+        for (size_t i = listing.dirs.size(); i-- > 0;)
+        {
+            string sub;
+            combinePath(sub, subDir, listing.dirs[i], "");
+            pending.push_back(std::move(sub));
+        }
+    }
+}
+
+static int runBench(const string& root, int repeat)
+{
+    Options opts    = {};
+    opts.list       = true;
+    opts.all        = true;
+    opts.sortKey    = SK_NAME;
+    opts.hasSortKey = true;
+    opts.winWidth   = 100;
+
+    StageResult best[BS_MAX] = {};
+
+    // Everything the stages write goes to /dev/null; the
+    // report goes to the real standard output afterwards.
+    int saved = ::dup(STDOUT_FILENO);
+    int null  = ::open("/dev/null", O_WRONLY);
+    if (saved < 0 || null < 0)
+    {
+        fputs("failed to open /dev/null\n", stderr);
+        return 1;
+    }
+
+    for (int r = 0; r < repeat; ++r)
+    {
+        StageResult pass[BS_MAX] = {};
+
+        fflush(stdout);
+        ::dup2(null, STDOUT_FILENO);
+        benchPass(root, opts, pass);
+        ::dup2(saved, STDOUT_FILENO);
+
+        for (int s = 0; s < BS_MAX; ++s)
+        {
+            if (r == 0 || pass[s].seconds < best[s].seconds)
+                best[s] = pass[s];
+        }
+    }
+    ::close(null);
+    ::close(saved);
+
+    string json = "{\"tree\":";
+    appendJsonString(json, root);
+    json.append(",\"repeat\":").append(to_string(repeat));
+    json.append(",\"stages\":{");
+    for (int s = 0; s < BS_MAX; ++s)
+    {
+        const StageResult& res = best[s];
+        if (s > 0)
+            json.push_back(',');
+
+        json.append("\"").append(StageNames[s]).append("\":{\"seconds\":");
+        appendf(json, "%.6f", res.seconds);
+        json.append(",\"items\":").append(to_string(res.items));
+        json.append(",\"items_per_second\":");
+        appendf(json, "%.0f", res.seconds > 0 ? (double)res.items / res.seconds : 0.0);
+        if (res.bytes > 0)
+        {
+            json.append(",\"bytes\":").append(to_string(res.bytes));
+            json.append(",\"bytes_per_second\":");
+            appendf(json, "%.0f", res.seconds > 0 ? (double)res.bytes / res.seconds : 0.0);
+        }
+        json.push_back('}');
+    }
+    json.append("}}\n");
+    fwrite(json.data(), 1, json.size(), stdout);
+    return 0;
+}
+
+static int generate(int argc, char** argv)
+{
+    if (argc < 5)
+        usage();
+
+    TreeSpec spec = {};
+    if (!parseTreeShape(argv[2], spec.shape))
+        usage();
+    spec.count = (size_t)strtoull(argv[3], nullptr, 10);
+    spec.seed  = argc > 5 ? strtoull(argv[5], nullptr, 10) : 1;
+
+    TreeStats stats = {};
+
+    clock_type::time_point start = clock_type::now();
+    bool                   ok    = generateTree(argv[4], spec, stats);
+    double                 secs  = elapsed(start, clock_type::now());
+
+    if (!ok)
+    {
+        fprintf(stderr, "failed to generate %s\n", argv[4]);
+        return 1;
+    }
+
+    string json = "{\"tree\":";
+    appendJsonString(json, argv[4]);
+    json.append(",\"shape\":\"").append(argv[2]).append("\"");
+    json.append(",\"seed\":").append(to_string(spec.seed));
+    json.append(",\"files\":").append(to_string(stats.files));
+    json.append(",\"directories\":").append(to_string(stats.directories));
+    json.append(",\"bytes\":").append(to_string(stats.bytes));
+    json.append(",\"seconds\":");
+    appendf(json, "%.6f", secs);
+    json.append("}\n");
+    fwrite(json.data(), 1, json.size(), stdout);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+        usage();
+
+    if (strcmp(argv[1], "gen") == 0)
+        return generate(argc, argv);
+    if (strcmp(argv[1], "run") == 0)
+    {
+        int repeat = argc > 3 ? atoi(argv[3]) : 3;
+        return runBench(argv[2], repeat > 0 ? repeat : 1);
+    }
+    usage();
+    return 1;
+}
@@ -0,0 +1,105 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "ColumnLayout.h"
+#include <algorithm>
+
+using namespace std;
+
+ColumnLayout::ColumnLayout() :
+    m_rows(0),
+    m_count(0)
+{
+}
+
+void ColumnLayout::compute(const uint32_t* widths,
+                           size_t          count,
+                           size_t          lineWidth,
+                           size_t          spacing)
+{
+    m_widths.clear();
+    m_count = count;
+    m_rows  = count;
+    if (count == 0)
+        return;
+
+    // An item wider than the line leaves one column.
+    size_t widest = *max_element(widths, widths + count);
+    if (widest > lineWidth)
+    {
+        m_widths.push_back(widest);
+        return;
+    }
+
+    // The most columns there could be if every item were one wide.
+    size_t maxCols = (lineWidth + spacing) / (1 + spacing);
+    maxCols        = max<size_t>(1, min(maxCols, count));
+
+    // m_spans[i] holds the widest item in [i, i + span),
+    // clipped to the end of the items.
+    m_spans.assign(widths, widths + count);
+
+    // Fewer rows can only mean more columns, so the first row count
+    // that fits is the answer. Every row count is tried, not just the
+    // fewest for each column count, since a layout with more rows can
+    // split the wide items differently and fit where the other did not.
+    size_t i, span = 1, rows = (count + maxCols - 1) / maxCols;
+    for (; rows < count; ++rows)
+    {
+        // Grow the spans to the largest power of two within a column.
+        while (span * 2 <= rows)
+        {
+            for (i = 0; i + span < count; ++i)
+                m_spans[i] = max(m_spans[i], m_spans[i + span]);
+            span *= 2;
+        }
+
+        // Two overlapping spans cover a full column. A short last
+        // column ends with the items, so its first span covers it.
+        size_t total = 0, lo;
+        bool   fits  = true;
+        for (lo = 0; lo < count && fits; lo += rows)
+        {
+            size_t hi    = min(lo + rows, count);
+            size_t width = m_spans[lo];
+            if (hi - lo >= span)
+                width = max<size_t>(width, m_spans[hi - span]);
+
+            total += width + (lo > 0 ? spacing : 0);
+            fits = total <= lineWidth;
+            m_widths.push_back(width);
+        }
+
+        if (fits)
+        {
+            m_rows = rows;
+            return;
+        }
+        m_widths.clear();
+    }
+
+    m_rows = count;
+    m_widths.push_back(widest);
+}
@@ -0,0 +1,83 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _ColumnLayout_h_
+#define _ColumnLayout_h_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Lays items out in columns, filling each column top to bottom.
+//
+// Every column is as wide as its widest item, and the layout uses the
+// most columns that fit on a line. Row counts are tried from the fewest
+// up. Column maxima are answered in constant time from a range maximum
+// table that is widened in place as the rows grow, so the items are
+// never rescanned per candidate and a layout costs O(n log n).
+class ColumnLayout
+{
+private:
+    std::vector<uint32_t> m_spans;
+    std::vector<size_t>   m_widths;
+    size_t                m_rows;
+    size_t                m_count;
+
+public:
+    ColumnLayout();
+
+    // widths holds the display width of each item in output order.
+    // Columns are separated by spacing and a line holds at most
+    // lineWidth characters, not counting the trailing newline.
+    void compute(const uint32_t* widths,
+                 size_t          count,
+                 size_t          lineWidth,
+                 size_t          spacing);
+
+    size_t rows() const
+    {
+        return m_rows;
+    }
+
+    size_t columns() const
+    {
+        return m_widths.size();
+    }
+
+    // The widest item of a column, not including the spacing.
+    size_t columnWidth(size_t col) const
+    {
+        return m_widths[col];
+    }
+
+    // The item shown at row and col. Values of count or more mean
+    // the cell is empty; only cells in the last column can be.
+    size_t index(size_t row, size_t col) const
+    {
+        return col * m_rows + row;
+    }
+};
+
+#endif  //_ColumnLayout_h_
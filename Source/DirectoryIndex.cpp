@@ -0,0 +1,311 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "DirectoryIndex.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+// File layout, in native byte order:
+//
+//  IndexHeader
+//  IndexDirectory[directories], sorted by device then inode
+//  one block per directory, each starting on an 8 byte boundary:
+//      IndexRecord[count]
+//      count NUL terminated names, nameBytes in total
+const char     IndexMagic[8] = {'L', 'S', 'I', 'N', 'D', 'E', 'X', '\0'};
+const uint32_t IndexVersion  = 1;
+
+struct IndexHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t directories;
+};
+
+struct IndexDirectory
+{
+    uint64_t device;
+    uint64_t inode;
+    int64_t  timeWrite;
+    uint64_t offset;
+    uint32_t count;
+    uint32_t nameBytes;
+};
+
+struct IndexRecord
+{
+    uint64_t size;
+    int64_t  timeWrite;
+    uint32_t attrib;
+    uint16_t nameLen;
+    uint16_t reserved;
+};
+
+static size_t align8(size_t val)
+{
+    return (val + 7) & ~(size_t)7;
+}
+
+static size_t blockSize(uint32_t count, uint32_t nameBytes)
+{
+    return align8((size_t)count * sizeof(IndexRecord) + nameBytes);
+}
+
+static bool keyLess(uint64_t devA, uint64_t inoA, uint64_t devB, uint64_t inoB)
+{
+    return devA != devB ? devA < devB : inoA < inoB;
+}
+
+IndexCursor::IndexCursor() :
+    m_records(nullptr),
+    m_name(nullptr),
+    m_end(nullptr),
+    m_count(0),
+    m_pos(0)
+{
+}
+
+bool IndexCursor::next(DirEntry& ent)
+{
+    if (m_pos >= m_count)
+        return false;
+
+    const IndexRecord* rec = (const IndexRecord*)m_records + m_pos;
+
+    // A damaged name ends the directory.
+    if (m_name + rec->nameLen >= m_end || m_name[rec->nameLen] != 0)
+    {
+        m_pos = m_count;
+        return false;
+    }
+
+    ent.name      = m_name;
+    ent.nameLen   = rec->nameLen;
+    ent.attrib    = rec->attrib;
+    ent.size      = rec->size;
+    ent.timeWrite = rec->timeWrite;
+
+    m_name += rec->nameLen + 1;
+    m_pos++;
+    return true;
+}
+
+DirectoryIndex::DirectoryIndex() :
+    m_dirs(nullptr),
+    m_dirCount(0)
+{
+}
+
+void DirectoryIndex::open(const char* path)
+{
+    m_path     = path;
+    m_dirs     = nullptr;
+    m_dirCount = 0;
+
+    if (!m_file.open(path))
+        return;
+
+    const IndexHeader* header = (const IndexHeader*)m_file.data();
+
+    if (m_file.size() < sizeof(IndexHeader) ||
+        memcmp(header->magic, IndexMagic, sizeof IndexMagic) != 0 ||
+        header->version != IndexVersion ||
+        m_file.size() < sizeof(IndexHeader) + (size_t)header->directories * sizeof(IndexDirectory))
+    {
+        m_file.close();
+        return;
+    }
+
+    m_dirs     = m_file.data() + sizeof(IndexHeader);
+    m_dirCount = header->directories;
+}
+
+bool DirectoryIndex::find(const DirectoryStamp& stamp, IndexCursor& cur) const
+{
+    const IndexDirectory* first = (const IndexDirectory*)m_dirs;
+    const IndexDirectory* last  = first + m_dirCount;
+
+    const IndexDirectory* dir = lower_bound(first, last, stamp, [](const IndexDirectory& a, const DirectoryStamp& b) {
+        return keyLess(a.device, a.inode, b.device, b.inode);
+    });
+
+    if (dir == last || dir->device != stamp.device || dir->inode != stamp.inode)
+        return false;
+    if (dir->timeWrite != stamp.timeWrite)
+        return false;
+
+    size_t bytes = (size_t)dir->count * sizeof(IndexRecord) + dir->nameBytes;
+    if (dir->offset % 8 != 0 || dir->offset > m_file.size() || bytes > m_file.size() - dir->offset)
+        return false;
+
+    cur.m_records = m_file.data() + dir->offset;
+    cur.m_name    = cur.m_records + (size_t)dir->count * sizeof(IndexRecord);
+    cur.m_end     = cur.m_name + dir->nameBytes;
+    cur.m_count   = dir->count;
+    cur.m_pos     = 0;
+    return true;
+}
+
+void DirectoryIndex::store(const DirectoryStamp& stamp, const EntryTable& entries)
+{
+    uint32_t i, count = (uint32_t)entries.size(), nameBytes = 0;
+    for (i = 0; i < count; ++i)
+        nameBytes += (uint32_t)entries.nameLength(i) + 1;
+
+    // Serialize outside of the lock, then append.
+    vector<char> block(blockSize(count, nameBytes), 0);
+
+    IndexRecord* rec  = (IndexRecord*)block.data();
+    char*        name = block.data() + (size_t)count * sizeof(IndexRecord);
+    for (i = 0; i < count; ++i, ++rec)
+    {
+        rec->size      = entries.fileSize(i);
+        rec->timeWrite = entries.timeWrite(i);
+        rec->attrib    = entries.attrib(i);
+        rec->nameLen   = (uint16_t)entries.nameLength(i);
+
+        memcpy(name, entries.name(i), rec->nameLen + 1);
+        name += rec->nameLen + 1;
+    }
+
+    lock_guard<mutex> lock(m_lock);
+
+    Pending pend = {stamp, m_blocks.size(), count, nameBytes};
+    m_pending.push_back(pend);
+    m_blocks.insert(m_blocks.end(), block.begin(), block.end());
+}
+
+bool DirectoryIndex::save()
+{
+    if (m_pending.empty())
+        return true;
+
+    // The last store of a directory wins.
+    stable_sort(m_pending.begin(), m_pending.end(), [](const Pending& a, const Pending& b) {
+        return keyLess(a.stamp.device, a.stamp.inode, b.stamp.device, b.stamp.inode);
+    });
+
+    vector<Pending> fresh;
+    for (const Pending& pend : m_pending)
+    {
+        if (!fresh.empty() &&
+            fresh.back().stamp.device == pend.stamp.device &&
+            fresh.back().stamp.inode == pend.stamp.inode)
+            fresh.back() = pend;
+        else
+            fresh.push_back(pend);
+    }
+
+    // Merge with the directories that were not stored again. A null
+    // source means the block comes from the pending buffer.
+    vector<IndexDirectory> table;
+    vector<const char*>    source;
+
+    const IndexDirectory* old = (const IndexDirectory*)m_dirs;
+    size_t                o = 0, f = 0;
+    while (o < m_dirCount || f < fresh.size())
+    {
+        bool takeOld = f >= fresh.size() ||
+                       (o < m_dirCount && keyLess(old[o].device, old[o].inode, fresh[f].stamp.device, fresh[f].stamp.inode));
+
+        if (takeOld)
+        {
+            const IndexDirectory& dir = old[o++];
+
+            size_t bytes = blockSize(dir.count, dir.nameBytes);
+            if (dir.offset % 8 != 0 || dir.offset > m_file.size() || bytes > m_file.size() - dir.offset)
+                continue;
+
+            table.push_back(dir);
+            source.push_back(m_file.data() + dir.offset);
+        }
+        else
+        {
+            const Pending& pend = fresh[f++];
+
+            // The same directory from the old index is replaced.
+            if (o < m_dirCount && old[o].device == pend.stamp.device && old[o].inode == pend.stamp.inode)
+                o++;
+
+            IndexDirectory dir = {pend.stamp.device, pend.stamp.inode, pend.stamp.timeWrite, pend.offset, pend.count, pend.nameBytes};
+            table.push_back(dir);
+            source.push_back(nullptr);
+        }
+    }
+
+    size_t offset = align8(sizeof(IndexHeader) + table.size() * sizeof(IndexDirectory));
+    for (size_t i = 0; i < table.size(); ++i)
+    {
+        size_t bytes = blockSize(table[i].count, table[i].nameBytes);
+        if (!source[i])
+            source[i] = m_blocks.data() + table[i].offset;
+        table[i].offset = offset;
+        offset += bytes;
+    }
+
+    IndexHeader header = {};
+    memcpy(header.magic, IndexMagic, sizeof IndexMagic);
+    header.version     = IndexVersion;
+    header.directories = (uint32_t)table.size();
+
+    string tmp = m_path + ".tmp";
+    FILE*  fp  = fopen(tmp.c_str(), "wb");
+    if (!fp)
+        return false;
+
+    static const char zeros[8] = {};
+
+    size_t head = sizeof(IndexHeader) + table.size() * sizeof(IndexDirectory);
+    bool   ok   = fwrite(&header, sizeof header, 1, fp) == 1;
+    if (ok && !table.empty())
+        ok = fwrite(table.data(), sizeof(IndexDirectory), table.size(), fp) == table.size();
+    if (ok && align8(head) > head)
+        ok = fwrite(zeros, align8(head) - head, 1, fp) == 1;
+
+    for (size_t i = 0; ok && i < table.size(); ++i)
+    {
+        size_t bytes = blockSize(table[i].count, table[i].nameBytes);
+        if (bytes > 0)
+            ok = fwrite(source[i], bytes, 1, fp) == 1;
+    }
+
+    ok = fclose(fp) == 0 && ok;
+
+    // The mapping has to go before the file can be replaced on Windows.
+    m_file.close();
+    m_dirs     = nullptr;
+    m_dirCount = 0;
+    m_pending.clear();
+    m_blocks.clear();
+
+    if (ok)
+        ok = replaceFile(tmp.c_str(), m_path.c_str());
+    if (!ok)
+        remove(tmp.c_str());
+    return ok;
+}
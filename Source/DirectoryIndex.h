@@ -0,0 +1,107 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _DirectoryIndex_h_
+#define _DirectoryIndex_h_
+
+#include "DirectoryReader.h"
+#include "EntryTable.h"
+#include "Platform.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Walks the entries of one directory stored in an index.
+class IndexCursor
+{
+private:
+    friend class DirectoryIndex;
+
+    const char* m_records;
+    const char* m_name;
+    const char* m_end;
+    uint32_t    m_count;
+    uint32_t    m_pos;
+
+public:
+    IndexCursor();
+
+    // Reads the next entry. The name points into the mapping
+    // and is valid for as long as the index stays open.
+    bool next(DirEntry& ent);
+};
+
+// A snapshot of directory listings kept in one file.
+//
+// Each directory is keyed by its device and inode, and is only used
+// while its write time still matches the one it was stored with, so
+// an unchanged directory costs a single stat. The file is mapped as is
+// and served without copying. Directories that changed are stored
+// again, and on save the file is rewritten to a temporary and renamed
+// over the old one, only when something was stored.
+//
+// The write time of a directory changes when entries are created,
+// removed or renamed. A file that is rewritten in place keeps the size
+// and time it was indexed with until its directory changes. Callers
+// refresh the time of sub directories, which are stat'ed anyway when
+// they are visited.
+class DirectoryIndex
+{
+private:
+    struct Pending
+    {
+        DirectoryStamp stamp;
+        size_t         offset;
+        uint32_t       count;
+        uint32_t       nameBytes;
+    };
+
+    MappedFile           m_file;
+    std::string          m_path;
+    const char*          m_dirs;
+    uint32_t             m_dirCount;
+    std::mutex           m_lock;
+    std::vector<Pending> m_pending;
+    std::vector<char>    m_blocks;
+
+public:
+    DirectoryIndex();
+
+    // Maps the index at path. A missing or unreadable file
+    // starts an empty index that is written out on save.
+    void open(const char* path);
+
+    // Finds the entries of an unchanged directory.
+    bool find(const DirectoryStamp& stamp, IndexCursor& cur) const;
+
+    // Stores the entries read from a directory. Thread safe.
+    void store(const DirectoryStamp& stamp, const EntryTable& entries);
+
+    // Writes the index if anything was stored. Returns false
+    // if the file could not be replaced.
+    bool save();
+};
+
+#endif  //_DirectoryIndex_h_
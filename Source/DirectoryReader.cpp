@@ -0,0 +1,449 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "DirectoryReader.h"
+#include "Stats.h"
+#include <cstring>
+#include <string>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include "StatBatch.h"
+#include <memory>
+#include <sys/syscall.h>
+#include <vector>
+#endif
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+
+// 100ns intervals between 1601-01-01 and 1970-01-01.
+const int64_t FileTimeEpoch = 116444736000000000LL;
+
+class FindReader : public DirectoryReader
+{
+private:
+    HANDLE           m_find;
+    WIN32_FIND_DATAA m_data;
+    bool             m_first;
+    string           m_spec;
+
+public:
+    FindReader() :
+        m_find(INVALID_HANDLE_VALUE),
+        m_first(false)
+    {
+    }
+
+    ~FindReader() override
+    {
+        close();
+    }
+
+    bool open(const char* path, EntryMetadata) override
+    {
+        close();
+
+        m_spec = path;
+        if (!m_spec.empty() && m_spec.back() != '\\' && m_spec.back() != '/')
+            m_spec.push_back('\\');
+        m_spec.push_back('*');
+
+        LS_STAT_ADD(SC_READ_CALLS, 1);
+        m_find = ::FindFirstFileExA(m_spec.c_str(),
+                                    FindExInfoBasic,
+                                    &m_data,
+                                    FindExSearchNameMatch,
+                                    nullptr,
+                                    FIND_FIRST_EX_LARGE_FETCH);
+
+        m_first = m_find != INVALID_HANDLE_VALUE;
+        return m_first;
+    }
+
+    bool next(DirEntry& ent) override
+    {
+        if (m_find == INVALID_HANDLE_VALUE)
+            return false;
+
+        if (!m_first)
+        {
+            LS_STAT_ADD(SC_READ_CALLS, 1);
+            if (!::FindNextFileA(m_find, &m_data))
+                return false;
+        }
+        m_first = false;
+
+        int64_t ft = (int64_t)m_data.ftLastWriteTime.dwHighDateTime << 32 |
+                     m_data.ftLastWriteTime.dwLowDateTime;
+
+        ent.name      = m_data.cFileName;
+        ent.nameLen   = strlen(m_data.cFileName);
+        ent.attrib    = (uint32_t)m_data.dwFileAttributes;
+        ent.size      = (uint64_t)m_data.nFileSizeHigh << 32 | m_data.nFileSizeLow;
+        ent.timeWrite = (ft - FileTimeEpoch) * 100;
+        return true;
+    }
+
+    void close() override
+    {
+        if (m_find != INVALID_HANDLE_VALUE)
+        {
+            LS_STAT_ADD(SC_READ_CALLS, 1);
+            ::FindClose(m_find);
+        }
+        m_find  = INVALID_HANDLE_VALUE;
+        m_first = false;
+    }
+};
+
+#else
+
+static void fillFromStat(DirEntry& ent, const struct stat& st)
+{
+    if (S_ISDIR(st.st_mode))
+        ent.attrib |= EA_DIRECTORY;
+    else
+        ent.size = (uint64_t)st.st_size;
+    if ((st.st_mode & S_IWUSR) == 0)
+        ent.attrib |= EA_READONLY;
+
+#ifdef __APPLE__
+    ent.timeWrite = (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    ent.timeWrite = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+static bool isDots(const char* name)
+{
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+// True if d_type leaves something the level asks for.
+static bool needsStat(const char* name, unsigned char type, EntryMetadata level)
+{
+    if (isDots(name))
+        return false;
+    if (level == EM_FULL)
+        return true;
+    return type == DT_UNKNOWN || type == DT_LNK;
+}
+
+// Describes an entry the directory gave no type for. It is stated
+// without following it first, so a link is still known as one.
+// Returns true for a link, which is left for its target to be
+// stated like any other.
+static bool statUnknown(int dirfd, DirEntry& ent)
+{
+    struct stat st = {};
+
+    LS_STAT_ADD(SC_STAT_CALLS, 1);
+    if (::fstatat(dirfd, ent.name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+        return false;
+    if (S_ISLNK(st.st_mode))
+    {
+        ent.attrib |= EA_LINK;
+        return true;
+    }
+    fillFromStat(ent, st);
+    return false;
+}
+
+#ifdef __linux__
+
+struct linux_dirent64
+{
+    uint64_t       d_ino;
+    int64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[1];
+};
+
+// Entries are taken from the buffer a whole getdents64 call at a
+// time, so their metadata can be fetched in one batch.
+class GetdentsReader : public DirectoryReader
+{
+private:
+    int                   m_fd;
+    char*                 m_buffer;
+    size_t                m_size;
+    EntryMetadata         m_level;
+    bool                  m_useTypes;
+    vector<DirEntry>      m_entries;
+    vector<DirEntry*>     m_stated;
+    size_t                m_pos;
+    unique_ptr<StatBatch> m_stat;
+
+    bool readBatch()
+    {
+        LS_STAT_ADD(SC_READ_CALLS, 1);
+        long rc = ::syscall(SYS_getdents64, m_fd, m_buffer, m_size);
+        if (rc <= 0)
+            return false;
+
+        m_entries.clear();
+        m_stated.clear();
+        m_pos = 0;
+
+        size_t pos = 0;
+        while (pos < (size_t)rc)
+        {
+            linux_dirent64* de = (linux_dirent64*)(m_buffer + pos);
+            pos += de->d_reclen;
+
+            DirEntry ent = {};
+            ent.name     = de->d_name;
+            ent.nameLen  = strlen(de->d_name);
+
+            unsigned char type = m_useTypes ? de->d_type : (unsigned char)DT_UNKNOWN;
+            if (de->d_name[0] == '.')
+                ent.attrib |= EA_HIDDEN;
+            if (type == DT_LNK)
+                ent.attrib |= EA_LINK;
+
+            bool stat = needsStat(de->d_name, type, m_level);
+            if (stat && type == DT_UNKNOWN)
+                stat = statUnknown(m_fd, ent);
+            else if (!stat && (type == DT_DIR || isDots(de->d_name)))
+                ent.attrib |= EA_DIRECTORY;
+
+            m_entries.push_back(ent);
+            if (stat)
+                m_stated.push_back(&m_entries.back());
+        }
+
+        if (!m_stated.empty())
+        {
+            if (!m_stat)
+                m_stat.reset(StatBatch::create());
+            m_stat->fill(m_fd, m_stated.data(), m_stated.size());
+        }
+        return true;
+    }
+
+public:
+    GetdentsReader(size_t bufferSize, bool useTypes) :
+        m_fd(-1),
+        m_buffer(new char[bufferSize]),
+        m_size(bufferSize),
+        m_level(EM_FULL),
+        m_useTypes(useTypes),
+        m_pos(0)
+    {
+        // Room for the most entries one read can return, the
+        // smallest record being 24 bytes, so they never move.
+        m_entries.reserve(bufferSize / 24 + 1);
+    }
+
+    ~GetdentsReader() override
+    {
+        close();
+        delete[] m_buffer;
+    }
+
+    bool open(const char* path, EntryMetadata level) override
+    {
+        close();
+        m_level = level;
+        LS_STAT_ADD(SC_READ_CALLS, 1);
+        m_fd = ::open(*path ? path : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        return m_fd != -1;
+    }
+
+    bool next(DirEntry& ent) override
+    {
+        if (m_fd == -1)
+            return false;
+
+        if (m_pos >= m_entries.size() && !readBatch())
+            return false;
+
+        ent = m_entries[m_pos++];
+        return true;
+    }
+
+    void close() override
+    {
+        if (m_fd != -1)
+        {
+            LS_STAT_ADD(SC_READ_CALLS, 1);
+            ::close(m_fd);
+        }
+        m_fd = -1;
+        m_entries.clear();
+        m_stated.clear();
+        m_pos = 0;
+    }
+};
+
+#else
+
+static void statEntry(int dirfd, DirEntry& ent)
+{
+    struct stat st = {};
+
+    LS_STAT_ADD(SC_STAT_CALLS, 1);
+    if (::fstatat(dirfd, ent.name, &st, 0) != 0)
+    {
+        // A dangling link; describe the link itself.
+        LS_STAT_ADD(SC_STAT_CALLS, 1);
+        if (::fstatat(dirfd, ent.name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+            return;
+    }
+    fillFromStat(ent, st);
+}
+
+class ReaddirReader : public DirectoryReader
+{
+private:
+    DIR*          m_dir;
+    EntryMetadata m_level;
+    bool          m_useTypes;
+
+public:
+    explicit ReaddirReader(bool useTypes) :
+        m_dir(nullptr),
+        m_level(EM_FULL),
+        m_useTypes(useTypes)
+    {
+    }
+
+    ~ReaddirReader() override
+    {
+        close();
+    }
+
+    bool open(const char* path, EntryMetadata level) override
+    {
+        close();
+        m_level = level;
+        LS_STAT_ADD(SC_READ_CALLS, 1);
+        m_dir = ::opendir(*path ? path : ".");
+        return m_dir != nullptr;
+    }
+
+    bool next(DirEntry& ent) override
+    {
+        if (!m_dir)
+            return false;
+
+        LS_STAT_ADD(SC_READ_CALLS, 1);
+        dirent* de = ::readdir(m_dir);
+        if (!de)
+            return false;
+
+        ent.name      = de->d_name;
+        ent.nameLen   = strlen(de->d_name);
+        ent.attrib    = de->d_name[0] == '.' ? EA_HIDDEN : 0;
+        ent.size      = 0;
+        ent.timeWrite = 0;
+
+        unsigned char type = m_useTypes ? de->d_type : (unsigned char)DT_UNKNOWN;
+        if (type == DT_LNK)
+            ent.attrib |= EA_LINK;
+
+        if (needsStat(de->d_name, type, m_level))
+        {
+            if (type != DT_UNKNOWN || statUnknown(::dirfd(m_dir), ent))
+                statEntry(::dirfd(m_dir), ent);
+        }
+        else if (type == DT_DIR || isDots(de->d_name))
+            ent.attrib |= EA_DIRECTORY;
+        return true;
+    }
+
+    void close() override
+    {
+        if (m_dir)
+        {
+            LS_STAT_ADD(SC_READ_CALLS, 1);
+            ::closedir(m_dir);
+        }
+        m_dir = nullptr;
+    }
+};
+
+#endif
+#endif
+
+DirectoryReader* DirectoryReader::create(size_t bufferSize, bool useTypes)
+{
+#if defined(_WIN32)
+    (void)bufferSize;
+    (void)useTypes;
+    return new FindReader();
+#elif defined(__linux__)
+    if (bufferSize < DefaultBufferSize)
+        bufferSize = DefaultBufferSize;
+    return new GetdentsReader(bufferSize, useTypes);
+#else
+    (void)bufferSize;
+    return new ReaddirReader(useTypes);
+#endif
+}
+
+bool describeEntry(const char* path, DirEntry& ent)
+{
+    ent.attrib    = ent.name[0] == '.' ? EA_HIDDEN : 0;
+    ent.size      = 0;
+    ent.timeWrite = 0;
+
+    LS_STAT_ADD(SC_STAT_CALLS, 1);
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!::GetFileAttributesExA(path, GetFileExInfoStandard, &data))
+        return false;
+
+    int64_t ft = (int64_t)data.ftLastWriteTime.dwHighDateTime << 32 |
+                 data.ftLastWriteTime.dwLowDateTime;
+
+    ent.attrib    = (uint32_t)data.dwFileAttributes;
+    ent.size      = (uint64_t)data.nFileSizeHigh << 32 | data.nFileSizeLow;
+    ent.timeWrite = (ft - FileTimeEpoch) * 100;
+#else
+    struct stat st = {};
+    if (::lstat(path, &st) != 0)
+        return false;
+    if (S_ISLNK(st.st_mode))
+    {
+        // Describe the target, unless the link is dangling.
+        struct stat target = {};
+        if (::stat(path, &target) == 0)
+            st = target;
+        ent.attrib |= EA_LINK;
+    }
+    fillFromStat(ent, st);
+#endif
+    return true;
+}
@@ -0,0 +1,103 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _DirectoryReader_h_
+#define _DirectoryReader_h_
+
+#include <cstddef>
+#include <cstdint>
+
+// Entry attributes. The values match the Windows file
+// attributes so they can be copied straight across.
+enum EntryAttributes
+{
+    EA_READONLY  = 0x0001,
+    EA_HIDDEN    = 0x0002,
+    EA_SYSTEM    = 0x0004,
+    EA_DIRECTORY = 0x0010,
+    EA_ARCHIVE   = 0x0020,
+    EA_LINK      = 0x0400,
+};
+
+// How much a reader has to find out about each entry.
+enum EntryMetadata
+{
+    EM_FULL = 0,  // size, write time and attributes
+    EM_TYPE,      // the name, and whether it is a directory or hidden
+};
+
+// One directory entry. The name points into the reader's
+// buffer and is only valid until the next call to next().
+struct DirEntry
+{
+    const char* name;
+    size_t      nameLen;
+    uint32_t    attrib;
+    uint64_t    size;
+    int64_t     timeWrite;  // nanoseconds since 1970-01-01 UTC
+};
+
+// Reads the entries of one directory at a time in large batches.
+//
+// On Linux entries come from getdents64 into a caller sized buffer,
+// on Windows from FindFirstFileEx with FindExInfoBasic and
+// FIND_FIRST_EX_LARGE_FETCH. Other systems fall back to readdir.
+// A reader is not thread safe; use one per thread.
+//
+// With EM_TYPE, entries are described by what the directory itself
+// records. On Linux that is d_type, and an entry is only stated when
+// the file system leaves it unknown, or it is a link, which takes the
+// type of its target. An entry of unknown type is stated without
+// following it first, so links are always flagged EA_LINK. Size and write time are then left as zero for
+// anything not stated. The . and .. entries are never stated.
+class DirectoryReader
+{
+public:
+    static const size_t DefaultBufferSize = 64 * 1024;
+
+    virtual ~DirectoryReader()
+    {
+    }
+
+    // Opens a directory; an empty path is the current directory.
+    virtual bool open(const char* path, EntryMetadata level) = 0;
+
+    // Reads the next entry. Returns false at the end of the directory.
+    virtual bool next(DirEntry& ent) = 0;
+
+    virtual void close() = 0;
+
+    // Without useTypes, the types the directory records are ignored
+    // and every entry is described as if the file system left them
+    // unknown; it is for testing that path.
+    static DirectoryReader* create(size_t bufferSize = DefaultBufferSize,
+                                   bool   useTypes   = true);
+};
+
+// Describes the single entry at path the way a reader would.
+// ent.name must already hold the last component of path.
+bool describeEntry(const char* path, DirEntry& ent);
+
+#endif  //_DirectoryReader_h_
@@ -0,0 +1,321 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "DiskUsage.h"
+#include "Walk.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+// A directory of the --du walk. Frames are kept on an explicit
+// stack, so a directory's totals are complete when it is popped.
+struct UsageFrame
+{
+    string      subDir;
+    strvec_t    dirs;
+    size_t      next;
+    UsageTotals totals;
+    WalkScope   scope;
+};
+
+// A directory of the parallel --du walk. A node completes once it
+// and all of its sub directories are read; it then adds its totals
+// to its parent. Nodes that are printed in the tree are kept by their
+// parent, the others are deleted as soon as they complete.
+struct UsageNode
+{
+    UsageNode*                    parent;
+    size_t                        slot;
+    size_t                        depth;
+    IgnoreChain                   ignore;
+    string                        subDir;
+    atomic<uint64_t>              bytes;
+    atomic<uint64_t>              files;
+    atomic<uint64_t>              directories;
+    atomic<size_t>                pending;
+    vector<unique_ptr<UsageNode>> kept;
+};
+
+// State shared by the tasks of one parallel --du walk.
+struct UsageWalk
+{
+    const string*  callDir;
+    const GlobSet* args;
+    const Options* opts;
+    WorkPool*      pool;
+    UsageRanking*  ranking;
+    mutex          lock;
+    atomic<bool>   done;
+};
+
+// Orders the heap so the lightest directory is at the front.
+static bool heavier(const RankedUsage& a, const RankedUsage& b)
+{
+    if (a.totals.bytes != b.totals.bytes)
+        return a.totals.bytes > b.totals.bytes;
+    return a.path < b.path;
+}
+
+UsageRanking::UsageRanking(size_t count) :
+    m_count(count)
+{
+}
+
+bool UsageRanking::accepts(uint64_t bytes) const
+{
+    if (m_count == 0)
+        return false;
+    return m_heap.size() < m_count || bytes >= m_heap.front().totals.bytes;
+}
+
+void UsageRanking::add(const string& path, const UsageTotals& totals)
+{
+    if (!accepts(totals.bytes))
+        return;
+
+    RankedUsage item = {totals, path};
+    if (m_heap.size() < m_count)
+    {
+        m_heap.push_back(std::move(item));
+        push_heap(m_heap.begin(), m_heap.end(), heavier);
+    }
+    else if (heavier(item, m_heap.front()))
+    {
+        pop_heap(m_heap.begin(), m_heap.end(), heavier);
+        m_heap.back() = std::move(item);
+        push_heap(m_heap.begin(), m_heap.end(), heavier);
+    }
+}
+
+void UsageRanking::take(vector<RankedUsage>& dest)
+{
+    sort_heap(m_heap.begin(), m_heap.end(), heavier);
+    dest = std::move(m_heap);
+    m_heap.clear();
+}
+
+static void readUsage(UsageFrame&    dest,
+                      const string&  callDir,
+                      const GlobSet& args,
+                      const Options& opts)
+{
+    // Only the sums are kept; the entries are dropped as they are read.
+    string path;
+    combinePath(path, callDir, dest.subDir, string());
+    enterScope(dest.scope, path, dest.subDir, opts);
+
+    bool descend = withinDepth(dest.scope.depth + 1, opts);
+    forEachEntry(path, opts, [&](const DirEntry& ent) {
+        if (isPruned(ent, dest.subDir, dest.scope, opts))
+            return;
+
+        if ((ent.attrib & EA_DIRECTORY) != 0)
+        {
+            if (descend && shouldDescend(ent, opts))
+                dest.dirs.push_back(string(ent.name, ent.nameLen));
+        }
+        else if (shouldBeIncluded(ent, opts) && args.match(ent.name, ent.nameLen))
+        {
+            dest.totals.bytes += ent.size;
+            dest.totals.files++;
+        }
+    });
+}
+
+static void usagePath(string& dest, const string& callDir, const string& subDir)
+{
+    dest.assign(callDir).append(subDir);
+    if (dest.empty())
+        dest.push_back('.');
+}
+
+static bool showUsage(size_t depth, const Options& opts)
+{
+    return opts.usageTop == 0 && (opts.usageDepth < 0 || depth <= (size_t)opts.usageDepth);
+}
+
+void usageAll(Output&        out,
+              const string&  callDir,
+              const GlobSet& args,
+              const Options& opts,
+              UsageRanking&  ranking)
+{
+    vector<UsageFrame> stack;
+    string             path;
+
+    stack.push_back(UsageFrame());
+    readUsage(stack.back(), callDir, args, opts);
+
+    while (!stack.empty())
+    {
+        UsageFrame& top = stack.back();
+        if (top.next < top.dirs.size())
+        {
+            UsageFrame child = {};
+            child.scope      = childScope(top.scope);
+            combinePath(child.subDir, top.subDir, top.dirs[top.next++], string());
+            readUsage(child, callDir, args, opts);
+            stack.push_back(std::move(child));
+            continue;
+        }
+
+        // Everything below is counted; children come before parents.
+        UsageTotals totals = top.totals;
+        size_t      depth  = stack.size() - 1;
+        if (showUsage(depth, opts) || ranking.accepts(totals.bytes))
+        {
+            usagePath(path, callDir, top.subDir);
+            if (showUsage(depth, opts))
+                writeUsage(out, path, totals, opts);
+            ranking.add(path, totals);
+        }
+        stack.pop_back();
+
+        if (!stack.empty())
+        {
+            UsageTotals& parent = stack.back().totals;
+            parent.bytes += totals.bytes;
+            parent.files += totals.files;
+            parent.directories += totals.directories + 1;
+        }
+    }
+}
+
+static void completeUsage(UsageNode* node, UsageWalk* walk)
+{
+    // Walks up for as long as this completes the parent as well.
+    string path;
+    while (node)
+    {
+        UsageTotals totals = {node->bytes.load(), node->files.load(), node->directories.load()};
+        if (walk->opts->usageTop > 0)
+        {
+            lock_guard<mutex> lk(walk->lock);
+            if (walk->ranking->accepts(totals.bytes))
+            {
+                usagePath(path, *walk->callDir, node->subDir);
+                walk->ranking->add(path, totals);
+            }
+        }
+
+        UsageNode* parent = node->parent;
+        if (!parent)
+        {
+            walk->done.store(true);
+            return;
+        }
+
+        parent->bytes += totals.bytes;
+        parent->files += totals.files;
+        parent->directories += totals.directories + 1;
+
+        if (!showUsage(node->depth, *walk->opts))
+            delete node;
+
+        if (--parent->pending != 0)
+            return;
+        node = parent;
+    }
+}
+
+static void visitUsage(UsageNode* node, UsageWalk* walk)
+{
+    UsageFrame frame   = {};
+    frame.subDir       = node->subDir;
+    frame.scope.depth  = node->depth;
+    frame.scope.ignore = node->ignore;
+    readUsage(frame, *walk->callDir, *walk->args, *walk->opts);
+
+    node->bytes += frame.totals.bytes;
+    node->files += frame.totals.files;
+    node->pending += frame.dirs.size();
+
+    bool keep = showUsage(node->depth + 1, *walk->opts);
+    if (keep)
+        node->kept.resize(frame.dirs.size());
+
+    for (size_t i = 0; i < frame.dirs.size(); ++i)
+    {
+        UsageNode* child = new UsageNode();
+        child->parent    = node;
+        child->slot      = i;
+        child->depth     = node->depth + 1;
+        child->ignore    = frame.scope.ignore;
+        child->pending   = 1;
+        combinePath(child->subDir, node->subDir, frame.dirs[i], string());
+
+        if (keep)
+            node->kept[i].reset(child);
+        walk->pool->submit([=] { visitUsage(child, walk); });
+    }
+
+    // Drops the count held for reading this directory.
+    if (--node->pending == 0)
+        completeUsage(node, walk);
+}
+
+static void writeUsageTree(Output& out, const UsageNode* node, const string& callDir, const Options& opts)
+{
+    for (const unique_ptr<UsageNode>& child : node->kept)
+        writeUsageTree(out, child.get(), callDir, opts);
+
+    string path;
+    usagePath(path, callDir, node->subDir);
+
+    UsageTotals totals = {node->bytes.load(), node->files.load(), node->directories.load()};
+    writeUsage(out, path, totals, opts);
+}
+
+void usageParallel(Output&        out,
+                   const string&  callDir,
+                   const GlobSet& args,
+                   const Options& opts,
+                   UsageRanking&  ranking,
+                   WorkPool&      pool)
+{
+    // Totals flow up as directories complete, in whatever order the
+    // pool finishes them. The printed part of the tree is kept and
+    // written afterwards, in the same order as usageAll.
+    UsageWalk walk;
+    walk.callDir = &callDir;
+    walk.args    = &args;
+    walk.opts    = &opts;
+    walk.pool    = &pool;
+    walk.ranking = &ranking;
+    walk.done    = false;
+
+    unique_ptr<UsageNode> root(new UsageNode());
+    root->pending = 1;
+
+    UsageNode* rp = root.get();
+    pool.submit([rp, &walk] { visitUsage(rp, &walk); });
+    pool.helpWhile([&] { return !walk.done.load(); });
+
+    if (showUsage(0, opts))
+        writeUsageTree(out, root.get(), callDir, opts);
+}
@@ -0,0 +1,93 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _DiskUsage_h_
+#define _DiskUsage_h_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class GlobSet;
+class Output;
+class WorkPool;
+struct Options;
+
+// What a directory holds, counting everything below it.
+struct UsageTotals
+{
+    uint64_t bytes;
+    uint64_t files;
+    uint64_t directories;
+};
+
+// A directory kept by UsageRanking.
+struct RankedUsage
+{
+    UsageTotals totals;
+    std::string path;
+};
+
+// Keeps the count heaviest directories offered to it, in a min heap
+// ordered by bytes, so memory is bounded by count no matter how many
+// directories are walked. Ties are broken by path to keep the result
+// the same from run to run. Not thread safe.
+class UsageRanking
+{
+private:
+    size_t                   m_count;
+    std::vector<RankedUsage> m_heap;
+
+public:
+    explicit UsageRanking(size_t count);
+
+    // False if a directory this size would not be kept,
+    // so the caller can skip building its path.
+    bool accepts(uint64_t bytes) const;
+
+    void add(const std::string& path, const UsageTotals& totals);
+
+    // Moves the kept directories into dest, heaviest first.
+    void take(std::vector<RankedUsage>& dest);
+};
+
+// Writes the --du report for the tree below callDir: every directory
+// up to opts.usageDepth as its totals complete, children before their
+// parents. With opts.usageTop, directories go to ranking instead.
+void usageAll(Output&            out,
+              const std::string& callDir,
+              const GlobSet&     args,
+              const Options&     opts,
+              UsageRanking&      ranking);
+
+// The same as usageAll, with the directories read on pool.
+void usageParallel(Output&            out,
+                   const std::string& callDir,
+                   const GlobSet&     args,
+                   const Options&     opts,
+                   UsageRanking&      ranking,
+                   WorkPool&          pool);
+
+#endif  //_DiskUsage_h_
@@ -0,0 +1,338 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Duplicates.h"
+#include "Walk.h"
+#include "WorkPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+using namespace std;
+
+const uint64_t Prime1 = 11400714785074694791ULL;
+const uint64_t Prime2 = 14029467366897019727ULL;
+const uint64_t Prime3 = 1609587929392839161ULL;
+const uint64_t Prime4 = 9650029242287828579ULL;
+const uint64_t Prime5 = 2870177450012600261ULL;
+
+static inline uint64_t rotl(uint64_t val, int bits)
+{
+    return val << bits | val >> (64 - bits);
+}
+
+static inline uint64_t read64(const unsigned char* cp)
+{
+    uint64_t val;
+    memcpy(&val, cp, sizeof val);
+    return val;
+}
+
+static inline uint32_t read32(const unsigned char* cp)
+{
+    uint32_t val;
+    memcpy(&val, cp, sizeof val);
+    return val;
+}
+
+static inline uint64_t hashRound(uint64_t acc, uint64_t input)
+{
+    acc += input * Prime2;
+    return rotl(acc, 31) * Prime1;
+}
+
+static inline uint64_t mergeRound(uint64_t acc, uint64_t val)
+{
+    acc ^= hashRound(0, val);
+    return acc * Prime1 + Prime4;
+}
+
+uint64_t hashBytes(const void* data, size_t len, uint64_t seed)
+{
+    const unsigned char* cp  = (const unsigned char*)data;
+    const unsigned char* end = cp + len;
+    uint64_t             h;
+
+    if (len >= 32)
+    {
+        uint64_t v1 = seed + Prime1 + Prime2;
+        uint64_t v2 = seed + Prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - Prime1;
+
+        const unsigned char* limit = end - 32;
+        do
+        {
+            v1 = hashRound(v1, read64(cp));
+            v2 = hashRound(v2, read64(cp + 8));
+            v3 = hashRound(v3, read64(cp + 16));
+            v4 = hashRound(v4, read64(cp + 24));
+            cp += 32;
+        } while (cp <= limit);
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    }
+    else
+        h = seed + Prime5;
+
+    h += (uint64_t)len;
+
+    for (; cp + 8 <= end; cp += 8)
+    {
+        h ^= hashRound(0, read64(cp));
+        h = rotl(h, 27) * Prime1 + Prime4;
+    }
+    if (cp + 4 <= end)
+    {
+        h ^= (uint64_t)read32(cp) * Prime1;
+        h = rotl(h, 23) * Prime2 + Prime3;
+        cp += 4;
+    }
+    for (; cp < end; ++cp)
+    {
+        h ^= *cp * Prime5;
+        h = rotl(h, 11) * Prime1;
+    }
+
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+DuplicateFinder::DuplicateFinder() :
+    m_sampled(0),
+    m_hashed(0)
+{
+}
+
+string DuplicateFinder::path(const Candidate& file) const
+{
+    return m_paths.substr(file.path, file.pathLen);
+}
+
+void DuplicateFinder::walk(const string& root, const GlobSet& patterns, const Options& opts)
+{
+    string        path;
+    DirectoryWalk walk;
+    walk.open(root, patterns, opts);
+
+    for (const WalkEntry& item : walk)
+    {
+        const DirEntry& ent = item.ent;
+        if ((ent.attrib & (EA_DIRECTORY | EA_LINK)) != 0 || ent.size == 0)
+            continue;
+
+        combinePath(path, root, *item.subDir, string(ent.name, ent.nameLen));
+        add(path, ent.size);
+    }
+}
+
+void DuplicateFinder::add(const string& path, uint64_t size)
+{
+    Candidate file = {size, 0, {}, m_paths.size(), (uint32_t)path.size(), false};
+    m_paths.append(path);
+    m_files.push_back(file);
+}
+
+// Calls fn with each index of group, on pool unless it is null.
+template <typename Fn>
+static void forEachFile(const vector<size_t>& group, WorkPool* pool, Fn fn)
+{
+    if (!pool)
+    {
+        for (size_t idx : group)
+            fn(idx);
+        return;
+    }
+
+    // One task per worker, each taking the next file until none
+    // are left; this thread helps until they are all done.
+    atomic<size_t> next(0), done(0);
+    size_t         tasks = pool->size();
+    for (size_t i = 0; i < tasks; ++i)
+    {
+        pool->submit([&] {
+            size_t pos;
+            while ((pos = next.fetch_add(1)) < group.size())
+                fn(group[pos]);
+            ++done;
+        });
+    }
+    pool->helpWhile([&] { return done.load() < tasks; });
+}
+
+void DuplicateFinder::identifyAll(vector<size_t>& group, WorkPool* pool)
+{
+    forEachFile(group, pool, [this](size_t idx) {
+        Candidate& file = m_files[idx];
+        if (!fileIdentity(path(file).c_str(), file.id))
+            file.failed = true;
+    });
+
+    group.erase(remove_if(group.begin(), group.end(), [this](size_t idx) { return m_files[idx].failed; }),
+                group.end());
+
+    // Keeps the first path of each file.
+    sort(group.begin(), group.end(), [this](size_t a, size_t b) {
+        const FileIdentity& x = m_files[a].id;
+        const FileIdentity& y = m_files[b].id;
+        if (x.device != y.device)
+            return x.device < y.device;
+        if (x.inode != y.inode)
+            return x.inode < y.inode;
+        return a < b;
+    });
+    group.erase(unique(group.begin(), group.end(), [this](size_t a, size_t b) {
+                    return m_files[a].id.device == m_files[b].id.device &&
+                           m_files[a].id.inode == m_files[b].id.inode;
+                }),
+                group.end());
+}
+
+void DuplicateFinder::hashAll(vector<size_t>& group, bool sample, WorkPool* pool)
+{
+    auto hashOne = [&](size_t idx) {
+        Candidate& file = m_files[idx];
+
+        // The whole file is mapped; only the pages hashed are read.
+        MappedFile map;
+        if (!map.open(path(file).c_str()) || map.size() != file.size)
+        {
+            file.failed = true;
+            return;
+        }
+
+        const char* data = map.data();
+        if (!sample || file.size <= 2 * SampleSize)
+            file.hash = hashBytes(data, map.size());
+        else
+        {
+            uint64_t head = hashBytes(data, SampleSize);
+            file.hash     = hashBytes(data + map.size() - SampleSize, SampleSize, head);
+        }
+    };
+
+    forEachFile(group, pool, hashOne);
+
+    if (sample)
+        m_sampled += group.size();
+    else
+        m_hashed += group.size();
+
+    group.erase(remove_if(group.begin(), group.end(), [this](size_t idx) { return m_files[idx].failed; }),
+                group.end());
+}
+
+void DuplicateFinder::find(vector<DuplicateSet>& dest, WorkPool* pool)
+{
+    auto same = [this](size_t a, size_t b) {
+        return m_files[a].size == m_files[b].size && m_files[a].hash == m_files[b].hash;
+    };
+
+    // Sorts a group by size and hash, then calls visit
+    // with each run of two or more files that match.
+    auto collide = [&](vector<size_t>& group, auto visit) {
+        sort(group.begin(), group.end(), [this](size_t a, size_t b) {
+            const Candidate& x = m_files[a];
+            const Candidate& y = m_files[b];
+            if (x.size != y.size)
+                return x.size < y.size;
+            if (x.hash != y.hash)
+                return x.hash < y.hash;
+            return a < b;
+        });
+
+        size_t i = 0, j;
+        while (i < group.size())
+        {
+            for (j = i + 1; j < group.size() && same(group[i], group[j]); ++j)
+                ;
+            if (j - i > 1)
+                visit(group.data() + i, j - i);
+            i = j;
+        }
+    };
+
+    auto addSet = [&](const size_t* files, size_t count) {
+        DuplicateSet set;
+        set.size = m_files[files[0]].size;
+        for (size_t i = 0; i < count; ++i)
+            set.paths.push_back(path(m_files[files[i]]));
+        sort(set.paths.begin(), set.paths.end());
+        dest.push_back(std::move(set));
+    };
+
+    dest.clear();
+
+    // Every hash is still zero, so this only keeps the sizes that repeat.
+    auto repeated = [&](vector<size_t>& group, vector<size_t>& next) {
+        collide(group, [&](const size_t* files, size_t count) {
+            next.insert(next.end(), files, files + count);
+        });
+        group.swap(next);
+        next.clear();
+    };
+
+    vector<size_t> group, next;
+    group.reserve(m_files.size());
+    for (size_t i = 0; i < m_files.size(); ++i)
+        group.push_back(i);
+    repeated(group, next);
+
+    // Dropping the other links may leave a size to one file.
+    identifyAll(group, pool);
+    repeated(group, next);
+
+    hashAll(group, true, pool);
+
+    // The sample of a small file is the whole file.
+    collide(group, [&](const size_t* files, size_t count) {
+        if (m_files[files[0]].size <= 2 * SampleSize)
+            addSet(files, count);
+        else
+            next.insert(next.end(), files, files + count);
+    });
+    group.swap(next);
+    next.clear();
+
+    hashAll(group, false, pool);
+    collide(group, addSet);
+
+    // The most space to win back first.
+    sort(dest.begin(), dest.end(), [](const DuplicateSet& a, const DuplicateSet& b) {
+        uint64_t wa = a.size * (a.paths.size() - 1);
+        uint64_t wb = b.size * (b.paths.size() - 1);
+        if (wa != wb)
+            return wa > wb;
+        return a.paths.front() < b.paths.front();
+    });
+}
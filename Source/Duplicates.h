@@ -0,0 +1,117 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _Duplicates_h_
+#define _Duplicates_h_
+
+#include "Platform.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class GlobSet;
+class WorkPool;
+struct Options;
+
+// Files with the same contents.
+struct DuplicateSet
+{
+    uint64_t                 size;   // of each file
+    std::vector<std::string> paths;  // sorted
+};
+
+// The 64 bit XXH64 hash of len bytes. The bulk of the input is taken
+// in 32 byte stripes over four independent lanes, which the compiler
+// keeps in registers or vectors.
+uint64_t hashBytes(const void* data, size_t len, uint64_t seed = 0);
+
+// Finds the files of a tree that have the same contents, for --dupes.
+//
+// Files are only compared with files of the same size, so most are
+// never opened. Files that share a size have a sample of their first
+// and last SampleSize bytes hashed, and only those that still collide
+// are hashed in full. Files are mapped rather than read, and hashed on
+// a pool. Contents are taken to be equal when the sizes and the 64 bit
+// hashes are.
+//
+// Empty files and links are not added; neither takes up any space.
+// Hard links to one file are that file under other names, so only the
+// first path found for it is compared.
+class DuplicateFinder
+{
+public:
+    static const size_t SampleSize = 4096;
+
+private:
+    struct Candidate
+    {
+        uint64_t     size;
+        uint64_t     hash;
+        FileIdentity id;
+        size_t       path;  // offset into m_paths
+        uint32_t     pathLen;
+        bool         failed;  // could not be read
+    };
+
+    std::string            m_paths;
+    std::vector<Candidate> m_files;
+    size_t                 m_sampled;
+    size_t                 m_hashed;
+
+    std::string path(const Candidate& file) const;
+    void        identifyAll(std::vector<size_t>& group, WorkPool* pool);
+    void        hashAll(std::vector<size_t>& group, bool sample, WorkPool* pool);
+
+public:
+    DuplicateFinder();
+
+    // Adds the files below root, following the filters of opts.
+    void walk(const std::string& root, const GlobSet& patterns, const Options& opts);
+
+    void add(const std::string& path, uint64_t size);
+
+    // Moves the sets of duplicates into dest, those that waste the
+    // most space first. Hashing runs on pool unless it is null.
+    void find(std::vector<DuplicateSet>& dest, WorkPool* pool);
+
+    size_t files() const
+    {
+        return m_files.size();
+    }
+
+    // The files that had a sample read by find, and those read in full.
+    size_t filesSampled() const
+    {
+        return m_sampled;
+    }
+
+    size_t filesHashed() const
+    {
+        return m_hashed;
+    }
+};
+
+#endif  //_Duplicates_h_
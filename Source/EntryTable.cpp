@@ -0,0 +1,65 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "EntryTable.h"
+
+using namespace std;
+
+void EntryTable::clear()
+{
+    m_names.clear();
+    m_offsets.clear();
+    m_lengths.clear();
+    m_sizes.clear();
+    m_times.clear();
+    m_attribs.clear();
+    m_order.clear();
+}
+
+void EntryTable::reserve(size_t count, size_t nameBytes)
+{
+    m_names.reserve(nameBytes);
+    m_offsets.reserve(count);
+    m_lengths.reserve(count);
+    m_sizes.reserve(count);
+    m_times.reserve(count);
+    m_attribs.reserve(count);
+    m_order.reserve(count);
+}
+
+void EntryTable::add(const DirEntry& ent)
+{
+    uint32_t idx = (uint32_t)m_offsets.size();
+
+    m_offsets.push_back((uint32_t)m_names.size());
+    m_lengths.push_back((uint16_t)ent.nameLen);
+    m_names.insert(m_names.end(), ent.name, ent.name + ent.nameLen);
+    m_names.push_back('\0');
+
+    m_sizes.push_back(ent.size);
+    m_times.push_back(ent.timeWrite);
+    m_attribs.push_back(ent.attrib);
+    m_order.push_back(idx);
+}
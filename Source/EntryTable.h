@@ -0,0 +1,126 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _EntryTable_h_
+#define _EntryTable_h_
+
+#include "DirectoryReader.h"
+#include <cstdint>
+#include <vector>
+
+// The entries of one directory, stored column wise.
+//
+// Names are copied into a single arena and each column holds one
+// field for every entry, so an entry costs its name plus 30 bytes.
+// Entries are addressed by the index they were added with; sorting
+// only permutes the 32 bit indices in the order column.
+class EntryTable
+{
+public:
+    typedef std::vector<uint32_t> order_t;
+
+private:
+    std::vector<char>     m_names;
+    std::vector<uint32_t> m_offsets;
+    std::vector<uint16_t> m_lengths;
+    std::vector<uint64_t> m_sizes;
+    std::vector<int64_t>  m_times;
+    std::vector<uint32_t> m_attribs;
+    order_t               m_order;
+
+public:
+    void clear();
+    void reserve(size_t count, size_t nameBytes);
+    void add(const DirEntry& ent);
+
+    size_t size() const
+    {
+        return m_offsets.size();
+    }
+
+    bool empty() const
+    {
+        return m_offsets.empty();
+    }
+
+    // The index of the entry at position pos in the current order.
+    uint32_t at(size_t pos) const
+    {
+        return m_order[pos];
+    }
+
+    const char* name(uint32_t idx) const
+    {
+        return m_names.data() + m_offsets[idx];
+    }
+
+    size_t nameLength(uint32_t idx) const
+    {
+        return m_lengths[idx];
+    }
+
+    uint64_t fileSize(uint32_t idx) const
+    {
+        return m_sizes[idx];
+    }
+
+    // Nanoseconds since 1970-01-01 UTC.
+    int64_t timeWrite(uint32_t idx) const
+    {
+        return m_times[idx];
+    }
+
+    uint32_t attrib(uint32_t idx) const
+    {
+        return m_attribs[idx];
+    }
+
+    bool isDirectory(uint32_t idx) const
+    {
+        return (m_attribs[idx] & EA_DIRECTORY) != 0;
+    }
+
+    // Fills ent with a view of the entry at idx.
+    void get(uint32_t idx, DirEntry& ent) const
+    {
+        ent.name      = name(idx);
+        ent.nameLen   = m_lengths[idx];
+        ent.attrib    = m_attribs[idx];
+        ent.size      = m_sizes[idx];
+        ent.timeWrite = m_times[idx];
+    }
+
+    order_t& order()
+    {
+        return m_order;
+    }
+
+    const order_t& order() const
+    {
+        return m_order;
+    }
+};
+
+#endif  //_EntryTable_h_
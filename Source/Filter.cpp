@@ -0,0 +1,257 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Filter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+
+using namespace std;
+
+const int64_t NanosPerSecond = 1000000000;
+
+bool parseCount(const char*& cp, int64_t& dest)
+{
+    if (*cp < '0' || *cp > '9')
+        return false;
+
+    int64_t val = 0;
+    while (*cp >= '0' && *cp <= '9')
+    {
+        int64_t digit = *cp++ - '0';
+        if (val > (INT64_MAX - digit) / 10)
+            return false;
+        val = val * 10 + digit;
+    }
+    dest = val;
+    return true;
+}
+
+bool parseSize(const string& value, int64_t& dest)
+{
+    const char* cp  = value.c_str();
+    int64_t     val = 0;
+
+    if (!parseCount(cp, val))
+        return false;
+
+    int shift = 0;
+    switch (*cp)
+    {
+    case 'K':
+    case 'k':
+        shift = 10;
+        break;
+    case 'M':
+    case 'm':
+        shift = 20;
+        break;
+    case 'G':
+    case 'g':
+        shift = 30;
+        break;
+    case 'T':
+    case 't':
+        shift = 40;
+        break;
+    case '\0':
+        break;
+    default:
+        return false;
+    }
+    if (shift != 0 && *++cp != '\0')
+        return false;
+    if (val > INT64_MAX >> shift)
+        return false;
+
+    dest = val << shift;
+    return true;
+}
+
+static bool parseAge(const string& value, int64_t& dest)
+{
+    const char* cp    = value.c_str();
+    int64_t     count = 0;
+    if (!parseCount(cp, count) || *cp == '\0' || cp[1] != '\0')
+        return false;
+
+    int64_t seconds;
+    switch (*cp)
+    {
+    case 's':
+        seconds = 1;
+        break;
+    case 'm':
+        seconds = 60;
+        break;
+    case 'h':
+        seconds = 3600;
+        break;
+    case 'd':
+        seconds = 86400;
+        break;
+    case 'w':
+        seconds = 7 * 86400;
+        break;
+    default:
+        return false;
+    }
+
+    // The age alone must fit; now less it always does.
+    if (count > INT64_MAX / (seconds * NanosPerSecond))
+        return false;
+
+    int64_t now = (int64_t)chrono::duration_cast<chrono::nanoseconds>(
+                      chrono::system_clock::now().time_since_epoch())
+                      .count();
+
+    dest = now - count * seconds * NanosPerSecond;
+    return true;
+}
+
+static bool parseDate(const string& value, int64_t& dest)
+{
+    tm  local = {};
+    int used  = 0;
+
+    if (sscanf(value.c_str(), "%d-%d-%d%n", &local.tm_year, &local.tm_mon, &local.tm_mday, &used) != 3)
+        return false;
+
+    if (value[used] == 'T' || value[used] == ' ')
+    {
+        int rest = 0;
+        if (sscanf(value.c_str() + used + 1, "%d:%d%n", &local.tm_hour, &local.tm_min, &rest) != 2)
+            return false;
+        used += 1 + rest;
+
+        if (value[used] == ':')
+        {
+            if (sscanf(value.c_str() + used + 1, "%d%n", &local.tm_sec, &rest) != 1)
+                return false;
+            used += 1 + rest;
+        }
+    }
+    if (used != (int)value.size())
+        return false;
+
+    local.tm_year -= 1900;
+    local.tm_mon -= 1;
+    local.tm_isdst = -1;
+
+    time_t seconds = mktime(&local);
+    if (seconds == (time_t)-1)
+        return false;
+
+    dest = (int64_t)seconds * NanosPerSecond;
+    return true;
+}
+
+static bool parseTypes(const string& value, int64_t& dest)
+{
+    dest = 0;
+    for (char ch : value)
+    {
+        if (ch == 'f')
+            dest |= FT_FILE;
+        else if (ch == 'd')
+            dest |= FT_DIRECTORY;
+        else if (ch == 'l')
+            dest |= FT_LINK;
+        else if (ch != ',')
+            return false;
+    }
+    return dest != 0;
+}
+
+bool FilterProgram::add(const string& name, const string& value)
+{
+    Step step = {};
+
+    if (name == "type")
+    {
+        step.code = FC_TYPE;
+        if (!parseTypes(value, step.value))
+            return false;
+    }
+    else if (name == "min-size" || name == "max-size")
+    {
+        step.code = name == "min-size" ? FC_MIN_SIZE : FC_MAX_SIZE;
+        if (!parseSize(value, step.value))
+            return false;
+    }
+    else if (name == "newer" || name == "older")
+    {
+        step.code = name == "newer" ? FC_NEWER : FC_OLDER;
+        if (!parseAge(value, step.value) && !parseDate(value, step.value))
+            return false;
+    }
+    else if (name == "name-regex")
+    {
+        if (value.empty())
+            return false;
+        step.code  = FC_NAME;
+        step.value = (int64_t)m_sources.size();
+        m_sources.push_back(value);
+    }
+    else
+        return false;
+
+    m_steps.push_back(step);
+    return true;
+}
+
+bool FilterProgram::compile(bool ignoreCase)
+{
+    stable_sort(m_steps.begin(), m_steps.end(), [](const Step& a, const Step& b) {
+        return a.code < b.code;
+    });
+
+    regex::flag_type flags = regex::ECMAScript | regex::optimize;
+    if (ignoreCase)
+        flags |= regex::icase;
+
+    m_patterns.clear();
+    try
+    {
+        for (const string& source : m_sources)
+            m_patterns.push_back(regex(source, flags));
+    }
+    catch (const regex_error&)
+    {
+        return false;
+    }
+    return true;
+}
+
+bool FilterProgram::needsMetadata() const
+{
+    for (const Step& step : m_steps)
+    {
+        if (step.code != FC_TYPE && step.code != FC_NAME)
+            return true;
+    }
+    return false;
+}
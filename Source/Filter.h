@@ -0,0 +1,136 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _Filter_h_
+#define _Filter_h_
+
+#include "DirectoryReader.h"
+#include <regex>
+#include <string>
+#include <vector>
+
+// The tests of a filter, in the order they are run: cheapest first.
+enum FilterCode
+{
+    FC_TYPE = 0,  // --type=fdl
+    FC_MIN_SIZE,  // --min-size=N[KMGT]
+    FC_MAX_SIZE,  // --max-size=N[KMGT]
+    FC_NEWER,     // --newer=TIME
+    FC_OLDER,     // --older=TIME
+    FC_NAME,      // --name-regex=RE
+};
+
+// Entry types tested by FC_TYPE.
+enum FilterType
+{
+    FT_FILE      = 0x1,
+    FT_DIRECTORY = 0x2,
+    FT_LINK      = 0x4,
+};
+
+// find style predicates, compiled into a flat list of tests that an
+// entry must all pass. The tests only look at the entry as the reader
+// returned it, so a rejected entry is never copied anywhere.
+//
+// Sizes take an optional K, M, G or T suffix, in powers of 1024.
+// Times are either an age counted back from now, 30m, 12h, 2d or 1w,
+// or a local date, 2026-10-16 or 2026-10-16T20:12[:50]. A name
+// matches a regular expression if any part of it does.
+class FilterProgram
+{
+private:
+    struct Step
+    {
+        FilterCode code;
+        int64_t    value;  // a size, a time, a FilterType mask or a pattern
+    };
+
+    std::vector<Step>        m_steps;
+    std::vector<std::string> m_sources;
+    std::vector<std::regex>  m_patterns;
+
+    bool test(const Step& step, const DirEntry& ent) const
+    {
+        switch (step.code)
+        {
+        case FC_TYPE:
+            return (typeOf(ent) & step.value) != 0;
+        case FC_MIN_SIZE:
+            return ent.size >= (uint64_t)step.value;
+        case FC_MAX_SIZE:
+            return ent.size <= (uint64_t)step.value;
+        case FC_NEWER:
+            return ent.timeWrite > step.value;
+        case FC_OLDER:
+            return ent.timeWrite < step.value;
+        case FC_NAME:
+            return std::regex_search(ent.name, ent.name + ent.nameLen, m_patterns[(size_t)step.value]);
+        }
+        return true;
+    }
+
+    static int64_t typeOf(const DirEntry& ent)
+    {
+        if ((ent.attrib & EA_LINK) != 0)
+            return FT_LINK;
+        return (ent.attrib & EA_DIRECTORY) != 0 ? FT_DIRECTORY : FT_FILE;
+    }
+
+public:
+    // Adds the test of a long option. Returns false if name is not
+    // one of the filter options or value cannot be parsed.
+    bool add(const std::string& name, const std::string& value);
+
+    // Orders the tests and builds the patterns.
+    // Returns false if a pattern is not a valid expression.
+    bool compile(bool ignoreCase);
+
+    bool empty() const
+    {
+        return m_steps.empty();
+    }
+
+    // True if a test looks at the size or the write time.
+    bool needsMetadata() const;
+
+    bool match(const DirEntry& ent) const
+    {
+        for (const Step& step : m_steps)
+        {
+            if (!test(step, ent))
+                return false;
+        }
+        return true;
+    }
+};
+
+// Parses a size with an optional K, M, G or T suffix.
+bool parseSize(const std::string& value, int64_t& dest);
+
+// Reads the digits at cp, leaving it after them. Fails
+// if there are none or the number does not fit.
+bool parseCount(const char*& cp, int64_t& dest);
+
+#endif  //_Filter_h_
@@ -0,0 +1,261 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Format.h"
+#include <charconv>
+#include <cstring>
+#include <ctime>
+
+using namespace std;
+
+const int64_t SecondsPerDay = 86400;
+
+char* formatGrouped(char* dest, uint64_t val)
+{
+    char   digits[24];
+    size_t len = (size_t)(to_chars(digits, digits + sizeof digits, val).ptr - digits);
+
+    // The first group takes what is left over from the groups of three.
+    size_t i, lead = len % 3;
+    if (lead == 0)
+        lead = 3;
+
+    for (i = 0; i < len; ++i)
+    {
+        if (i == lead || (i > lead && (i - lead) % 3 == 0))
+            *dest++ = ',';
+        *dest++ = digits[i];
+    }
+    return dest;
+}
+
+char* formatHuman(char* dest, uint64_t val)
+{
+    static const char Suffix[] = "KMGTPE";
+
+    if (val < 1024)
+        return to_chars(dest, dest + FormatBufferSize, val).ptr;
+
+    // Find the unit, leaving val / 1024^(unit+1) in whole and the
+    // rest as a fraction of that unit.
+    int      unit  = 0;
+    uint64_t whole = val >> 10;
+    uint64_t rest  = val & 1023;
+    uint64_t scale = 1024;
+    while (whole >= 1024 && unit < 5)
+    {
+        rest += (whole & 1023) * scale;
+        whole >>= 10;
+        scale <<= 10;
+        ++unit;
+    }
+
+    if (whole < 10)
+    {
+        // One decimal, rounded up.
+        uint64_t tenths = (rest * 10 + scale - 1) / scale;
+        if (tenths >= 10)
+        {
+            whole += 1;
+            tenths = 0;
+        }
+        if (whole < 10)
+        {
+            *dest++ = (char)('0' + whole);
+            *dest++ = '.';
+            *dest++ = (char)('0' + tenths);
+            *dest++ = Suffix[unit];
+            return dest;
+        }
+    }
+    else if (rest != 0)
+        whole += 1;
+
+    if (whole >= 1024 && unit < 5)
+    {
+        whole = 1;
+        ++unit;
+        dest  = to_chars(dest, dest + FormatBufferSize, whole).ptr;
+        *dest++ = '.';
+        *dest++ = '0';
+    }
+    else
+        dest = to_chars(dest, dest + FormatBufferSize, whole).ptr;
+    *dest++ = Suffix[unit];
+    return dest;
+}
+
+bool parseTimeStyle(const char* name, TimeStyle& dest)
+{
+    if (strcmp(name, "iso") == 0)
+        dest = TS_ISO;
+    else if (strcmp(name, "default") == 0)
+        dest = TS_DEFAULT;
+    else
+        return false;
+    return true;
+}
+
+static bool localTime(tm& dest, int64_t seconds)
+{
+    time_t tv = (time_t)seconds;
+#ifdef _WIN32
+    return ::localtime_s(&dest, &tv) == 0;
+#else
+    return ::localtime_r(&tv, &dest) != nullptr;
+#endif
+}
+
+static char* writeTwo(char* dest, int64_t val)
+{
+    dest[0] = (char)('0' + val / 10);
+    dest[1] = (char)('0' + val % 10);
+    return dest + 2;
+}
+
+TimeFormatter::TimeFormatter() :
+    m_style(TS_DEFAULT),
+    m_bias(0)
+{
+    clear();
+
+    // Line the slots up with local days, so that a day normally maps
+    // to a single slot. A day that does not is still found correctly,
+    // it just takes two.
+    tm tval;
+    if (localTime(tval, (int64_t)::time(nullptr)))
+    {
+        tval.tm_hour  = 0;
+        tval.tm_min   = 0;
+        tval.tm_sec   = 0;
+        tval.tm_isdst = -1;
+
+        time_t start = ::mktime(&tval);
+        if (start != (time_t)-1)
+            m_bias = ((-(int64_t)start) % SecondsPerDay + SecondsPerDay) % SecondsPerDay;
+    }
+}
+
+size_t TimeFormatter::slot(int64_t seconds) const
+{
+    return (size_t)((uint64_t)((seconds + m_bias) / SecondsPerDay) % DayCount);
+}
+
+void TimeFormatter::clear()
+{
+    for (Day& day : m_days)
+    {
+        day.start  = 0;
+        day.end    = 0;
+        day.length = 0;
+    }
+}
+
+char* TimeFormatter::writeClock(char* dest, int64_t secondOfDay) const
+{
+    int64_t hour = secondOfDay / 3600;
+    int64_t min  = secondOfDay / 60 % 60;
+    int64_t sec  = secondOfDay % 60;
+
+    if (m_style == TS_ISO)
+    {
+        dest    = writeTwo(dest, hour);
+        *dest++ = ':';
+        dest    = writeTwo(dest, min);
+        *dest++ = ':';
+        return writeTwo(dest, sec);
+    }
+
+    // The same as %r in the C locale.
+    int64_t hour12 = hour % 12;
+    dest    = writeTwo(dest, hour12 == 0 ? 12 : hour12);
+    *dest++ = ':';
+    dest    = writeTwo(dest, min);
+    *dest++ = ':';
+    dest    = writeTwo(dest, sec);
+    *dest++ = ' ';
+    *dest++ = hour < 12 ? 'A' : 'P';
+    *dest++ = 'M';
+    return dest;
+}
+
+char* TimeFormatter::formatSlow(char* dest, int64_t seconds)
+{
+    static const char* const Full[] = {"%D %r", "%Y-%m-%dT%H:%M:%S"};
+    static const char* const Date[] = {"%D ", "%Y-%m-%dT"};
+
+    tm tval;
+    if (!localTime(tval, seconds))
+        return dest;
+
+    dest += ::strftime(dest, FormatBufferSize, Full[m_style], &tval);
+
+    // Find the local day this time falls in.
+    tm first       = tval;
+    first.tm_hour  = 0;
+    first.tm_min   = 0;
+    first.tm_sec   = 0;
+    first.tm_isdst = -1;
+
+    tm next = first;
+    next.tm_mday += 1;
+
+    time_t start = ::mktime(&first);
+    time_t end   = ::mktime(&next);
+    if (start == (time_t)-1 || end == (time_t)-1 || end - start != SecondsPerDay)
+        return dest;
+    if (seconds < start || seconds >= end)
+        return dest;
+
+    char   date[sizeof m_days[0].date];
+    size_t len = ::strftime(date, sizeof date, Date[m_style], &tval);
+    if (len == 0)
+        return dest;
+
+    Day& day   = m_days[slot(seconds)];
+    day.start  = (int64_t)start;
+    day.end    = (int64_t)end;
+    day.length = (uint8_t)len;
+    memcpy(day.date, date, len);
+    return dest;
+}
+
+char* TimeFormatter::format(char* dest, int64_t timeWrite, TimeStyle style)
+{
+    if (style != m_style)
+    {
+        m_style = style;
+        clear();
+    }
+
+    int64_t seconds = timeWrite / 1000000000;
+
+    const Day& day = m_days[slot(seconds)];
+    if (day.length == 0 || seconds < day.start || seconds >= day.end)
+        return formatSlow(dest, seconds);
+
+    memcpy(dest, day.date, day.length);
+    return writeClock(dest + day.length, seconds - day.start);
+}
@@ -0,0 +1,91 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _Format_h_
+#define _Format_h_
+
+#include <cstddef>
+#include <cstdint>
+
+// Large enough for any value written by the functions below.
+const size_t FormatBufferSize = 32;
+
+// Writes val with a comma between each group of three digits,
+// 1,234,567. Returns the end of the text; nothing is terminated.
+char* formatGrouped(char* dest, uint64_t val);
+
+// Writes val in powers of 1024 with a K, M, G, T, P or E suffix.
+// Values below ten keep one decimal; partial units round up, so a
+// size is never shown smaller than it is. Returns the end.
+char* formatHuman(char* dest, uint64_t val);
+
+enum TimeStyle
+{
+    TS_DEFAULT = 0,  // 10/16/26 08:12:50 PM
+    TS_ISO,          // 2026-10-16T20:12:50
+};
+
+// Parses default or iso. Returns false if unknown.
+bool parseTimeStyle(const char* name, TimeStyle& dest);
+
+// Formats write times in local time.
+//
+// The date part of each local day is formatted once and kept, together
+// with the seconds at which the day starts and ends, in a small cache
+// indexed by day. An entry from a cached day only needs its time of day
+// written. Days that are not 24 hours long, where daylight saving time
+// starts or ends, are never cached and go through the C library each
+// time, so the result always matches localtime.
+class TimeFormatter
+{
+private:
+    struct Day
+    {
+        int64_t start;  // local midnight, in seconds since the epoch
+        int64_t end;
+        char    date[16];
+        uint8_t length;
+    };
+
+    static const size_t DayCount = 64;
+
+    TimeStyle m_style;
+    int64_t   m_bias;
+    Day       m_days[DayCount];
+
+    void   clear();
+    size_t slot(int64_t seconds) const;
+    char*  formatSlow(char* dest, int64_t seconds);
+    char*  writeClock(char* dest, int64_t secondOfDay) const;
+
+public:
+    TimeFormatter();
+
+    // Formats a time in nanoseconds since the epoch. Returns the end
+    // of the text, which is empty if the time cannot be converted.
+    char* format(char* dest, int64_t timeWrite, TimeStyle style);
+};
+
+#endif  //_Format_h_
@@ -0,0 +1,501 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Glob.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+static inline char lowerCase(char ch)
+{
+    if (ch >= 'A' && ch <= 'Z')
+        return ch - 'A' + 'a';
+    return ch;
+}
+
+static inline void setBit(uint64_t* bits, size_t i)
+{
+    bits[i >> 6] |= uint64_t(1) << (i & 63);
+}
+
+static inline bool testBit(const uint64_t* bits, size_t i)
+{
+    return (bits[i >> 6] & (uint64_t(1) << (i & 63))) != 0;
+}
+
+static inline size_t lowestBit(uint64_t word)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward64(&idx, word);
+    return (size_t)idx;
+#else
+    return (size_t)__builtin_ctzll(word);
+#endif
+}
+
+static bool hasMeta(const char* str, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (str[i] == '*' || str[i] == '?' || str[i] == '[')
+            return true;
+    }
+    return false;
+}
+
+size_t GlobSet::StringTable::hash(const char* str, size_t len)
+{
+    // FNV-1a
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; ++i)
+    {
+        h ^= (unsigned char)str[i];
+        h *= 1099511628211ULL;
+    }
+    return (size_t)(h ^ (h >> 32));
+}
+
+void GlobSet::StringTable::rehash(size_t size)
+{
+    m_slots.assign(size, 0);
+
+    size_t mask = size - 1, i;
+    for (i = 0; i < m_offsets.size(); ++i)
+    {
+        size_t h = hash(m_arena.data() + m_offsets[i], m_lengths[i]) & mask;
+        while (m_slots[h] != 0)
+            h = (h + 1) & mask;
+        m_slots[h] = (uint32_t)(i + 1);
+    }
+}
+
+void GlobSet::StringTable::insert(const char* str, size_t len)
+{
+    if (contains(str, len))
+        return;
+
+    m_offsets.push_back((uint32_t)m_arena.size());
+    m_lengths.push_back((uint32_t)len);
+    m_arena.append(str, len);
+
+    // Keep the load factor under one half.
+    size_t size = m_slots.empty() ? 16 : m_slots.size();
+    while (size < m_offsets.size() * 2)
+        size *= 2;
+    rehash(size);
+}
+
+bool GlobSet::StringTable::contains(const char* str, size_t len) const
+{
+    if (m_slots.empty())
+        return false;
+
+    size_t mask = m_slots.size() - 1;
+    size_t h    = hash(str, len) & mask;
+    while (m_slots[h] != 0)
+    {
+        size_t i = m_slots[h] - 1;
+        if (m_lengths[i] == len && memcmp(m_arena.data() + m_offsets[i], str, len) == 0)
+            return true;
+        h = (h + 1) & mask;
+    }
+    return false;
+}
+
+GlobSet::GlobSet()
+{
+    m_ignoreCase = false;
+    clear();
+}
+
+void GlobSet::clear()
+{
+    m_matchAll   = false;
+    m_maxLiteral = 0;
+    m_literals   = StringTable();
+    m_suffixes.clear();
+    m_tokens.clear();
+    m_accept.clear();
+    m_start.clear();
+    m_words = 0;
+    m_table.clear();
+    m_final.clear();
+    m_classes = 0;
+    m_initial = 0;
+    m_useDfa  = false;
+    memset(m_classOf, 0, sizeof m_classOf);
+}
+
+void GlobSet::add(const string& pattern)
+{
+    if (find(m_patterns.begin(), m_patterns.end(), pattern) == m_patterns.end())
+        m_patterns.push_back(pattern);
+}
+
+void GlobSet::fold(char* dest, const char* src, size_t len) const
+{
+    if (m_ignoreCase)
+    {
+        for (size_t i = 0; i < len; ++i)
+            dest[i] = lowerCase(src[i]);
+    }
+    else
+        memcpy(dest, src, len);
+}
+
+void GlobSet::parse(const string& pattern, vector<Token>& dest) const
+{
+    size_t i, s = pattern.size();
+    for (i = 0; i < s; ++i)
+    {
+        Token tok = {};
+        char  ch  = pattern[i];
+
+        if (ch == '*')
+        {
+            if (!dest.empty() && dest.back().star)
+                continue;
+            tok.star = true;
+            dest.push_back(tok);
+            continue;
+        }
+
+        if (ch == '?')
+            memset(tok.bits, 0xFF, sizeof tok.bits);
+        else if (ch == '[')
+        {
+            // Find the end of the class; a ']' right after the
+            // opening bracket or negation is a literal.
+            size_t j      = i + 1;
+            bool   negate = j < s && (pattern[j] == '!' || pattern[j] == '^');
+            if (negate)
+                ++j;
+            size_t first = j;
+            if (j < s && pattern[j] == ']')
+                ++j;
+            while (j < s && pattern[j] != ']')
+                ++j;
+
+            if (j >= s)
+                setBit(tok.bits, (unsigned char)ch);
+            else
+            {
+                size_t k;
+                for (k = first; k < j; ++k)
+                {
+                    unsigned char lo = (unsigned char)pattern[k], hi = lo;
+                    if (k + 2 < j && pattern[k + 1] == '-')
+                    {
+                        hi = (unsigned char)pattern[k + 2];
+                        k += 2;
+                    }
+                    for (unsigned int c = lo; c <= hi; ++c)
+                        setBit(tok.bits, c);
+                }
+                if (negate)
+                {
+                    for (k = 0; k < 4; ++k)
+                        tok.bits[k] = ~tok.bits[k];
+                }
+                i = j;
+            }
+        }
+        else
+            setBit(tok.bits, (unsigned char)ch);
+
+        if (m_ignoreCase)
+        {
+            for (unsigned int c = 'a'; c <= 'z'; ++c)
+            {
+                unsigned int u = c - 'a' + 'A';
+                if (testBit(tok.bits, c) || testBit(tok.bits, u))
+                {
+                    setBit(tok.bits, c);
+                    setBit(tok.bits, u);
+                }
+            }
+        }
+        dest.push_back(tok);
+    }
+}
+
+void GlobSet::compile(bool ignoreCase)
+{
+    m_ignoreCase = ignoreCase;
+    clear();
+
+    char buf[MaxLiteral];
+    for (const string& pattern : m_patterns)
+    {
+        const char* str = pattern.c_str();
+        size_t      len = pattern.size();
+
+        size_t stars = 0;
+        while (stars < len && str[stars] == '*')
+            ++stars;
+
+        if (len > 0 && stars == len)
+        {
+            m_matchAll = true;
+            continue;
+        }
+
+        if (len < MaxLiteral && !hasMeta(str, len))
+        {
+            fold(buf, str, len);
+            m_literals.insert(buf, len);
+            m_maxLiteral = max(m_maxLiteral, len);
+            continue;
+        }
+
+        if (stars > 0 && len - stars < MaxLiteral && !hasMeta(str + stars, len - stars))
+        {
+            size_t sl = len - stars;
+            fold(buf, str + stars, sl);
+
+            SuffixGroup* group = nullptr;
+            for (SuffixGroup& sg : m_suffixes)
+            {
+                if (sg.length == sl)
+                    group = &sg;
+            }
+            if (!group)
+            {
+                m_suffixes.push_back(SuffixGroup());
+                group         = &m_suffixes.back();
+                group->length = sl;
+            }
+            group->suffixes.insert(buf, sl);
+            continue;
+        }
+
+        vector<Token> toks;
+        parse(pattern, toks);
+
+        size_t startPos = m_tokens.size();
+        m_tokens.insert(m_tokens.end(), toks.begin(), toks.end());
+
+        // The accept position; no bits, so it never advances.
+        Token end = {};
+        m_tokens.push_back(end);
+
+        m_words = (m_tokens.size() + 63) / 64;
+        m_start.resize(m_words, 0);
+        m_accept.resize(m_words, 0);
+        setBit(m_start.data(), startPos);
+        setBit(m_accept.data(), m_tokens.size() - 1);
+    }
+
+    if (!m_tokens.empty())
+    {
+        closure(m_start);
+        buildClasses();
+        buildDfa();
+    }
+}
+
+void GlobSet::closure(posset_t& set) const
+{
+    // A '*' may match nothing, so the next position is live too.
+    size_t i, s = m_tokens.size();
+    for (i = 0; i + 1 < s; ++i)
+    {
+        if (m_tokens[i].star && testBit(set.data(), i))
+            setBit(set.data(), i + 1);
+    }
+}
+
+void GlobSet::step(posset_t& dest, const posset_t& src, unsigned char ch) const
+{
+    dest.assign(m_words, 0);
+
+    size_t w, s = m_tokens.size();
+    for (w = 0; w < m_words; ++w)
+    {
+        uint64_t word = src[w];
+        while (word)
+        {
+            size_t i = w * 64 + lowestBit(word);
+            word &= word - 1;
+
+            const Token& tok = m_tokens[i];
+            if (tok.star)
+                setBit(dest.data(), i);
+            else if (i + 1 < s && testBit(tok.bits, ch))
+                setBit(dest.data(), i + 1);
+        }
+    }
+    closure(dest);
+}
+
+bool GlobSet::accepts(const posset_t& set) const
+{
+    for (size_t w = 0; w < m_words; ++w)
+    {
+        if (set[w] & m_accept[w])
+            return true;
+    }
+    return false;
+}
+
+void GlobSet::buildClasses()
+{
+    // Two bytes fall in the same class when every token
+    // accepts both of them or neither of them.
+    map<vector<bool>, uint8_t> ids;
+
+    m_classes = 0;
+    for (unsigned int c = 0; c < 256; ++c)
+    {
+        vector<bool> sig;
+        sig.reserve(m_tokens.size());
+        for (const Token& tok : m_tokens)
+        {
+            if (!tok.star)
+                sig.push_back(testBit(tok.bits, c));
+        }
+
+        auto it = ids.find(sig);
+        if (it == ids.end())
+        {
+            uint8_t id = (uint8_t)m_classes++;
+            ids[sig]   = id;
+            m_classOf[c] = id;
+        }
+        else
+            m_classOf[c] = it->second;
+    }
+}
+
+void GlobSet::buildDfa()
+{
+    unsigned char rep[256] = {};
+    for (int c = 255; c >= 0; --c)
+        rep[m_classOf[c]] = (unsigned char)c;
+
+    map<posset_t, uint32_t> ids;
+    vector<posset_t>        states;
+
+    // State 0 is the dead state.
+    states.push_back(posset_t(m_words, 0));
+    ids[states[0]] = 0;
+
+    states.push_back(m_start);
+    ids[m_start] = 1;
+    m_initial    = 1;
+
+    m_table.clear();
+    m_final.clear();
+
+    posset_t next;
+    for (size_t cur = 0; cur < states.size(); ++cur)
+    {
+        m_final.push_back(accepts(states[cur]) ? 1 : 0);
+
+        for (size_t c = 0; c < m_classes; ++c)
+        {
+            if (cur == 0)
+            {
+                m_table.push_back(0);
+                continue;
+            }
+
+            step(next, states[cur], rep[c]);
+
+            auto it = ids.find(next);
+            if (it != ids.end())
+                m_table.push_back(it->second);
+            else
+            {
+                if (states.size() >= MaxStates)
+                {
+                    m_table.clear();
+                    m_final.clear();
+                    m_useDfa = false;
+                    return;
+                }
+                uint32_t id = (uint32_t)states.size();
+                ids[next]   = id;
+                states.push_back(next);
+                m_table.push_back(id);
+            }
+        }
+    }
+    m_useDfa = true;
+}
+
+bool GlobSet::matchNfa(const char* name, size_t len) const
+{
+    posset_t cur = m_start, next;
+    for (size_t i = 0; i < len; ++i)
+    {
+        step(next, cur, (unsigned char)name[i]);
+        cur.swap(next);
+    }
+    return accepts(cur);
+}
+
+bool GlobSet::match(const char* name, size_t len) const
+{
+    if (m_matchAll)
+        return true;
+
+    if (!m_literals.empty() && len <= m_maxLiteral)
+    {
+        char buf[MaxLiteral];
+        fold(buf, name, len);
+        if (m_literals.contains(buf, len))
+            return true;
+    }
+
+    for (const SuffixGroup& sg : m_suffixes)
+    {
+        if (len < sg.length)
+            continue;
+
+        char buf[MaxLiteral];
+        fold(buf, name + len - sg.length, sg.length);
+        if (sg.suffixes.contains(buf, sg.length))
+            return true;
+    }
+
+    if (m_tokens.empty())
+        return false;
+
+    if (!m_useDfa)
+        return matchNfa(name, len);
+
+    const uint32_t* table = m_table.data();
+    uint32_t        state = m_initial;
+    for (size_t i = 0; i < len && state != 0; ++i)
+        state = table[state * m_classes + m_classOf[(unsigned char)name[i]]];
+    return m_final[state] != 0;
+}
@@ -0,0 +1,152 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _Glob_h_
+#define _Glob_h_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A set of wildcard patterns compiled into a single matcher.
+//
+// Supports '*', '?' and character classes ([abc], [a-z], [!a-z]).
+// Patterns without any wildcard are kept in a hash set, and patterns
+// of the form '*literal' are grouped by suffix length, so the common
+// '*.ext' case costs one hash per distinct suffix length. Everything
+// else is compiled into one DFA that tests a name against all of the
+// remaining patterns in a single scan. The compiled set is read only,
+// so it can be shared between threads.
+class GlobSet
+{
+public:
+    typedef std::vector<std::string> strvec_t;
+
+private:
+    // An open addressed set of byte strings stored in one arena.
+    class StringTable
+    {
+    private:
+        std::string           m_arena;
+        std::vector<uint32_t> m_offsets;
+        std::vector<uint32_t> m_lengths;
+        std::vector<uint32_t> m_slots;
+
+        static size_t hash(const char* str, size_t len);
+        void          rehash(size_t size);
+
+    public:
+        void insert(const char* str, size_t len);
+        bool contains(const char* str, size_t len) const;
+
+        bool empty() const
+        {
+            return m_offsets.empty();
+        }
+    };
+
+    struct SuffixGroup
+    {
+        size_t      length;
+        StringTable suffixes;
+    };
+
+    // NFA token; a '*' or a set of accepted bytes.
+    struct Token
+    {
+        bool     star;
+        uint64_t bits[4];
+    };
+
+    typedef std::vector<uint64_t> posset_t;
+
+    strvec_t                 m_patterns;
+    bool                     m_ignoreCase;
+    bool                     m_matchAll;
+    StringTable              m_literals;
+    size_t                   m_maxLiteral;
+    std::vector<SuffixGroup> m_suffixes;
+
+    // The NFA: one token per position, patterns laid end to end.
+    // m_accept marks the position one past each pattern's last token.
+    std::vector<Token>    m_tokens;
+    posset_t              m_accept;
+    posset_t              m_start;
+    size_t                m_words;
+
+    // The DFA over byte classes. State 0 is the dead state.
+    uint8_t               m_classOf[256];
+    size_t                m_classes;
+    std::vector<uint32_t> m_table;
+    std::vector<uint8_t>  m_final;
+    uint32_t              m_initial;
+    bool                  m_useDfa;
+
+    void clear();
+    void fold(char* dest, const char* src, size_t len) const;
+    void parse(const std::string& pattern, std::vector<Token>& dest) const;
+    void closure(posset_t& set) const;
+    void step(posset_t& dest, const posset_t& src, unsigned char ch) const;
+    bool accepts(const posset_t& set) const;
+    void buildClasses();
+    void buildDfa();
+    bool matchNfa(const char* name, size_t len) const;
+
+public:
+    // The DFA is abandoned for NFA simulation past this many states.
+    static const size_t MaxStates = 4096;
+
+    // Literal and suffix patterns longer than this go to the automaton.
+    static const size_t MaxLiteral = 256;
+
+    GlobSet();
+
+    void add(const std::string& pattern);
+    void compile(bool ignoreCase);
+
+    bool match(const char* name, size_t len) const;
+
+    bool match(const std::string& name) const
+    {
+        return match(name.c_str(), name.size());
+    }
+
+    bool matchAll() const
+    {
+        return m_matchAll;
+    }
+
+    bool empty() const
+    {
+        return m_patterns.empty();
+    }
+
+    const strvec_t& patterns() const
+    {
+        return m_patterns;
+    }
+};
+
+#endif  //_Glob_h_
@@ -0,0 +1,269 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Ignore.h"
+#include "Platform.h"
+#include <cstring>
+
+using namespace std;
+
+static bool isSeparator(char ch)
+{
+    return ch == '/' || ch == Seperator;
+}
+
+static char fold(char ch, bool ignoreCase)
+{
+    if (ignoreCase && ch >= 'A' && ch <= 'Z')
+        return (char)(ch - 'A' + 'a');
+    return ch;
+}
+
+// Matches ch against the class that starts after the [ at p. Sets
+// end to the character after the closing ]. Returns false with end
+// left at p if the class is not closed, so the [ is taken literally.
+static bool matchClass(const char* p, const char* pe, char ch, bool ignoreCase, const char*& end)
+{
+    end = p;
+
+    bool negate = p < pe && (*p == '!' || *p == '^');
+    if (negate)
+        ++p;
+
+    bool        found = false;
+    const char* cp    = p;
+    ch                = fold(ch, ignoreCase);
+    while (cp < pe && (*cp != ']' || cp == p))
+    {
+        char lo = fold(*cp, ignoreCase), hi = lo;
+        if (cp + 2 < pe && cp[1] == '-' && cp[2] != ']')
+        {
+            hi = fold(cp[2], ignoreCase);
+            cp += 2;
+        }
+        if (ch >= lo && ch <= hi)
+            found = true;
+        ++cp;
+    }
+    if (cp >= pe)
+        return false;
+
+    end = cp + 1;
+    return found != negate;
+}
+
+static bool matchFrom(const char* p, const char* pe, const char* s, const char* se, bool ignoreCase)
+{
+    while (p < pe)
+    {
+        if (*p == '*')
+        {
+            if (p + 1 < pe && p[1] == '*')
+            {
+                p += 2;
+                if (p < pe && *p == '/')
+                {
+                    // **/ matches no directory, or any number of them.
+                    ++p;
+                    const char* t = s;
+                    while (true)
+                    {
+                        if (matchFrom(p, pe, t, se, ignoreCase))
+                            return true;
+                        while (t < se && !isSeparator(*t))
+                            ++t;
+                        if (t == se)
+                            return false;
+                        ++t;
+                    }
+                }
+
+                // Anything at all, separators included.
+                for (const char* t = s; t <= se; ++t)
+                {
+                    if (matchFrom(p, pe, t, se, ignoreCase))
+                        return true;
+                }
+                return false;
+            }
+
+            ++p;
+            for (const char* t = s;; ++t)
+            {
+                if (matchFrom(p, pe, t, se, ignoreCase))
+                    return true;
+                if (t == se || isSeparator(*t))
+                    return false;
+            }
+        }
+
+        if (s == se)
+            return false;
+
+        switch (*p)
+        {
+        case '?':
+            if (isSeparator(*s))
+                return false;
+            ++p;
+            break;
+        case '[':
+        {
+            const char* end;
+            bool        found = matchClass(p + 1, pe, *s, ignoreCase, end);
+            if (end != p + 1)
+            {
+                if (!found || isSeparator(*s))
+                    return false;
+                p = end;
+                break;
+            }
+            if (*s != '[')
+                return false;
+            ++p;
+            break;
+        }
+        case '/':
+            if (!isSeparator(*s))
+                return false;
+            ++p;
+            break;
+        default:
+            if (*p == '\\' && p + 1 < pe)
+                ++p;
+            if (fold(*p, ignoreCase) != fold(*s, ignoreCase))
+                return false;
+            ++p;
+            break;
+        }
+        ++s;
+    }
+    return s == se;
+}
+
+bool matchPath(const char* pattern, size_t patternLen, const char* text, size_t textLen, bool ignoreCase)
+{
+    return matchFrom(pattern, pattern + patternLen, text, text + textLen, ignoreCase);
+}
+
+IgnoreRules::IgnoreRules(const IgnoreChain& parent, const string& base, bool ignoreCase) :
+    m_parent(parent),
+    m_base(base),
+    m_ignoreCase(ignoreCase),
+    m_anchored(false)
+{
+}
+
+void IgnoreRules::parse(const char* text, size_t len)
+{
+    const char* end = text + len;
+    while (text < end)
+    {
+        const char* eol = (const char*)memchr(text, '\n', (size_t)(end - text));
+        if (!eol)
+            eol = end;
+
+        const char* first = text;
+        const char* last  = eol;
+        text              = eol + 1;
+
+        if (last > first && last[-1] == '\r')
+            --last;
+
+        // Trailing spaces go, unless escaped.
+        while (last > first && last[-1] == ' ' && !(last - 1 > first && last[-2] == '\\'))
+            --last;
+
+        if (first == last || *first == '#')
+            continue;
+
+        Rule rule     = {};
+        rule.negate   = *first == '!';
+        if (rule.negate)
+            ++first;
+        if (first < last && *first == '\\' && first + 1 < last && (first[1] == '#' || first[1] == '!'))
+            ++first;
+
+        if (last > first && last[-1] == '/')
+        {
+            rule.dirOnly = true;
+            --last;
+        }
+        if (first < last && *first == '/')
+        {
+            rule.anchored = true;
+            ++first;
+        }
+        if (first == last)
+            continue;
+
+        rule.pattern.assign(first, last);
+        if (rule.pattern.find('/') != string::npos)
+            rule.anchored = true;
+
+        m_anchored = m_anchored || rule.anchored;
+        m_rules.push_back(std::move(rule));
+    }
+}
+
+int IgnoreRules::decide(const string& subDir, const char* name, size_t len, bool isDir) const
+{
+    // The path from the directory of the file, built only if needed.
+    static thread_local string path;
+    if (m_anchored)
+    {
+        path.assign(subDir, m_base.size(), string::npos);
+        path.append(name, len);
+    }
+
+    size_t i = m_rules.size();
+    while (i-- > 0)
+    {
+        const Rule& rule = m_rules[i];
+        if (rule.dirOnly && !isDir)
+            continue;
+
+        bool match;
+        if (rule.anchored)
+            match = matchPath(rule.pattern.data(), rule.pattern.size(), path.data(), path.size(), m_ignoreCase);
+        else
+            match = matchPath(rule.pattern.data(), rule.pattern.size(), name, len, m_ignoreCase);
+
+        if (match)
+            return rule.negate ? -1 : 1;
+    }
+    return 0;
+}
+
+bool IgnoreRules::ignores(const string& subDir, const char* name, size_t len, bool isDir) const
+{
+    for (const IgnoreRules* rules = this; rules; rules = rules->m_parent.get())
+    {
+        int verdict = rules->decide(subDir, name, len, isDir);
+        if (verdict != 0)
+            return verdict > 0;
+    }
+    return false;
+}
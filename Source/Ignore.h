@@ -0,0 +1,108 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _Ignore_h_
+#define _Ignore_h_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+class IgnoreRules;
+
+// The rules in effect for a directory. Directories without an ignore
+// file of their own share their parent's chain; nothing is copied or
+// parsed again on the way down.
+typedef std::shared_ptr<const IgnoreRules> IgnoreChain;
+
+// The rules of one ignore file, with gitignore semantics.
+//
+//  - Blank lines and lines starting with # are skipped. A # or a !
+//    is escaped with a leading \ and trailing spaces are dropped.
+//  - A leading ! brings back what an earlier rule ignored.
+//  - A trailing / only matches directories.
+//  - A pattern with a / anywhere but at the end is matched against
+//    the path from the directory of the file; any other pattern is
+//    matched against the name at any depth below it.
+//  - * and ? do not match a /, ** matches any number of directories,
+//    and [a-z] classes work as they do for wild-cards.
+//
+// The last rule that matches decides, and the rules of a directory
+// come before the rules of the directories above it. Once a directory
+// is ignored nothing inside it is looked at, so as with git, a file
+// cannot be brought back from inside an ignored directory.
+class IgnoreRules
+{
+private:
+    struct Rule
+    {
+        std::string pattern;
+        bool        negate;
+        bool        dirOnly;
+        bool        anchored;
+    };
+
+    IgnoreChain       m_parent;
+    std::string       m_base;
+    std::vector<Rule> m_rules;
+    bool              m_ignoreCase;
+    bool              m_anchored;
+
+    int decide(const std::string& subDir,
+               const char*        name,
+               size_t             len,
+               bool               isDir) const;
+
+public:
+    // base is the directory of the file, relative to the root of the
+    // walk; it is empty or ends with a separator.
+    IgnoreRules(const IgnoreChain& parent, const std::string& base, bool ignoreCase);
+
+    // Adds the rules in text.
+    void parse(const char* text, size_t len);
+
+    bool empty() const
+    {
+        return m_rules.empty();
+    }
+
+    // True if the entry name in subDir is ignored by this file or any
+    // above it. subDir is relative to the root of the walk and lies at
+    // or below the directory of the file.
+    bool ignores(const std::string& subDir,
+                 const char*        name,
+                 size_t             len,
+                 bool               isDir) const;
+};
+
+// Matches text against a path pattern as an ignore rule does.
+bool matchPath(const char* pattern,
+               size_t      patternLen,
+               const char* text,
+               size_t      textLen,
+               bool        ignoreCase);
+
+#endif  //_Ignore_h_
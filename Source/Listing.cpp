@@ -0,0 +1,910 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Listing.h"
+#include "Platform.h"
+#include "Stats.h"
+#include "Walk.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// A directory visit in the parallel walk. The children are
+// filled in by the worker before ready is set.
+struct ListNode
+{
+    DirectoryListing             listing;
+    vector<unique_ptr<ListNode>> children;
+    atomic<bool>                 ready;
+};
+
+const size_t RootThreads     = 8;
+const size_t RootBufferSize  = 1024 * 1024;
+const size_t ColumnSpacing   = 2;
+const size_t SizeWidth       = 18;
+const size_t CountWidth      = 12;
+
+// Precomputed strings and offsets
+const string SizeInBytes     = "Size in Bytes";
+const string LastUsed        = "Last Modified";
+const string FileName        = "Name";
+const string FileCount       = "Files";
+const string DirCount        = "Directories";
+const string Bytes           = "bytes";
+const string Files           = " file(s)";
+const string Directory       = " directory";
+const string Directories     = " directories";
+const string Found           = "Found: ";
+const string And             = " and ";
+const string Times           = " x ";
+const string Reclaimable     = " bytes reclaimable in ";
+const string DuplicateSets   = " set(s) of duplicates";
+const string Added           = " added, ";
+const string Removed         = " removed, ";
+const string Modified        = " modified";
+const char   DiffMarks[]     = {'+', '-', '~'};
+const int    DiffColors[]    = {CS_GREEN, CS_RED, CS_YELLOW};
+const size_t SizeLabelCenter = 3;
+const size_t LastModCenter   = 6;
+const size_t NameLeft        = 5;
+
+static int entryColor(uint32_t attrib)
+{
+    if ((attrib & EA_SYSTEM) != 0)
+        return CS_MAGENTA;
+    if ((attrib & EA_HIDDEN) != 0)
+        return CS_GREY;
+    if ((attrib & EA_DIRECTORY) != 0)
+        return CS_GREEN;
+    return CS_WHITE;
+}
+
+void writeEntry(Output&         out,
+                const string&   subDir,
+                const DirEntry& ent,
+                const Options&  opts,
+                ListReport&     totals,
+                string&         scratch)
+{
+    bool isDirectory = (ent.attrib & EA_DIRECTORY) != 0;
+
+    if (opts.format != RF_TEXT)
+        writeRecord(out, opts.format, subDir, ent);
+    else if (opts.list)
+    {
+        // Each thread keeps its own cache of formatted days.
+        static thread_local TimeFormatter times;
+
+        char  buf[FormatBufferSize];
+        char* end = times.format(buf, ent.timeWrite, opts.timeStyle);
+
+        if (isDirectory)
+        {
+            out.pad(SizeWidth + 1);
+            totals.totalDirectories++;
+        }
+        else
+        {
+            out.setColor(CS_YELLOW);
+            writeSize(out, ent.size, SizeWidth, opts);
+
+            out.put(' ');
+            totals.totalFiles++;
+            totals.totalBytes += ent.size;
+        }
+
+        out.setColor(CS_LIGHT_GREY);
+        out.write(buf, (size_t)(end - buf));
+        out.put(' ');
+
+        out.setColor(entryColor(ent.attrib));
+        out.write(ent.name, ent.nameLen);
+        out.put('\n');
+    }
+    else
+    {
+        out.setColor(entryColor(ent.attrib));
+        makeName(scratch, subDir, ent.name, ent.nameLen, opts);
+        out.write(scratch);
+        out.put('\n');
+    }
+}
+
+void finishDirectory(Output&           out,
+                     const ListReport& totals,
+                     bool              hasEntries,
+                     const Options&    opts,
+                     ListReport*       rept)
+{
+    if (rept)
+    {
+        rept->totalDirectories += totals.totalDirectories;
+        rept->totalFiles += totals.totalFiles;
+        rept->totalBytes += totals.totalBytes;
+    }
+
+    if (opts.list)
+    {
+        if (hasEntries)
+            writeListFooter(out, totals.totalBytes, totals.totalFiles, totals.totalDirectories, opts);
+    }
+
+    out.setColor(CS_WHITE);
+
+    // Keep an interactive console moving between directories.
+    if (out.isTerminal())
+        out.flush();
+}
+
+void writeDirectory(Output&                 out,
+                    const DirectoryListing& listing,
+                    const Options&          opts,
+                    ListReport*             rept)
+{
+    LS_STAT_SCOPE(SP_FORMAT);
+
+    size_t            i;
+    ListReport        totals = {};
+    DirEntry          ent    = {};
+    const EntryTable& table  = listing.entries;
+    const string&     subDir = listing.subDir;
+
+    if (!table.empty() && opts.list)
+        writeListHeader(out, subDir, opts);
+
+    string name;
+    if (opts.list || opts.byline)
+    {
+        for (i = 0; i < table.size(); ++i)
+        {
+            table.get(table.at(i), ent);
+            writeEntry(out, subDir, ent, opts, totals, name);
+        }
+    }
+    else if (!table.empty())
+    {
+        ColumnLayout layout;
+        calculateColumns(layout, table, opts);
+
+        size_t r, c, idx, cols = layout.columns();
+        for (r = 0; r < layout.rows(); ++r)
+        {
+            for (c = 0; c < cols; ++c)
+            {
+                idx = layout.index(r, c);
+                if (idx >= table.size())
+                    break;
+
+                table.get(table.at(idx), ent);
+                out.setColor(entryColor(ent.attrib));
+                makeName(name, subDir, ent.name, ent.nameLen, opts);
+
+                // No padding after the last name on the row.
+                if (c + 1 < cols && layout.index(r, c + 1) < table.size())
+                    out.writeLeft(name, layout.columnWidth(c) + ColumnSpacing);
+                else
+                    out.write(name);
+            }
+            out.put('\n');
+        }
+    }
+
+    finishDirectory(out, totals, !table.empty(), opts, rept);
+}
+
+void writeUsageHeader(Output& out)
+{
+    out.setColor(CS_LIGHT_GREY);
+    out.put('\n');
+    out.writeRight(SizeInBytes, SizeWidth);
+    out.put(' ');
+    out.writeRight(FileCount, CountWidth);
+    out.put(' ');
+    out.writeRight(DirCount, CountWidth);
+    out.put(' ');
+    out.write(FileName);
+    out.put('\n');
+    out.put('\n');
+}
+
+void writeUsage(Output& out, const string& path, const UsageTotals& totals, const Options& opts)
+{
+    char  buf[FormatBufferSize];
+    char* end;
+
+    out.setColor(CS_YELLOW);
+    writeSize(out, totals.bytes, SizeWidth, opts);
+    out.put(' ');
+
+    out.setColor(CS_WHITE);
+    end = formatGrouped(buf, totals.files);
+    out.writeRight(buf, (size_t)(end - buf), CountWidth);
+    out.put(' ');
+    end = formatGrouped(buf, totals.directories);
+    out.writeRight(buf, (size_t)(end - buf), CountWidth);
+    out.put(' ');
+
+    out.setColor(CS_DARKGREEN);
+    out.write(path);
+    out.put('\n');
+}
+
+void writeDuplicates(Output& out, const DuplicateSet& set, const Options& opts)
+{
+    out.setColor(CS_YELLOW);
+    writeSize(out, set.size, SizeWidth, opts);
+    out.setColor(CS_DARKYELLOW);
+    out.put(' ');
+    out.write(Bytes);
+    out.setColor(CS_WHITE);
+    out.write(Times);
+    out.writeNumber(set.paths.size());
+    out.put('\n');
+
+    out.setColor(CS_DARKGREEN);
+    for (const string& path : set.paths)
+    {
+        out.pad(SizeWidth + 1);
+        out.write(path);
+        out.put('\n');
+    }
+    out.put('\n');
+}
+
+void writeDuplicateReport(Output& out, const vector<DuplicateSet>& sets, const Options& opts)
+{
+    uint64_t wasted = 0;
+    for (const DuplicateSet& set : sets)
+        wasted += set.size * (set.paths.size() - 1);
+
+    out.setColor(CS_WHITE);
+    out.write(Found);
+    out.setColor(CS_YELLOW);
+    out.put('\n');
+
+    writeSize(out, wasted, 0, opts);
+    out.setColor(CS_WHITE);
+    out.write(Reclaimable);
+    out.writeNumber(sets.size());
+    out.write(DuplicateSets);
+    out.put('\n');
+}
+
+void writeTreeEntry(Output& out, const ManifestEntry& ent, const Options& opts, ListReport& totals, string& scratch)
+{
+    DirEntry de  = {};
+    de.name      = ent.path.c_str();
+    de.nameLen   = ent.path.size();
+    de.attrib    = ent.attrib;
+    de.size      = ent.size;
+    de.timeWrite = ent.timeWrite;
+    writeEntry(out, string(), de, opts, totals, scratch);
+}
+
+void writeDifference(Output& out, DiffKind kind, const ManifestEntry& ent, const Options& opts)
+{
+    out.setColor(DiffColors[kind]);
+    out.put(DiffMarks[kind]);
+    out.put(' ');
+
+    if ((ent.attrib & EA_DIRECTORY) != 0)
+        out.pad(SizeWidth);
+    else
+        writeSize(out, ent.size, SizeWidth, opts);
+    out.put(' ');
+
+    out.setColor(entryColor(ent.attrib));
+    out.write(ent.path);
+    out.put('\n');
+}
+
+void writeDiffReport(Output& out, const DiffCounts& counts, const Options&)
+{
+    out.put('\n');
+    out.setColor(CS_WHITE);
+    out.write(Found);
+    out.put('\n');
+
+    out.setColor(CS_GREEN);
+    out.writeNumber(counts.added);
+    out.setColor(CS_WHITE);
+    out.write(Added);
+    out.setColor(CS_RED);
+    out.writeNumber(counts.removed);
+    out.setColor(CS_WHITE);
+    out.write(Removed);
+    out.setColor(CS_YELLOW);
+    out.writeNumber(counts.modified);
+    out.setColor(CS_WHITE);
+    out.write(Modified);
+    out.put('\n');
+}
+
+void writeSize(Output& out, uint64_t val, size_t width, const Options& opts)
+{
+    char  buf[FormatBufferSize];
+    char* end = opts.human ? formatHuman(buf, val) : formatGrouped(buf, val);
+    out.writeRight(buf, (size_t)(end - buf), width);
+}
+
+void calculateColumns(ColumnLayout& layout, const EntryTable& table, const Options& opts)
+{
+    // The width makeName will produce for each entry.
+    size_t extra = (opts.quote ? 2 : 0) + (opts.comma ? 1 : 0);
+
+    vector<uint32_t> widths(table.size());
+    for (size_t i = 0; i < widths.size(); ++i)
+        widths[i] = (uint32_t)(table.nameLength(table.at(i)) + extra);
+
+    // Stay clear of the last cell so the console does not wrap.
+    size_t lineWidth = opts.winWidth > 1 ? (size_t)opts.winWidth - 1 : 1;
+    layout.compute(widths.data(), widths.size(), lineWidth, ColumnSpacing);
+}
+
+void makeName(string& dest, const string& subDir, const char* name, size_t nameLen, const Options& opts)
+{
+    LS_STAT_SCOPE(SP_NAMES);
+
+    if (opts.byline)
+        dest.assign(subDir).append(name, nameLen);
+    else
+        dest.assign(name, nameLen);
+
+#ifdef _WIN32
+    if (opts.shortpath && dest.find(' ') != string::npos)
+    {
+        string search = subDir + Seperator + string(name, nameLen);
+
+        size_t len = (size_t)::GetShortPathName(search.c_str(), nullptr, 0);
+        if (len > 0)
+        {
+            char* tmp = new char[len + 1];
+
+            size_t nlen = (size_t)::GetShortPathName(search.c_str(), tmp, (DWORD)len);
+            if (nlen != 0 && nlen <= len)
+            {
+                tmp[nlen] = 0;
+
+                dest = tmp;
+                if (!opts.byline)
+                {
+                    string pth;
+                    splitPath(dest, pth, dest);
+                }
+            }
+            delete[] tmp;
+        }
+    }
+#endif
+
+    if (opts.quote)
+        dest = "\"" + dest + "\"";
+
+    if (opts.comma)
+        dest.push_back(',');
+}
+
+bool shouldBeIncluded(const DirEntry& val, const Options& opts)
+{
+    if (!opts.all && (val.attrib & EA_HIDDEN) != 0)
+        return false;
+    if (!opts.system && (val.attrib & EA_SYSTEM) != 0)
+        return false;
+    if (opts.dirOnly && !(val.attrib & EA_DIRECTORY))
+        return false;
+    if (opts.fileOnly && (val.attrib & EA_DIRECTORY) != 0)
+        return false;
+    return opts.filter.match(val);
+}
+
+bool shouldDescend(const DirEntry& val, const Options& opts)
+{
+    if ((val.attrib & EA_DIRECTORY) == 0)
+        return false;
+    // Links are listed, not followed, so a walk cannot loop.
+    if ((val.attrib & EA_LINK) != 0)
+        return false;
+    if (!opts.all && (val.attrib & EA_HIDDEN) != 0)
+        return false;
+    if (!opts.system && (val.attrib & EA_SYSTEM) != 0)
+        return false;
+    return true;
+}
+
+SortOptions sortOptions(const Options& opts)
+{
+    SortOptions so = {opts.sortKey, opts.reverse, opts.ignoreCase, (size_t)opts.jobs};
+    return so;
+}
+
+void enterScope(WalkScope& scope, const string& path, const string& subDir, const Options& opts)
+{
+    if (opts.ignoreFile.empty())
+        return;
+
+    string file;
+    combinePath(file, path, string(), opts.ignoreFile);
+
+    MappedFile map;
+    if (!map.open(file.c_str()))
+        return;
+
+    shared_ptr<IgnoreRules> rules = make_shared<IgnoreRules>(scope.ignore, subDir, opts.ignoreCase);
+    rules->parse(map.data(), map.size());
+    if (!rules->empty())
+        scope.ignore = rules;
+}
+
+bool withinDepth(size_t depth, const Options& opts)
+{
+    return !opts.hasMaxDepth || depth <= (size_t)opts.maxDepth;
+}
+
+bool isPruned(const DirEntry& val, const string& subDir, const WalkScope& scope, const Options& opts)
+{
+    if (!opts.exclude.empty() && opts.exclude.match(val.name, val.nameLen))
+        return true;
+    if (scope.ignore && scope.ignore->ignores(subDir, val.name, val.nameLen, (val.attrib & EA_DIRECTORY) != 0))
+        return true;
+    return false;
+}
+
+WalkScope childScope(const WalkScope& scope)
+{
+    WalkScope child = {scope.depth + 1, scope.ignore};
+    return child;
+}
+
+EntryMetadata metadataLevel(const Options& opts)
+{
+    if (opts.list || opts.usage || opts.dupes || opts.format != RF_TEXT)
+        return EM_FULL;
+    if (!opts.manifestOut.empty() || !opts.diffPath.empty())
+        return EM_FULL;
+    if (opts.largest > 0 || opts.globalSort)
+        return EM_FULL;
+    if (opts.index || !opts.indexPath.empty() || !opts.servePath.empty())
+        return EM_FULL;
+    if (opts.sortKey == SK_SIZE || opts.sortKey == SK_TIME)
+        return EM_FULL;
+    if (opts.filter.needsMetadata())
+        return EM_FULL;
+    return EM_TYPE;
+}
+
+void writeListHeader(Output& out, const string& directory, const Options& opts)
+{
+    if (!directory.empty())
+    {
+        out.setColor(CS_DARKGREEN);
+        out.put('\n');
+        string dir;
+        makeName(dir, directory, "", 0, opts);
+        out.write(dir);
+        out.put('\n');
+    }
+    out.setColor(CS_LIGHT_GREY);
+    out.put('\n');
+    out.pad(SizeLabelCenter);
+    out.write(SizeInBytes);
+    out.pad(LastModCenter);
+    out.write(LastUsed);
+    out.pad(NameLeft);
+    out.write(FileName);
+    out.put('\n');
+    out.put('\n');
+}
+
+void writeListFooter(Output& out, size_t sizeInBytes, size_t files, size_t dirs, const Options& opts)
+{
+    out.setColor(CS_YELLOW);
+    out.put('\n');
+    writeSize(out, sizeInBytes, SizeWidth, opts);
+    out.setColor(CS_DARKYELLOW);
+
+    out.put(' ');
+    out.write(Bytes);
+    out.setColor(CS_WHITE);
+    out.pad(16);
+    out.writeNumber(files);
+    out.write(Files);
+    if (dirs != 0)
+    {
+        out.write(And);
+        out.writeNumber(dirs);
+        if (dirs > 1)
+            out.write(Directories);
+        else
+            out.write(Directory);
+    }
+    out.put('\n');
+}
+
+void writeReport(Output& out, ListReport* rept, const Options& opts)
+{
+    out.put('\n');
+    out.setColor(CS_WHITE);
+    out.write(Found);
+    out.setColor(CS_YELLOW);
+    out.put('\n');
+
+    writeSize(out, rept->totalBytes, 0, opts);
+    out.setColor(CS_DARKYELLOW);
+    out.put(' ');
+    out.write(Bytes);
+    out.setColor(CS_WHITE);
+
+    out.put(' ');
+    out.writeNumber(rept->totalFiles);
+    out.write(Files);
+    if (rept->totalDirectories != 0)
+    {
+        out.write(And);
+        out.writeNumber(rept->totalDirectories);
+        if (rept->totalDirectories > 1)
+            out.write(Directories);
+        else
+            out.write(Directory);
+    }
+    out.put('\n');
+}
+
+void splitPath(const string& input,
+               string&       path,
+               string&       ptrn)
+{
+    size_t pos = input.find_last_of(Seperator);
+    if (pos != string::npos)
+    {
+        path = input.substr(0, pos + 1);
+        ptrn = input.substr(pos + 1, input.size());
+    }
+    else
+    {
+        path.clear();
+        ptrn = input;
+    }
+}
+
+void normalizePath(string&       dest,
+                   const string& input)
+{
+    dest = input;
+    size_t pos;
+    while ((pos = dest.find(SeperatorAlt)) != string::npos)
+        dest[pos] = Seperator;
+}
+
+void combinePath(string&       dest,
+                 const string& path,
+                 const string& subpath,
+                 const string& search)
+{
+    dest = path;
+    if (!dest.empty())
+    {
+        if (dest.back() != Seperator)
+            dest.push_back(Seperator);
+    }
+
+    if (!subpath.empty())
+        dest += subpath;
+
+    if (!dest.empty())
+    {
+        if (dest.back() != Seperator)
+            dest.push_back(Seperator);
+    }
+
+    if (!search.empty())
+    {
+        if (search.front() == Seperator)
+            dest += search.substr(1, search.size());
+        else
+            dest += search;
+    }
+}
+
+void streamDirectory(Output&        out,
+                     const string&  callDir,
+                     const string&  subDir,
+                     const GlobSet& args,
+                     const Options& opts,
+                     ListReport*    rept,
+                     strvec_t&      dirs,
+                     WalkScope&     scope)
+{
+    // Entries are written as they are read, so memory
+    // does not grow with the size of the directory.
+    ListReport totals = {};
+    bool       any    = false;
+    string     path, scratch;
+
+    combinePath(path, callDir, subDir, string());
+    enterScope(scope, path, subDir, opts);
+
+    bool descend = opts.recursive && withinDepth(scope.depth + 1, opts);
+    forEachEntry(path, opts, [&](const DirEntry& ent) {
+        if (isPruned(ent, subDir, scope, opts))
+            return;
+        if (descend && shouldDescend(ent, opts))
+            dirs.push_back(string(ent.name, ent.nameLen));
+
+        if (!shouldBeIncluded(ent, opts) || !args.match(ent.name, ent.nameLen))
+            return;
+
+        if (!any && opts.list)
+            writeListHeader(out, subDir, opts);
+
+        writeEntry(out, subDir, ent, opts, totals, scratch);
+
+        // Get the first line out straight away.
+        if (!any && out.bytesWritten() == 0)
+            out.flush();
+        any = true;
+    });
+
+    finishDirectory(out, totals, any, opts, rept);
+}
+
+void listAll(Output&          out,
+             const string&    callDir,
+             const string&    subDir,
+             const GlobSet&   args,
+             const Options&   opts,
+             ListReport*      rept,
+             const WalkScope& scope)
+{
+    DirectoryListing listing;
+    listing.scope = scope;
+    if (opts.stream)
+        streamDirectory(out, callDir, subDir, args, opts, rept, listing.dirs, listing.scope);
+    else
+    {
+        readDirectory(listing, callDir, subDir, args, opts);
+        writeDirectory(out, listing, opts, rept);
+    }
+
+    if (opts.recursive)
+    {
+        for (const string& dir : listing.dirs)
+        {
+            string path;
+            combinePath(path, subDir, dir, string());
+            listAll(out, callDir, path, args, opts, rept, childScope(listing.scope));
+        }
+    }
+}
+
+static void visitNode(ListNode*       node,
+                      const string*   callDir,
+                      const string    subDir,
+                      const GlobSet*  args,
+                      const Options*  opts,
+                      WorkPool*       pool)
+{
+    readDirectory(node->listing, *callDir, subDir, *args, *opts);
+
+    if (opts->recursive)
+    {
+        const strvec_t& dirs = node->listing.dirs;
+        while (node->children.size() < dirs.size())
+        {
+            node->children.push_back(unique_ptr<ListNode>(new ListNode()));
+            node->children.back()->listing.scope = childScope(node->listing.scope);
+        }
+
+        // Submitted in reverse so the owning worker pops
+        // them in the order they will be written.
+        size_t i = dirs.size();
+        while (i-- > 0)
+        {
+            string path;
+            combinePath(path, subDir, dirs[i], string());
+
+            ListNode* child = node->children[i].get();
+            pool->submit([=] { visitNode(child, callDir, path, args, opts, pool); });
+        }
+    }
+
+    node->ready.store(true, memory_order_release);
+}
+
+void listParallel(Output&         out,
+                  const string&   callDir,
+                  const string&   subDir,
+                  const GlobSet&  args,
+                  const Options&  opts,
+                  ListReport*     rept,
+                  WorkPool&       pool)
+{
+    // Directories are read on the pool and written here, in the
+    // same pre-order as listAll. Only this thread touches rept.
+    unique_ptr<ListNode> root(new ListNode());
+    ListNode*            rp = root.get();
+    pool.submit([&, rp] { visitNode(rp, &callDir, subDir, &args, &opts, &pool); });
+
+    vector<unique_ptr<ListNode>> stack;
+    stack.push_back(std::move(root));
+
+    while (!stack.empty())
+    {
+        unique_ptr<ListNode> node = std::move(stack.back());
+        stack.pop_back();
+
+        pool.helpWhile([&] { return !node->ready.load(memory_order_acquire); });
+        writeDirectory(out, node->listing, opts, rept);
+
+        size_t i = node->children.size();
+        while (i-- > 0)
+            stack.push_back(std::move(node->children[i]));
+    }
+}
+
+static void listRoot(Output&         out,
+                     const ListRoot& root,
+                     const Options&  opts,
+                     ListReport*     rept,
+                     WorkPool*       pool)
+{
+    if (pool)
+        listParallel(out, string(), root.path, root.globs, opts, rept, *pool);
+    else
+        listAll(out, string(), root.path, root.globs, opts, rept);
+}
+
+// A root listed by listRoots ahead of its turn. What it renders is
+// held until it is written, and its thread waits while more than
+// RootBufferSize bytes are.
+class RootStream : public OutputSink
+{
+private:
+    mutex&              m_lock;
+    condition_variable& m_changed;
+    string              m_text;
+    bool                m_done;
+
+public:
+    ListReport totals;
+
+    RootStream(mutex& lock, condition_variable& changed) :
+        m_lock(lock),
+        m_changed(changed),
+        m_done(false),
+        totals()
+    {
+    }
+
+    void write(const char* data, size_t len) override
+    {
+        unique_lock<mutex> lk(m_lock);
+        m_changed.wait(lk, [this] { return m_text.size() < RootBufferSize; });
+        m_text.append(data, len);
+        m_changed.notify_all();
+    }
+
+    void finish()
+    {
+        lock_guard<mutex> lk(m_lock);
+        m_done = true;
+        m_changed.notify_all();
+    }
+
+    // Waits for more text, and moves it into dest. Returns
+    // false once the root is done and nothing is left.
+    bool take(string& dest)
+    {
+        unique_lock<mutex> lk(m_lock);
+        m_changed.wait(lk, [this] { return m_done || !m_text.empty(); });
+
+        dest.clear();
+        dest.swap(m_text);
+        m_changed.notify_all();
+        return !dest.empty();
+    }
+};
+
+static void addReport(ListReport* rept, const ListReport& totals)
+{
+    if (rept)
+    {
+        rept->totalDirectories += totals.totalDirectories;
+        rept->totalFiles += totals.totalFiles;
+        rept->totalBytes += totals.totalBytes;
+    }
+}
+
+void listRoots(Output&          out,
+               const rootvec_t& roots,
+               const Options&   opts,
+               ListReport*      rept,
+               WorkPool*        pool)
+{
+    if (roots.size() < 2)
+    {
+        if (!roots.empty())
+            listRoot(out, roots.front(), opts, rept, pool);
+        return;
+    }
+
+    // The roots may be on different disks, so each is walked on its
+    // own, a few threads at a time. All but the first are rendered into
+    // memory, and written as they come once every root before them is
+    // out; a root further ahead waits when it has rendered enough.
+    mutex                          lock;
+    condition_variable             changed;
+    vector<unique_ptr<RootStream>> streams;
+    atomic<size_t>                 next(1);
+    size_t                         i;
+
+    for (i = 0; i < roots.size(); ++i)
+        streams.push_back(unique_ptr<RootStream>(new RootStream(lock, changed)));
+
+    vector<thread> threads;
+    size_t         count = min(roots.size() - 1, RootThreads);
+    for (i = 0; i < count; ++i)
+    {
+        threads.push_back(thread([&] {
+            size_t r;
+            while ((r = next.fetch_add(1)) < roots.size())
+            {
+                RootStream& stream = *streams[r];
+                {
+                    Output sink(stream);
+                    sink.colorLike(out);
+                    listRoot(sink, roots[r], opts, &stream.totals, pool);
+                }
+                stream.finish();
+            }
+        }));
+    }
+
+    // The first root goes straight out while the others are read.
+    ListReport totals = {};
+    listRoot(out, roots.front(), opts, &totals, pool);
+    addReport(rept, totals);
+
+    string text;
+    for (i = 1; i < streams.size(); ++i)
+    {
+        RootStream& stream = *streams[i];
+        while (stream.take(text))
+        {
+            out.writeRendered(text);
+            if (out.isTerminal())
+                out.flush();
+        }
+        addReport(rept, stream.totals);
+    }
+
+    for (thread& th : threads)
+        th.join();
+}
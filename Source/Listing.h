@@ -0,0 +1,307 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _Listing_h_
+#define _Listing_h_
+
+#include "ColumnLayout.h"
+#include "DirectoryReader.h"
+#include "DiskUsage.h"
+#include "Duplicates.h"
+#include "EntryTable.h"
+#include "Filter.h"
+#include "Format.h"
+#include "Glob.h"
+#include "Ignore.h"
+#include "Manifest.h"
+#include "Output.h"
+#include "RecordFormat.h"
+#include "Sort.h"
+#include "WorkPool.h"
+#include <string>
+#include <vector>
+
+class DirectoryIndex;
+
+// Replicating some similar options.
+// http://www.man7.org/linux/man-pages/man1/ls.1.html
+struct Options
+{
+    bool            byline;      // -x, -c = by column (default)
+    bool            all;         // -a (hidden)
+    bool            system;      // -as (system)
+    bool            dirOnly;     // -d
+    bool            fileOnly;    // -f only files
+    bool            comma;       // -m
+    bool            quote;       // -q
+    bool            list;        // -l
+    bool            recursive;   // -R
+    bool            shortpath;   // -S
+    bool            reverse;     // -r
+    bool            hasSortKey;  // --sort, -U
+    SortKey         sortKey;     // --sort=name|size|time|ext|none
+    bool            stream;      // --stream
+    bool            ignoreCase;  // --ignore-case, --match-case
+    int             jobs;        // -j N (0 = serial)
+    std::string     indexPath;   // --index PATH
+    DirectoryIndex* index;       // opened from indexPath
+    std::string     servePath;   // --serve SOCKET
+    std::string     queryPath;   // --query SOCKET
+    RecordFormat    format;      // --format=ndjson|nul|bin
+    bool            human;       // -H
+    TimeStyle       timeStyle;   // --time-style=default|iso
+    bool            usage;       // --du
+    int             usageDepth;  // --depth N (-1 = all)
+    int             usageTop;    // --top N (0 = the tree)
+    bool            dupes;       // --dupes
+    std::string     manifestOut; // --manifest-out FILE
+    std::string     diffPath;    // --diff FILE
+    std::string     diffAgainst; // --diff FILE, given a second time
+    int             largest;     // --largest N, --newest N (0 = off)
+    SortKey         largestKey;  // SK_SIZE for --largest, SK_TIME for --newest
+    bool            globalSort;  // --global-sort
+    uint64_t        sortMemory;  // --sort-memory N
+    bool            stats;       // --stats
+    std::string     tracePath;   // --trace FILE
+    FilterProgram   filter;      // --type, --min-size, --max-size, --newer, --older, --name-regex
+    GlobSet         exclude;     // --exclude GLOB
+    bool            hasMaxDepth; // --max-depth
+    int             maxDepth;    // --max-depth N
+    std::string     ignoreFile;  // --ignore-file[=NAME]
+    EntryMetadata   metadata;    // from metadataLevel
+    int             winWidth;
+};
+
+struct ListReport
+{
+    uint64_t totalBytes;
+    uint64_t totalFiles;
+    uint64_t totalDirectories;
+};
+
+typedef std::vector<std::string> strvec_t;
+
+// A directory given on the command line and the
+// patterns to match against its entries.
+struct ListRoot
+{
+    std::string path;
+    GlobSet     globs;
+};
+
+typedef std::vector<ListRoot> rootvec_t;
+
+// What a directory of a walk inherits from the one above it.
+struct WalkScope
+{
+    size_t      depth;   // 0 for the root
+    IgnoreChain ignore;  // with --ignore-file
+};
+
+// The result of enumerating one directory.
+struct DirectoryListing
+{
+    std::string subDir;
+    EntryTable  entries;
+    strvec_t    dirs;
+    WalkScope   scope;
+};
+
+// The entries a listing shows, and the directories -R walks into.
+bool shouldBeIncluded(const DirEntry& val,
+                      const Options&  opts);
+
+bool shouldDescend(const DirEntry& val,
+                   const Options&  opts);
+
+SortOptions sortOptions(const Options& opts);
+
+// Puts the rules of the ignore file in the directory at path, if opts
+// names one and the directory has it, in front of those scope holds.
+void enterScope(WalkScope&         scope,
+                const std::string& path,
+                const std::string& subDir,
+                const Options&     opts);
+
+// True if the directories of a walk are entered at depth.
+bool withinDepth(size_t depth, const Options& opts);
+
+// True if an entry is left out of a walk, with all that is below it:
+// it matches --exclude, or the ignore files in scope.
+bool isPruned(const DirEntry&    val,
+              const std::string& subDir,
+              const WalkScope&   scope,
+              const Options&     opts);
+
+// The scope of a sub directory of a directory in scope.
+WalkScope childScope(const WalkScope& scope);
+
+// The least the readers need to find out about each entry for the
+// listing opts asks for. Only the list view, records, --du, the index,
+// the size and time orders and filters on size or time use more than
+// the type of an entry.
+EntryMetadata metadataLevel(const Options& opts);
+
+// Writes one entry of a directory and adds it to totals.
+// scratch is reused between calls to build the name in.
+void writeEntry(Output&            out,
+                const std::string& subDir,
+                const DirEntry&    ent,
+                const Options&     opts,
+                ListReport&        totals,
+                std::string&       scratch);
+
+// Ends a directory written with writeEntry, adding its totals to rept.
+void finishDirectory(Output&           out,
+                     const ListReport& totals,
+                     bool              hasEntries,
+                     const Options&    opts,
+                     ListReport*       rept);
+
+// Writes a whole directory in the layout opts asks for.
+void writeDirectory(Output&                 out,
+                    const DirectoryListing& listing,
+                    const Options&          opts,
+                    ListReport*             rept);
+
+void calculateColumns(ColumnLayout&     layout,
+                      const EntryTable& table,
+                      const Options&    opts);
+
+void makeName(std::string&       dest,
+              const std::string& subDir,
+              const char*        name,
+              size_t             nameLen,
+              const Options&     opts);
+
+void writeSize(Output&        out,
+               uint64_t       val,
+               size_t         width,
+               const Options& opts);
+
+void writeListHeader(Output&            out,
+                     const std::string& directory,
+                     const Options&     opts);
+
+void writeListFooter(Output&        out,
+                     size_t         sizeInBytes,
+                     size_t         files,
+                     size_t         dirs,
+                     const Options& opts);
+
+void writeReport(Output&        out,
+                 ListReport*    rept,
+                 const Options& opts);
+
+void writeUsageHeader(Output& out);
+
+void writeUsage(Output&            out,
+                const std::string& path,
+                const UsageTotals& totals,
+                const Options&     opts);
+
+// Writes one set of --dupes, and the summary after all of them.
+void writeDuplicates(Output&             out,
+                     const DuplicateSet& set,
+                     const Options&      opts);
+
+void writeDuplicateReport(Output&                          out,
+                          const std::vector<DuplicateSet>& sets,
+                          const Options&                   opts);
+
+// Writes an entry of a whole tree, named by its path, the same
+// way writeEntry writes the entry of a directory.
+void writeTreeEntry(Output&              out,
+                    const ManifestEntry& ent,
+                    const Options&       opts,
+                    ListReport&          totals,
+                    std::string&         scratch);
+
+// Writes one entry of --diff, and the counts after all of them.
+void writeDifference(Output&              out,
+                     DiffKind             kind,
+                     const ManifestEntry& ent,
+                     const Options&       opts);
+
+void writeDiffReport(Output&           out,
+                     const DiffCounts& counts,
+                     const Options&    opts);
+
+// Lists a directory below callDir, and with opts.recursive everything
+// below it, adding the totals to rept if it is not null.
+void listAll(Output&            out,
+             const std::string& callDir,
+             const std::string& subDir,
+             const GlobSet&     args,
+             const Options&     opts,
+             ListReport*        rept,
+             const WalkScope&   scope = WalkScope());
+
+// The same as listAll, with the directories read on pool.
+void listParallel(Output&            out,
+                  const std::string& callDir,
+                  const std::string& subDir,
+                  const GlobSet&     args,
+                  const Options&     opts,
+                  ListReport*        rept,
+                  WorkPool&          pool);
+
+// Lists every root, in order, as listAll does, or listParallel when
+// pool is not null. The roots after the first are read at the same
+// time on their own threads, and each is written out as it is read
+// once all before it are done. A root further ahead holds at most
+// about a megabyte of its output before it waits. Each root's totals
+// are added to rept at the end, in the same order.
+void listRoots(Output&          out,
+               const rootvec_t& roots,
+               const Options&   opts,
+               ListReport*      rept,
+               WorkPool*        pool);
+
+// Writes the entries of a directory as they are read, without
+// holding or sorting them. The sub directories go to dirs, and scope
+// takes in the directory's ignore file.
+void streamDirectory(Output&            out,
+                     const std::string& callDir,
+                     const std::string& subDir,
+                     const GlobSet&     args,
+                     const Options&     opts,
+                     ListReport*        rept,
+                     strvec_t&          dirs,
+                     WalkScope&         scope);
+
+void combinePath(std::string&       dest,
+                 const std::string& path,
+                 const std::string& subpath,
+                 const std::string& search);
+
+void splitPath(const std::string& input,
+               std::string&       path,
+               std::string&       pattern);
+
+void normalizePath(std::string&       dest,
+                   const std::string& input);
+
+#endif  //_Listing_h_
@@ -23,168 +23,112 @@
   3. This notice may not be removed or altered from any source distribution.
 -------------------------------------------------------------------------------
 */
-#include <direct.h>
-#include <io.h>
-#include <windows.h>
+#include "DirectoryIndex.h"
+#include "DirectoryReader.h"
+#include "DiskUsage.h"
+#include "Duplicates.h"
+#include "EntryTable.h"
+#include "Glob.h"
+#include "Listing.h"
+#include "Manifest.h"
+#include "Output.h"
+#include "Platform.h"
+#include "RecordFormat.h"
+#include "Server.h"
+#include "Sort.h"
+#include "Stats.h"
+#include "TreeSort.h"
+#include "Walk.h"
+#include "WorkPool.h"
 #include <algorithm>
 #include <cassert>
-#include <iomanip>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <sstream>
+#include <new>
 #include <string>
+#include <thread>
 #include <vector>
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
-enum Colors
-{
-    CS_BLACK = 0,
-    CS_DARKBLUE,
-    CS_DARKGREEN,
-    CS_DARKCYAN,
-    CS_DARKRED,
-    CS_DARKMAGENTA,
-    CS_DARKYELLOW,
-    CS_LIGHT_GREY,
-    CS_GREY,
-    CS_BLUE,
-    CS_GREEN,
-    CS_CYAN,
-    CS_RED,
-    CS_MAGENTA,
-    CS_YELLOW,
-    CS_WHITE,
-    CS_COLOR_MAX
-};
-
-struct finddata_t
-{
-    string      name;
-    _finddata_t data;
+const size_t MaxName           = 28;
+const char   DefaultWildcard   = '*';
+const char   AnyCharacter      = '?';
+const string Empty             = "";
+const string Wildcard          = string(1, DefaultWildcard);
+const string DefaultIgnoreFile = ".gitignore";
+const int    DefaultSortMemory = 64 << 20;
 
-    bool operator<(const finddata_t& rhs) const
-    {
-        int a = (data.attrib & _A_SUBDIR);
-        int b = (rhs.data.attrib & _A_SUBDIR);
-        return a > b;
-    }
+void help();
 
-    static bool sort_size(const finddata_t& lhs, const finddata_t& rhs)
-    {
-        // Give the directories a lower value so they are 
-        // first in the list when a file also has zero size.
-        int64_t a = (lhs.data.attrib & _A_SUBDIR) ? -1 : 0;
-        int64_t b = (rhs.data.attrib & _A_SUBDIR) ? -1 : 0;
-        return (lhs.data.size + a) < (rhs.data.size + b);
-    }
-};
+bool isWildcard(const string& arg);
+
+bool parseNumber(const string& value, int& dest);
 
+bool parseLongOption(int      argc,
+                     char**   argv,
+                     size_t&  i,
+                     Options& opts);
+
+void addRoot(rootvec_t&    roots,
+             const string& path,
+             const string& pattern);
+
+#ifdef _WIN32
+BOOL WINAPI CtrlCallback(DWORD evt);
+#else
+void CtrlCallback(int sig);
+#endif
+
+#ifdef LS_STATS
+
+// Counts the allocations of the program for --stats. Only counted
+// once stats are enabled, so a plain listing pays for the check alone.
+void* operator new(size_t size)
+{
+    if (StatsEnabled)
+        StatsAllocations.fetch_add(1, memory_order_relaxed);
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw bad_alloc();
+    return ptr;
+}
 
-// Replicating some similar options.
-// http://www.man7.org/linux/man-pages/man1/ls.1.html
-struct Options
+void operator delete(void* ptr) noexcept
 {
-    bool byline;         // -x, -c = by column (default)
-    bool all;            // -a (hidden)
-    bool system;         // -as (system)
-    bool dirOnly;        // -d
-    bool fileOnly;       // -f only files
-    bool comma;          // -m
-    bool quote;          // -q
-    bool list;           // -l
-    bool recursive;      // -R
-    bool shortpath;      // -S
-    int  winWidth;
-};
-
-struct ListReport
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
 {
-    uint64_t totalBytes;
-    uint64_t totalFiles;
-    uint64_t totalDirectories;
-};
-
-typedef vector<finddata_t> pathvec_t;
-typedef vector<string>     strvec_t;
-typedef vector<size_t>     ivec_t;
-
-const size_t MaxName         = 28;
-const size_t SizeWidth       = 18;
-const char   SeperatorWin    = '\\';
-const char   SeperatorNx     = '/';
-const char   DefaultWildcard = '*';
-const string Empty           = "";
-const string Wildcard        = string(1, DefaultWildcard);
-
-// Precomputed strings and offsets
-const string SizeInBytes     = "Size in Bytes";
-const string LastUsed        = "Last Modified";
-const string FileName        = "Name";
-const string Bytes           = "bytes";
-const string Files           = " file(s)";
-const string Directory       = " directory";
-const string Directories     = " directories";
-const string Found           = "Found: ";
-const string And             = " and ";
-const size_t SizeLabelCenter = 3;
-const size_t LastModCenter   = 6;
-const size_t NameLeft        = 5;
-
-void          help();
-void          setColor(int fore, int back = CS_BLACK);
-unsigned char getColor(int fore, int back);
-
-void listAll(const string&   cur,
-             const string&   ex,
-             const strvec_t& args,
-             const Options&  opts,
-             ListReport*     rept);
-
-void combinePath(string&       dest,
-                 const string& path,
-                 const string& subpath,
-                 const string& search);
-
-void splitPath(const string& input,
-               string&       path,
-               string&       pattern);
-
-void normalizePath(string&       dest,
-                   const string& input);
-
-void makeName(string&        dest,
-              const string&  subDir,
-              const string&  name,
-              const Options& opts);
-
-void writeListHeader(const string&  directory,
-                     const Options& opts);
-
-void writeListFooter(size_t sizeInBytes,
-                     size_t files,
-                     size_t dirs);
-
-void writeReport(ListReport* rept);
-
-void calculateColumns(pathvec_t&     vec,
-                      ivec_t&        iv,
-                      const size_t   maxWidth,
-                      const Options& opts);
-
-void getBytesString(string&        dest,
-                    const uint64_t val);
-
-bool shouldBeIncluded(const _finddata_t& val,
-                     const Options&     opts);
+    free(ptr);
+}
 
-BOOL WINAPI CtrlCallback(DWORD evt);
+#endif
 
 int main(int argc, char** argv)
 {
-    size_t   i;
-    strvec_t args, externals;
-    Options  opts = {};
+    size_t    i;
+    rootvec_t roots;
+    strvec_t  words;
+    Options   opts = {};
 
+    opts.usageDepth = -1;
+    opts.sortMemory = DefaultSortMemory;
+
+#ifdef _WIN32
+    // Match the file system by default.
+    opts.ignoreCase = true;
+#endif
+
+#ifdef _WIN32
     SetConsoleCtrlHandler(CtrlCallback, TRUE);
 
     CONSOLE_SCREEN_BUFFER_INFO info;
@@ -199,10 +143,20 @@ int main(int argc, char** argv)
         // may become invalid, and should be handled above.
         opts.winWidth = info.dwSize.X;
     }
+#else
+    ::signal(SIGINT, CtrlCallback);
+    ::signal(SIGTERM, CtrlCallback);
+
+    winsize ws = {};
+    if (::ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) != 0 || ws.ws_col == 0)
+        opts.winWidth = 100;
+    else
+        opts.winWidth = ws.ws_col;
+#endif
 
     if (argc > 1)
     {
-        for (i = 1; i < argc; ++i)
+        for (i = 1; i < (size_t)argc; ++i)
         {
             if (argv[i][0] == '-')
             {
@@ -241,10 +195,43 @@ int main(int argc, char** argv)
                 case 'S':
                     opts.shortpath = true;
                     break;
+                case 'U':
+                    opts.sortKey    = SK_NONE;
+                    opts.hasSortKey = true;
+                    break;
+                case 'r':
+                    opts.reverse = true;
+                    break;
+                case 'H':
+                    opts.human = true;
+                    break;
                 case 'R':
                     opts.byline    = true;
                     opts.recursive = true;
                     break;
+                case '-':
+                    if (!parseLongOption(argc, argv, i, opts))
+                    {
+                        cout << "unknown option " << argv[i] << '\n';
+                        help();
+                    }
+                    break;
+                case 'j':
+                {
+                    const size_t at = i;
+
+                    string value;
+                    if (argv[i][2] != '\0')
+                        value = argv[i] + 2;
+                    else if (i + 1 < (size_t)argc)
+                        value = argv[++i];
+                    if (!parseNumber(value, opts.jobs))
+                    {
+                        cout << "unknown option " << argv[at] << '\n';
+                        help();
+                    }
+                    break;
+                }
                 }
             }
             else
@@ -252,235 +239,377 @@ int main(int argc, char** argv)
                 string path, arg;
                 string str;
 
+                words.push_back(argv[i]);
                 normalizePath(str, argv[i]);
                 splitPath(str, path, arg);
 
-                externals.push_back(path);
+                // A plain directory name lists everything in it.
+                if (arg.empty() || (!isWildcard(arg) && isDirectory(str.c_str())))
+                {
+                    combinePath(path, str, Empty, Empty);
+                    arg = Wildcard;
+                }
+                addRoot(roots, path, arg);
+            }
+        }
+    }
 
-                if (arg.find(DefaultWildcard) == string::npos)
-                    arg.push_back(SeperatorWin);
-                if (arg.back() == SeperatorWin)
-                    arg.push_back(DefaultWildcard);
+    if (!opts.queryPath.empty())
+    {
+        // The remaining arguments are the request.
+        string request;
+        for (const string& word : words)
+            request.append(request.empty() ? "" : " ").append(word);
 
-                args.push_back(arg);
-            }
+        Output out;
+        return query(opts.queryPath.c_str(), request, out);
+    }
+
+    bool manifest = !opts.manifestOut.empty() || !opts.diffPath.empty();
+
+    // The usage, duplicate and manifest reports have a single text layout.
+    if (opts.usage || opts.dupes || manifest)
+        opts.format = RF_TEXT;
+
+    // A manifest covers the whole tree below the first path.
+    if (manifest)
+        opts.recursive = true;
+
+    // Duplicates are looked for across the whole tree, in no order.
+    if (opts.dupes)
+    {
+        opts.recursive  = true;
+        opts.fileOnly   = true;
+        opts.sortKey    = SK_NONE;
+        opts.hasSortKey = true;
+    }
+
+    // Records go out in directory order unless asked otherwise,
+    // and none of the decoration of the text listing applies.
+    if (opts.format != RF_TEXT)
+    {
+        if (!opts.hasSortKey)
+        {
+            opts.sortKey    = SK_NONE;
+            opts.hasSortKey = true;
         }
-        if (args.empty())
-            args.push_back(Wildcard);
+        opts.byline = true;
+        opts.list   = false;
     }
-    else
-        args.push_back(Wildcard);
+
+    // Size is the default order of the list view.
+    if (!opts.hasSortKey)
+        opts.sortKey = opts.list ? SK_SIZE : SK_DIRECTORY;
+
+    // The whole tree is ordered at once, and each directory is
+    // read in the order it comes.
+    TreeOrder order(opts.sortKey, opts.reverse, opts.ignoreCase);
+    if (opts.largest > 0)
+        order = TreeOrder(opts.largestKey, !opts.reverse, opts.ignoreCase);
+    if (opts.largest > 0 || opts.globalSort)
+    {
+        opts.byline    = true;
+        opts.recursive = true;
+        opts.sortKey   = SK_NONE;
+    }
+
+    // Unsorted line output has nothing to wait for.
+    if (opts.byline && opts.sortKey == SK_NONE)
+        opts.stream = true;
+    if (opts.stream && !opts.list)
+        opts.byline = true;
+
+    if (!opts.filter.compile(opts.ignoreCase))
+    {
+        cout << "invalid --name-regex expression\n";
+        help();
+    }
+
+    // Worked out once; most listings never stat an entry.
+    opts.metadata = metadataLevel(opts);
+
+    if (roots.empty())
+        addRoot(roots, Empty, Wildcard);
+    for (ListRoot& root : roots)
+        root.globs.compile(opts.ignoreCase);
+    opts.exclude.compile(opts.ignoreCase);
 
     ListReport  lr     = {};
     ListReport* result = nullptr;
     if (opts.list && opts.recursive)
         result = &lr;
 
-    if (!externals.empty())
+    if (!opts.servePath.empty())
     {
-        for (string external : externals)
-            listAll(Empty, external, args, opts, result);
+        ServeConfig config;
+        combinePath(config.root, roots.front().path, Empty, Empty);
+
+        config.include = [&opts](const DirEntry& ent) {
+            return shouldBeIncluded(ent, opts);
+        };
+        config.descend = [&opts](const DirEntry& ent) {
+            return shouldDescend(ent, opts);
+        };
+        config.write = [&opts](Output& out, const string& subDir, EntryTable& entries) {
+            DirectoryListing listing;
+            listing.subDir  = subDir;
+            listing.entries = std::move(entries);
+            sortEntries(listing.entries, sortOptions(opts));
+            writeDirectory(out, listing, opts, nullptr);
+        };
+
+        Output out;
+        return serve(opts.servePath.c_str(), config, out);
     }
-    else
+
+#ifdef LS_STATS
+    if (opts.stats || !opts.tracePath.empty())
+        statsEnable(opts.tracePath.c_str());
+#endif
+
+    DirectoryIndex index;
+    if (!opts.indexPath.empty())
     {
-        assert(!args.empty());
-        listAll(Empty, Empty, args, opts, result);
+        index.open(opts.indexPath.c_str());
+        opts.index = &index;
     }
 
-    if (result)
-        writeReport(result);
-    cout << endl;
-    return 0;
-}
+    Output out;
+    if (opts.format != RF_TEXT)
+    {
+        out.disableColor();
+        writeRecordHeader(out, opts.format);
+    }
 
-bool isDotEntry(char *cp)
-{
-    return cp[0] == '.' && cp[1] == '\0' ||
-           cp[0] == '.' && cp[1] == '.' && cp[2] == '\0';
-}
+    if (opts.usage)
+    {
+        // Directories are totaled in one walk, children before parents.
+        UsageRanking ranking((size_t)opts.usageTop);
 
-void listAll(const string&   callDir,
-             const string&   subDir,
-             const strvec_t& args,
-             const Options&  opts,
-             ListReport*     rept)
-{
-    _finddata_t find     = {};
-    size_t      i        = 1, nrbytes, nrfiles, nrdirs;
-    size_t      maxwidth = 0;
-    strvec_t    dirs;
+        writeUsageHeader(out);
+        if (opts.jobs > 0)
+        {
+            WorkPool pool((size_t)opts.jobs);
+            for (const ListRoot& root : roots)
+                usageParallel(out, root.path, root.globs, opts, ranking, pool);
+        }
+        else
+        {
+            for (const ListRoot& root : roots)
+                usageAll(out, root.path, root.globs, opts, ranking);
+        }
 
-    if (opts.recursive)
+        vector<RankedUsage> top;
+        ranking.take(top);
+        for (const RankedUsage& item : top)
+            writeUsage(out, item.path, item.totals, opts);
+    }
+    else if (opts.dupes)
     {
-        string path;
-        combinePath(path, callDir, subDir, Wildcard);
+        DuplicateFinder finder;
+        for (const ListRoot& root : roots)
+            finder.walk(root.path, root.globs, opts);
 
-        intptr_t fp = _findfirst(path.c_str(), &find);
-        if (fp != -1)
-        {
-            do
-            {
-                bool isSystem = !opts.system && (find.attrib & _A_SYSTEM) != 0;
-                bool skip     = !opts.all && (find.attrib & _A_HIDDEN) != 0;
+        // Hashing is mostly waiting on the disk; use every core.
+        size_t jobs = opts.jobs > 0 ? (size_t)opts.jobs : (size_t)thread::hardware_concurrency();
 
-                if (!skip && !isSystem && find.attrib & _A_SUBDIR)
-                {
-                    if (!isDotEntry(find.name))
-                        dirs.push_back(find.name);
-                }
-            } while (_findnext(fp, &find) == 0);
+        vector<DuplicateSet> sets;
+        WorkPool             pool(jobs);
+        finder.find(sets, &pool);
 
-            _findclose(fp);
-        }
+        out.put('\n');
+        for (const DuplicateSet& set : sets)
+            writeDuplicates(out, set, opts);
+        writeDuplicateReport(out, sets, opts);
     }
-
-    pathvec_t vec;
-    for (string arg : args)
+    else if (manifest)
     {
-        string subpath;
-        combinePath(subpath, callDir, subDir, arg);
+        ManifestWriter writer;
+        ManifestWalk   walk;
+
+        // Two manifests are compared without reading the tree.
+        if (opts.diffAgainst.empty() || !opts.manifestOut.empty())
+            walk.open(roots.front().path, roots.front().globs, opts);
+
+        if (!opts.manifestOut.empty())
+        {
+            if (writer.open(opts.manifestOut.c_str()))
+                walk.record(&writer);
+            else
+            {
+                out.write("failed to create the manifest ");
+                out.write(opts.manifestOut);
+                out.put('\n');
+            }
+        }
 
-        intptr_t fp = _findfirst(subpath.c_str(), &find);
-        if (fp != -1)
+        ManifestReader before, after;
+        if (opts.diffPath.empty())
         {
-            do
+            // Only writing; the walk goes to the manifest.
+            ManifestEntry ent;
+            ListReport    totals = {};
+            while (walk.next(ent))
             {
-                if (shouldBeIncluded(find, opts))
+                if ((ent.attrib & EA_DIRECTORY) != 0)
+                    totals.totalDirectories++;
+                else
                 {
-                    if (!isDotEntry(find.name))
-                    {
-                        finddata_t d = {find.name, find};
-                        maxwidth     = std::max<size_t>(d.name.size(), maxwidth);
-                        vec.push_back(d);
-                    }
+                    totals.totalFiles++;
+                    totals.totalBytes += ent.size;
                 }
-            } while (_findnext(fp, &find) == 0);
-
-            _findclose(fp);
+            }
+            writeReport(out, &totals, opts);
         }
-    }
-
-    nrfiles = nrdirs = nrbytes = 0;
-    if (!vec.empty())
-    {
-        if (opts.list)
+        else if (!before.open(opts.diffPath.c_str()))
+        {
+            out.write("failed to read the manifest ");
+            out.write(opts.diffPath);
+            out.put('\n');
+        }
+        else if (!opts.diffAgainst.empty() && !after.open(opts.diffAgainst.c_str()))
         {
-            sort(vec.begin(), vec.end(), finddata_t::sort_size);
-            writeListHeader(subDir, opts);
+            out.write("failed to read the manifest ");
+            out.write(opts.diffAgainst);
+            out.put('\n');
         }
         else
-            stable_sort(vec.begin(), vec.end());
+        {
+            ManifestSource* now = &walk;
+            if (!opts.diffAgainst.empty())
+                now = &after;
+
+            out.put('\n');
+            DiffCounts counts = diffManifests(before, *now, [&](DiffKind kind, const ManifestEntry& ent) {
+                writeDifference(out, kind, ent, opts);
+            });
+            writeDiffReport(out, counts, opts);
+
+            if (before.damaged() || after.damaged())
+                out.write("a manifest ended early; the difference is partial\n");
+        }
 
+        // Anything the diff did not read still goes to the manifest.
+        ManifestEntry rest;
+        if (!opts.manifestOut.empty())
+        {
+            while (walk.next(rest))
+                ;
+            if (!writer.close())
+            {
+                out.write("failed to write the manifest ");
+                out.write(opts.manifestOut);
+                out.put('\n');
+            }
+        }
     }
-
-    ivec_t colums;
-    calculateColumns(vec, colums, maxwidth, opts);
-
-    size_t k = 0;
-    for (i = 0; i < vec.size(); ++i)
+    else if (opts.largest > 0 || opts.globalSort)
     {
-        const finddata_t& d = vec.at(i);
+        EntryRanking  ranking(opts.largest > 0 ? (size_t)opts.largest : 0, order);
+        TreeSorter    sorter(order, opts.sortMemory);
+        ManifestEntry ent;
 
-        bool isHidden    = (d.data.attrib & _A_HIDDEN) != 0;
-        bool isDirectory = (d.data.attrib & _A_SUBDIR) != 0;
-        bool isSystem    = (d.data.attrib & _A_SYSTEM) != 0;
-
-        if (opts.list)
+        for (const ListRoot& root : roots)
         {
-            tm   tval;
-            char buf[22] = {}; 
-            if (::localtime_s(&tval, (time_t*)&d.data.time_write) == 0)
-                ::strftime(buf, 22, "%D %r", &tval);
-
-            cout << right;
-            cout << setw(SizeWidth);
-            if (isDirectory)
-            {
-                cout << ' ';  // filling SizeWidth
-                cout << ' ';
-                nrdirs++;
-            }
-            else
+            DirectoryWalk walk;
+            walk.open(root.path, root.globs, opts);
+            for (const WalkEntry& item : walk)
             {
-                setColor(CS_YELLOW);
-                string bytes;
-                getBytesString(bytes, d.data.size);
-                cout << bytes;
-
-                cout << ' ';
-                nrfiles++;
-                nrbytes += d.data.size;
+                const DirEntry& de = item.ent;
+                if (opts.largest > 0)
+                {
+                    // Only files are ranked, and most never get a path.
+                    if ((de.attrib & EA_DIRECTORY) != 0 || !ranking.accepts(de.size, de.timeWrite))
+                        continue;
+                }
+
+                ent.path.assign(root.path).append(*item.subDir).append(de.name, de.nameLen);
+                ent.size      = de.size;
+                ent.timeWrite = de.timeWrite;
+                ent.attrib    = de.attrib;
+
+                if (opts.largest > 0)
+                    ranking.add(ent);
+                else
+                    sorter.add(ent);
             }
+        }
+
+        vector<ManifestEntry> top;
+        if (opts.largest > 0)
+            ranking.take(top);
+        else if (!sorter.finish())
+        {
+            cerr << "failed to read back a sorted run from the temporary directory\n";
+            return 1;
+        }
 
-            cout << left;
-            setColor(CS_LIGHT_GREY);
-            cout << buf << ' ';
+        ListReport totals = {};
+        string     scratch;
+        if (opts.list)
+            writeListHeader(out, Empty, opts);
 
-            if (isSystem)
-                setColor(CS_MAGENTA);
-            else if (isHidden)
-                setColor(CS_GREY);
-            else if (isDirectory)
-                setColor(CS_GREEN);
-            else
-                setColor(CS_WHITE);
-            cout << d.name << '\n';
+        if (opts.largest > 0)
+        {
+            for (const ManifestEntry& item : top)
+                writeTreeEntry(out, item, opts, totals, scratch);
         }
         else
         {
-            if (isSystem)
-                setColor(CS_MAGENTA);
-            else if (isDirectory && isHidden)
-                setColor(CS_GREY);
-            else if (isDirectory)
-                setColor(CS_GREEN);
-            else if (isHidden)
-                setColor(CS_GREY);
-            else
-                setColor(CS_WHITE);
+            while (sorter.next(ent))
+                writeTreeEntry(out, ent, opts, totals, scratch);
 
-            string name;
-            makeName(name, subDir, d.name, opts);
-            if (!opts.byline)
+            if (sorter.failed())
             {
-                size_t col = k++ % colums.size();
-                cout << left;
-                cout << setw(colums.at(col) + 1);
-                cout << name << ' ';
-                if (col == colums.size() - 1)
-                    cout << '\n';
+                out.flush();
+                cerr << "a sorted run was cut short; the listing is incomplete\n";
+                return 1;
             }
-            else
-                cout << name << '\n';
         }
+        finishDirectory(out, totals, true, opts, result);
     }
-
-    if (rept)
+    else if (opts.jobs > 0 && !opts.stream)
     {
-        rept->totalDirectories += nrdirs;
-        rept->totalFiles += nrfiles;
-        rept->totalBytes += nrbytes;
+        WorkPool pool((size_t)opts.jobs);
+        listRoots(out, roots, opts, result, &pool);
     }
+    else
+        listRoots(out, roots, opts, result, nullptr);
 
-    if (opts.list)
+    if (opts.index && !index.save())
     {
-        if (!vec.empty())
-            writeListFooter(nrbytes, nrfiles, nrdirs);
+        out.write("failed to write the index ");
+        out.write(opts.indexPath);
+        out.put('\n');
     }
 
-    if (opts.recursive)
+    if (result)
+        writeReport(out, result, opts);
+
+#ifdef LS_STATS
+    // Kept off standard output, which may hold records.
+    if (opts.stats)
     {
-        for (string dir : dirs)
+        out.flush();
+
+        string text;
         {
-            string path;
-            combinePath(path, subDir, dir, Empty);
-            listAll(callDir, path, args, opts, rept);
+            Output report(text);
+            report.colorLike(out);
+            writeStats(report, out);
         }
+        cerr << text;
     }
-
-    setColor(CS_WHITE);
+    if (!writeTrace())
+        cerr << "failed to write the trace " << opts.tracePath << '\n';
+#endif
+    if (opts.format == RF_TEXT)
+        out.put('\n');
+    out.flush();
+    return 0;
 }
 
+
 void help()
 {
     cout << "\nA simple list directory utility for the Windows command line.\n\n";
@@ -495,282 +624,257 @@ void help()
     cout << "    -m  add a comma after each entry.\n";
     cout << "    -q  surround entries in quotations.\n";
     cout << "    -R  list recursively.\n";
+    cout << "    -j  N read directories with N threads. used with the -R option.\n";
     cout << "    -l  list the file size, last write time and the file name.\n";
     cout << "    -S  build a short path name. used with the -x and the -l options.\n";
+    cout << "    -U  do not sort; list entries in directory order.\n";
+    cout << "    -r  reverse the sort order. directories are still listed first.\n";
+    cout << "    -H  show sizes as 1.5K, 12M, 3.1G. used with the -l option.\n";
     cout << "    -h  show this help message.\n";
     cout << "\n";
+    cout << "    --ignore-case  match wild-cards without regard to case (default on Windows).\n";
+    cout << "    --match-case   match wild-cards with regard to case.\n";
+    cout << "    --stream       write entries as they are read, without sorting or\n";
+    cout << "                   holding the directory in memory (default with -x -U).\n";
+    cout << "    --format=FMT   write records as ndjson, nul or bin for scripts. entries\n";
+    cout << "                   keep directory order unless --sort is given.\n";
+    cout << "    --sort=KEY     sort by name, size, time, ext or none. the default is\n";
+    cout << "                   size with -l, otherwise directories first.\n";
+    cout << "    --time-style=STYLE\n";
+    cout << "                   write times as default (10/16/26 08:12:50 PM) or\n";
+    cout << "                   iso (2026-10-16T20:12:50). used with the -l option.\n";
+    cout << "    --du           total the bytes, files and directories below every\n";
+    cout << "                   directory in one pass, children before parents.\n";
+    cout << "    --depth=N      with --du, only print directories up to N levels down.\n";
+    cout << "    --top=N        with --du, print the N largest directories instead.\n";
+    cout << "    --dupes        find files with the same contents below the paths given,\n";
+    cout << "                   and the bytes removing the copies would win back.\n";
+    cout << "    --largest=N    list the N largest files of the tree below the paths given.\n";
+    cout << "    --newest=N     list the N files of the tree written last.\n";
+    cout << "    --global-sort  sort the whole tree at once by the --sort key, instead of\n";
+    cout << "                   each directory on its own.\n";
+    cout << "    --sort-memory=N\n";
+    cout << "                   with --global-sort, spill sorted runs to temporary files\n";
+    cout << "                   past N bytes (64M by default). N may end with K, M or G.\n";
+    cout << "    --type=TYPES   only list files (f), directories (d) or links (l).\n";
+    cout << "    --min-size=N   only list entries of at least N bytes. N may end with\n";
+    cout << "                   K, M, G or T.\n";
+    cout << "    --max-size=N   only list entries of at most N bytes.\n";
+    cout << "    --newer=TIME   only list entries written after TIME, an age (30m, 12h,\n";
+    cout << "                   2d, 1w) or a date (2026-10-16 or 2026-10-16T20:12).\n";
+    cout << "    --older=TIME   only list entries written before TIME.\n";
+    cout << "    --name-regex=RE\n";
+    cout << "                   only list entries with a name that RE matches part of.\n";
+    cout << "    --exclude=GLOB leave out entries that match GLOB, and with -R all that is\n";
+    cout << "                   below them. may be given more than once.\n";
+    cout << "    --max-depth=N  list recursively, at most N directories down.\n";
+    cout << "    --ignore-file[=NAME]\n";
+    cout << "                   leave out what the NAME file of each directory ignores,\n";
+    cout << "                   with gitignore rules. NAME is .gitignore by default.\n";
+    cout << "    --manifest-out=FILE\n";
+    cout << "                   write the size, time and attributes of everything below\n";
+    cout << "                   the first path to FILE, sorted by path.\n";
+    cout << "    --diff=FILE    list what was added (+), removed (-) or modified (~) below\n";
+    cout << "                   the first path since the manifest FILE was written. given\n";
+    cout << "                   twice, compares the two manifests instead.\n";
+    cout << "    --stats        print time per phase, counts, system calls, allocations\n";
+    cout << "                   and peak memory to standard error after the listing.\n";
+    cout << "    --trace=FILE   write a Chrome trace with a span for every directory\n";
+    cout << "                   read, for chrome://tracing or ui.perfetto.dev.\n";
+    cout << "    --index=PATH   keep a snapshot of each directory in PATH and reuse it\n";
+    cout << "                   while the directory is unchanged.\n";
+    cout << "    --serve=SOCKET watch the tree and answer requests on SOCKET (Linux).\n";
+    cout << "    --query=SOCKET send the remaining arguments as a request: LIST [path]\n";
+    cout << "                   or TOTALS [path].\n";
+    cout << "\n";
     exit(0);
 }
 
+#ifdef _WIN32
 BOOL WINAPI CtrlCallback(DWORD evt)
 {
     if (evt == CTRL_C_EVENT || evt == CTRL_BREAK_EVENT)
     {
         // To prevent lingering colors.
-        setColor(CS_WHITE);
+        Output::resetConsole();
         ExitProcess(0);
         return 1;
     }
     return 0;
 }
-
-void getBytesString(string&        dest,
-                    const uint64_t val)
+#else
+void CtrlCallback(int)
 {
-    stringstream ss;
-    ss << val;
-    dest.clear();
-
-    string tmp = ss.str();
-    size_t i, s = tmp.size(); 
-    if (s > 3)
-    {
-        size_t k = s % 3;
-        size_t j = k == 0 ? 1 : 0;
-        for (i = 0; i < s; ++i)
-        {
-            if (i+1 >= k)
-            {
-                dest.push_back(tmp[i]);
-                if (j % 3 == 0 && (i+1) < s)
-                    dest.push_back(',');
-                j++;
-            }
-            else
-                dest.push_back(tmp[i]);
-        }
-    }
-    else
-        dest = tmp;
+    // To prevent lingering colors.
+    Output::resetConsole();
+    ::_exit(0);
 }
+#endif
 
-void calculateColumns(pathvec_t& vec, ivec_t& iv, const size_t maxWidth, const Options& opts)
+bool isWildcard(const string& arg)
 {
-    size_t s = vec.size(), i, j, nrCol;
-
-    if (maxWidth < opts.winWidth && maxWidth > 0)
-        nrCol = opts.winWidth / maxWidth;
-    else
-        nrCol = 1;
-
-    iv = ivec_t(nrCol, 0);
-    for (i = 0; i < s; ++i)
-    {
-        const finddata_t& d = vec.at(i);
-
-        j = i % nrCol;
-
-        iv[j] = max<size_t>(iv[j], d.name.size());
-    }
+    return arg.find(DefaultWildcard) != string::npos ||
+           arg.find(AnyCharacter) != string::npos;
 }
 
-void makeName(string& dest, const string& subDir, const string& name, const Options& opts)
+bool parseLongOption(int argc, char** argv, size_t& i, Options& opts)
 {
-    if (opts.byline)
-        dest = subDir + name;
-    else
-        dest = name;
+    string name = argv[i] + 2, value;
 
-    if (opts.shortpath && dest.find(' ') != string::npos)
+    size_t eq = name.find('=');
+    if (eq != string::npos)
     {
-        string search = subDir + SeperatorWin + name;
-
-        size_t len = (size_t)::GetShortPathName(search.c_str(), nullptr, 0);
-        if (len > 0)
-        {
-            char* tmp = new char[len + 1];
-
-            size_t nlen = (size_t)::GetShortPathName(search.c_str(), tmp, (DWORD)len);
-            if (nlen != 0 && nlen <= len)
-            {
-                tmp[nlen] = 0;
-
-                dest = tmp;
-                if (!opts.byline)
-                {
-                    string pth;
-                    splitPath(dest, pth, dest);
-                }
-            }
-            delete[] tmp;
-        }
+        value = name.substr(eq + 1);
+        name  = name.substr(0, eq);
     }
 
-    if (opts.quote)
-        dest = "\"" + dest + "\"";
-
-    if (opts.comma)
-        dest.push_back(',');
-}
-
-bool shouldBeIncluded(const _finddata_t& val, const Options& opts)
-{
-    if (!opts.all && (val.attrib & _A_HIDDEN) != 0)
-        return false;
-    if (!opts.system && (val.attrib & _A_SYSTEM) != 0)
-        return false;
-    if (opts.dirOnly && !(val.attrib & _A_SUBDIR))
-        return false;
-    if (opts.fileOnly && (val.attrib & _A_SUBDIR) != 0)
-        return false;
-    return true;
-}
-
-void splitPath(const string& input,
-               string&       path,
-               string&       ptrn)
-{
-    size_t pos = input.find_last_of(SeperatorWin);
-    if (pos != string::npos)
+    if (name == "ignore-case")
+        opts.ignoreCase = true;
+    else if (name == "match-case")
+        opts.ignoreCase = false;
+    else if (name == "stream")
+        opts.stream = true;
+    else if (name == "index" || name == "serve" || name == "query")
     {
-        path = input.substr(0, pos + 1);
-        ptrn = input.substr(pos + 1, input.size());
+        if (value.empty() && i + 1 < (size_t)argc)
+            value = argv[++i];
+        if (value.empty())
+            return false;
+
+        if (name == "index")
+            opts.indexPath = value;
+        else if (name == "serve")
+            opts.servePath = value;
+        else
+            opts.queryPath = value;
     }
-    else
+    else if (name == "format")
+        return parseRecordFormat(value.c_str(), opts.format);
+    else if (name == "time-style")
+        return parseTimeStyle(value.c_str(), opts.timeStyle);
+#ifdef LS_STATS
+    else if (name == "stats")
+        opts.stats = true;
+    else if (name == "trace")
     {
-        path = Empty;
-        ptrn = input;
+        if (value.empty() && i + 1 < (size_t)argc)
+            value = argv[++i];
+        if (value.empty())
+            return false;
+        opts.tracePath = value;
     }
-}
-
-void normalizePath(string&       dest,
-                   const string& input)
-{
-    dest = input;
-    size_t pos;
-    while ((pos = dest.find(SeperatorNx)) != string::npos)
-        dest = dest.replace(pos, 1, &SeperatorWin);
-}
-
-void combinePath(string&       dest,
-                 const string& path,
-                 const string& subpath,
-                 const string& search)
-{
-    dest = path;
-    if (!dest.empty())
+#endif
+    else if (name == "du")
+        opts.usage = true;
+    else if (name == "dupes")
+        opts.dupes = true;
+    else if (name == "global-sort")
+        opts.globalSort = true;
+    else if (name == "largest" || name == "newest")
     {
-        if (dest.back() != SeperatorWin)
-            dest.push_back(SeperatorWin);
-    }
-
-    if (!subpath.empty())
-        dest += subpath;
+        if (value.empty() && i + 1 < (size_t)argc)
+            value = argv[++i];
 
-    if (!dest.empty())
-    {
-        if (dest.back() != SeperatorWin)
-            dest.push_back(SeperatorWin);
+        // A count of zero would read as the option being off.
+        if (!parseNumber(value, opts.largest) || opts.largest == 0)
+            return false;
+        opts.largestKey = name == "largest" ? SK_SIZE : SK_TIME;
     }
+    else if (name == "sort-memory")
+    {
+        if (value.empty() && i + 1 < (size_t)argc)
+            value = argv[++i];
 
-    if (!search.empty())
+        int64_t bytes;
+        if (!parseSize(value, bytes) || bytes <= 0)
+            return false;
+        opts.sortMemory = (uint64_t)bytes;
+    }
+    else if (name == "manifest-out" || name == "diff")
     {
-        if (search.front() == SeperatorWin)
-            dest += search.substr(1, search.size());
+        if (value.empty() && i + 1 < (size_t)argc)
+            value = argv[++i];
+        if (value.empty())
+            return false;
+
+        if (name == "manifest-out")
+            opts.manifestOut = value;
+        else if (opts.diffPath.empty())
+            opts.diffPath = value;
         else
-            dest += search;
+            opts.diffAgainst = value;
     }
-}
+    else if (name == "depth" || name == "top")
+    {
+        if (value.empty() && i + 1 < (size_t)argc)
+            value = argv[++i];
+        if (!parseNumber(value, name == "depth" ? opts.usageDepth : opts.usageTop))
+            return false;
 
-void writeListHeader(const string& directory, const Options& opts)
-{
-    if (!directory.empty())
+        opts.usage = true;
+    }
+    else if (name == "exclude")
     {
-        setColor(CS_DARKGREEN);
-        cout << '\n';
-        string dir;
-        makeName(dir, directory, Empty, opts);
-        cout << dir << '\n';
+        if (value.empty() && i + 1 < (size_t)argc)
+            value = argv[++i];
+        if (value.empty())
+            return false;
+        opts.exclude.add(value);
     }
-    setColor(CS_LIGHT_GREY);
-    cout << '\n';
-    cout << setw(SizeLabelCenter) << ' ' << SizeInBytes << setw(LastModCenter) << ' ';
-    cout << LastUsed << setw(NameLeft) << ' ';
-    cout << FileName;
-    cout << '\n';
-    cout << '\n';
-}
-
-void writeReport(ListReport* rept)
-{
-    cout << '\n';
-    setColor(CS_WHITE);
-    cout << Found;
-    setColor(CS_YELLOW);
-    cout << '\n';
-
-    string bytes;
-    getBytesString(bytes, rept->totalBytes);
-    cout << right << bytes;
-    setColor(CS_DARKYELLOW);
-    cout << ' ' << Bytes;
-    setColor(CS_WHITE);
-
-    cout << right << ' ' << rept->totalFiles << Files;
-    if (rept->totalDirectories != 0)
+    else if (name == "max-depth")
     {
-        cout << And;
-        if (rept->totalDirectories > 1)
-            cout << rept->totalDirectories << Directories;
-        else
-            cout << rept->totalDirectories << Directory;
+        if (value.empty() && i + 1 < (size_t)argc)
+            value = argv[++i];
+        if (!parseNumber(value, opts.maxDepth))
+            return false;
+
+        // A limit on depth only means something with -R.
+        opts.byline      = true;
+        opts.recursive   = true;
+        opts.hasMaxDepth = true;
     }
-    cout << '\n';
-}
-
-void writeListFooter(size_t sizeInBytes, size_t files, size_t dirs)
-{
-    setColor(CS_YELLOW);
-    cout << '\n';
-
-    string bytes;
-    getBytesString(bytes, sizeInBytes);
-
-    cout << right << setw(SizeWidth) << bytes;
-    setColor(CS_DARKYELLOW);
-
-    cout << ' ' << Bytes;
-    setColor(CS_WHITE);
-    cout << right << setw(16) << ' ' << files << Files;
-    if (dirs != 0)
+    else if (name == "ignore-file")
+        opts.ignoreFile = value.empty() ? DefaultIgnoreFile : value;
+    else if (name == "type" || name == "min-size" || name == "max-size" ||
+             name == "newer" || name == "older" || name == "name-regex")
     {
-        cout << And;
-        if (dirs > 1)
-            cout << dirs << Directories;
-        else
-            cout << dirs << Directory;
+        if (value.empty() && i + 1 < (size_t)argc)
+            value = argv[++i];
+        return opts.filter.add(name, value);
     }
-    cout << '\n';
+    else if (name == "sort")
+    {
+        if (!parseSortKey(value.c_str(), opts.sortKey))
+            return false;
+        opts.hasSortKey = true;
+    }
+    else
+        return false;
+    return true;
 }
 
-
-void setColor(int fg, int bg)
+bool parseNumber(const string& value, int& dest)
 {
-    if (fg < 0 || fg > CS_COLOR_MAX || bg < 0 || bg > CS_COLOR_MAX)
-        return;
-    ::SetConsoleTextAttribute(::GetStdHandle(STD_OUTPUT_HANDLE), getColor(fg, bg));
+    const char* cp = value.c_str();
+    int64_t     val;
+    if (!parseCount(cp, val) || *cp != '\0' || val > INT_MAX)
+        return false;
+
+    dest = (int)val;
+    return true;
 }
 
-const unsigned char COLOR_TABLE[16][16] = {
-    {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F},
-    {0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F},
-    {0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F},
-    {0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F},
-    {0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F},
-    {0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x5B, 0x5C, 0x5D, 0x5E, 0x5F},
-    {0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F},
-    {0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x7B, 0x7C, 0x7D, 0x7E, 0x7F},
-    {0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x8B, 0x8C, 0x8D, 0x8E, 0x8F},
-    {0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0x9B, 0x9C, 0x9D, 0x9E, 0x9F},
-    {0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xAB, 0xAC, 0xAD, 0xAE, 0xAF},
-    {0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xBB, 0xBC, 0xBD, 0xBE, 0xBF},
-    {0xC0, 0xC1, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xCB, 0xCC, 0xCD, 0xCE, 0xCF},
-    {0xD0, 0xD1, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xDB, 0xDC, 0xDD, 0xDE, 0xDF},
-    {0xE0, 0xE1, 0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xEB, 0xEC, 0xED, 0xEE, 0xEF},
-    {0xF0, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF},
-};
-
-unsigned char getColor(int fore, int back)
+void addRoot(rootvec_t& roots, const string& path, const string& pattern)
 {
-    return COLOR_TABLE[back][fore];
+    for (ListRoot& root : roots)
+    {
+        if (root.path == path)
+        {
+            root.globs.add(pattern);
+            return;
+        }
+    }
+    roots.push_back(ListRoot());
+    roots.back().path = path;
+    roots.back().globs.add(pattern);
 }
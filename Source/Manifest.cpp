@@ -0,0 +1,304 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Manifest.h"
+#include "DirectoryReader.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+// File layout:
+//
+//  ManifestHeader
+//  one record per entry, in path order:
+//      number shared     bytes in common with the path before it
+//      number suffixLen
+//      char   suffix[suffixLen]
+//      number size
+//      number timeWrite  zigzag encoded
+//      number attrib
+//
+// Numbers are unsigned LEB128, seven bits to a byte, low bits first.
+const char     ManifestMagic[8] = {'L', 'S', 'M', 'A', 'N', 'I', 'F', '\0'};
+const uint32_t ManifestVersion  = 1;
+const size_t   WriteBufferSize  = 256 * 1024;
+
+struct ManifestHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t entries;
+};
+
+static inline unsigned char foldByte(unsigned char ch, bool ignoreCase)
+{
+    if (ignoreCase && ch >= 'A' && ch <= 'Z')
+        return (unsigned char)(ch - 'A' + 'a');
+    return ch;
+}
+
+int comparePaths(const string& a, const string& b, bool ignoreCase)
+{
+    size_t i, n = min(a.size(), b.size());
+    for (i = 0; i < n; ++i)
+    {
+        unsigned char ca = foldByte((unsigned char)a[i], ignoreCase);
+        unsigned char cb = foldByte((unsigned char)b[i], ignoreCase);
+        if (ca == cb)
+            continue;
+        if (ca == (unsigned char)Seperator)
+            return -1;
+        if (cb == (unsigned char)Seperator)
+            return 1;
+        return ca < cb ? -1 : 1;
+    }
+    if (a.size() == b.size())
+        return 0;
+    return a.size() < b.size() ? -1 : 1;
+}
+
+ManifestWriter::ManifestWriter() :
+    m_file(nullptr),
+    m_count(0),
+    m_failed(false)
+{
+}
+
+ManifestWriter::~ManifestWriter()
+{
+    if (m_file)
+    {
+        fclose(m_file);
+        remove((m_path + ".tmp").c_str());
+    }
+}
+
+bool ManifestWriter::open(const char* path)
+{
+    m_path   = path;
+    m_count  = 0;
+    m_failed = false;
+    m_last.clear();
+
+    m_file = fopen((m_path + ".tmp").c_str(), "wb");
+    if (!m_file)
+        return false;
+    setvbuf(m_file, nullptr, _IOFBF, WriteBufferSize);
+
+    // The count is filled in on close.
+    ManifestHeader header = {};
+    put(&header, sizeof header);
+    return !m_failed;
+}
+
+void ManifestWriter::put(const void* data, size_t len)
+{
+    if (!m_failed && fwrite(data, 1, len, m_file) != len)
+        m_failed = true;
+}
+
+void ManifestWriter::putNumber(uint64_t val)
+{
+    unsigned char buf[10];
+    size_t        len = 0;
+    while (val >= 0x80)
+    {
+        buf[len++] = (unsigned char)(val | 0x80);
+        val >>= 7;
+    }
+    buf[len++] = (unsigned char)val;
+    put(buf, len);
+}
+
+void ManifestWriter::add(const ManifestEntry& ent)
+{
+    if (!m_file)
+        return;
+
+    size_t shared = 0, n = min(m_last.size(), ent.path.size());
+    while (shared < n && m_last[shared] == ent.path[shared])
+        ++shared;
+
+    putNumber(shared);
+    putNumber(ent.path.size() - shared);
+    put(ent.path.data() + shared, ent.path.size() - shared);
+    putNumber(ent.size);
+    putNumber((uint64_t)ent.timeWrite << 1 ^ (uint64_t)(ent.timeWrite >> 63));
+    putNumber(ent.attrib);
+
+    m_last.assign(ent.path);
+    m_count++;
+}
+
+bool ManifestWriter::close()
+{
+    if (!m_file)
+        return false;
+
+    ManifestHeader header = {};
+    memcpy(header.magic, ManifestMagic, sizeof ManifestMagic);
+    header.version = ManifestVersion;
+    header.entries = m_count;
+
+    if (fseek(m_file, 0, SEEK_SET) != 0)
+        m_failed = true;
+    put(&header, sizeof header);
+
+    bool   ok  = fclose(m_file) == 0 && !m_failed;
+    string tmp = m_path + ".tmp";
+    m_file     = nullptr;
+
+    if (ok)
+        ok = replaceFile(tmp.c_str(), m_path.c_str());
+    if (!ok)
+        remove(tmp.c_str());
+    return ok;
+}
+
+ManifestReader::ManifestReader() :
+    m_pos(nullptr),
+    m_end(nullptr),
+    m_count(0),
+    m_read(0)
+{
+}
+
+bool ManifestReader::open(const char* path)
+{
+    m_pos   = nullptr;
+    m_end   = nullptr;
+    m_count = 0;
+    m_read  = 0;
+    m_last.clear();
+
+    if (!m_file.open(path))
+        return false;
+
+    const ManifestHeader* header = (const ManifestHeader*)m_file.data();
+    if (m_file.size() < sizeof(ManifestHeader) ||
+        memcmp(header->magic, ManifestMagic, sizeof ManifestMagic) != 0 ||
+        header->version != ManifestVersion)
+    {
+        m_file.close();
+        return false;
+    }
+
+    m_pos   = m_file.data() + sizeof(ManifestHeader);
+    m_end   = m_file.data() + m_file.size();
+    m_count = header->entries;
+    return true;
+}
+
+bool ManifestReader::number(uint64_t& dest)
+{
+    dest = 0;
+    for (int shift = 0; m_pos < m_end && shift < 64; shift += 7)
+    {
+        unsigned char ch = (unsigned char)*m_pos++;
+        dest |= (uint64_t)(ch & 0x7F) << shift;
+        if ((ch & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool ManifestReader::next(ManifestEntry& dest)
+{
+    if (m_read >= m_count)
+        return false;
+
+    uint64_t shared, suffix, size, time, attrib;
+    if (!number(shared) || !number(suffix) || shared > m_last.size() ||
+        suffix > (uint64_t)(m_end - m_pos))
+    {
+        // A damaged record ends the manifest.
+        m_pos = m_end;
+        return false;
+    }
+
+    m_last.resize((size_t)shared);
+    m_last.append(m_pos, (size_t)suffix);
+    m_pos += suffix;
+
+    if (!number(size) || !number(time) || !number(attrib))
+    {
+        m_pos = m_end;
+        return false;
+    }
+
+    dest.path      = m_last;
+    dest.size      = size;
+    dest.timeWrite = (int64_t)(time >> 1 ^ (0 - (time & 1)));
+    dest.attrib    = (uint32_t)attrib;
+    m_read++;
+    return true;
+}
+
+bool isModified(const ManifestEntry& before, const ManifestEntry& after)
+{
+    if (before.attrib != after.attrib)
+        return true;
+    if ((after.attrib & EA_DIRECTORY) != 0)
+        return false;
+    return before.size != after.size || before.timeWrite != after.timeWrite;
+}
+
+DiffCounts diffManifests(ManifestSource& before, ManifestSource& after, const DiffVisit& visit)
+{
+    DiffCounts    counts = {};
+    ManifestEntry a, b;
+
+    bool hasA = before.next(a);
+    bool hasB = after.next(b);
+    while (hasA || hasB)
+    {
+        int cmp = !hasA ? 1 : !hasB ? -1 : comparePaths(a.path, b.path);
+        if (cmp < 0)
+        {
+            counts.removed++;
+            visit(DK_REMOVED, a);
+            hasA = before.next(a);
+        }
+        else if (cmp > 0)
+        {
+            counts.added++;
+            visit(DK_ADDED, b);
+            hasB = after.next(b);
+        }
+        else
+        {
+            if (isModified(a, b))
+            {
+                counts.modified++;
+                visit(DK_MODIFIED, b);
+            }
+            hasA = before.next(a);
+            hasB = after.next(b);
+        }
+    }
+    return counts;
+}
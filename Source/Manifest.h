@@ -0,0 +1,159 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _Manifest_h_
+#define _Manifest_h_
+
+#include "Platform.h"
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+
+// One entry of a manifest. The path is relative to the root of the
+// tree, with the separators of the platform that wrote it.
+struct ManifestEntry
+{
+    std::string path;
+    uint64_t    size;
+    int64_t     timeWrite;  // nanoseconds since 1970-01-01 UTC
+    uint32_t    attrib;
+};
+
+// Orders paths the way a manifest holds them: by component, so that a
+// directory is followed by everything below it before its next sibling.
+// The separator sorts before any other byte. With ignoreCase, ASCII
+// letters compare as lower case.
+int comparePaths(const std::string& a, const std::string& b, bool ignoreCase = false);
+
+// Yields manifest entries in path order.
+class ManifestSource
+{
+public:
+    virtual ~ManifestSource()
+    {
+    }
+
+    // Fills dest with the next entry. Returns false at the end.
+    virtual bool next(ManifestEntry& dest) = 0;
+};
+
+// Writes a manifest, one entry at a time in path order.
+//
+// Each path only stores what differs from the path before it, and all
+// numbers are variable length, so an entry in a deep tree takes a few
+// bytes more than its name. The file is written to a temporary and
+// renamed over path on close.
+class ManifestWriter
+{
+private:
+    FILE*       m_file;
+    std::string m_path;
+    std::string m_last;
+    uint64_t    m_count;
+    bool        m_failed;
+
+    void put(const void* data, size_t len);
+    void putNumber(uint64_t val);
+
+public:
+    ManifestWriter();
+    ~ManifestWriter();
+
+    ManifestWriter(const ManifestWriter&) = delete;
+    ManifestWriter& operator=(const ManifestWriter&) = delete;
+
+    bool open(const char* path);
+    void add(const ManifestEntry& ent);
+
+    // Returns false if any of it could not be written.
+    bool close();
+};
+
+// Reads a manifest straight from a mapping of the file, so only the
+// entry being decoded is held in memory.
+class ManifestReader : public ManifestSource
+{
+private:
+    MappedFile  m_file;
+    const char* m_pos;
+    const char* m_end;
+    uint64_t    m_count;
+    uint64_t    m_read;
+    std::string m_last;
+
+    bool number(uint64_t& dest);
+
+public:
+    ManifestReader();
+
+    // Fails if path is not a manifest. An empty tree
+    // still has a header, so it opens.
+    bool open(const char* path);
+
+    bool next(ManifestEntry& dest) override;
+
+    uint64_t entries() const
+    {
+        return m_count;
+    }
+
+    // True if the file ended before all of its entries were read.
+    bool damaged() const
+    {
+        return m_read < m_count;
+    }
+};
+
+enum DiffKind
+{
+    DK_ADDED = 0,
+    DK_REMOVED,
+    DK_MODIFIED,
+};
+
+struct DiffCounts
+{
+    uint64_t added;
+    uint64_t removed;
+    uint64_t modified;
+};
+
+// Called with the entry after the change, or before it if removed.
+typedef std::function<void(DiffKind kind, const ManifestEntry& ent)> DiffVisit;
+
+// True if an entry with the same path changed. A directory only
+// changes by becoming something else; its own size and time follow
+// the entries in it, and those are compared on their own.
+bool isModified(const ManifestEntry& before, const ManifestEntry& after);
+
+// Merges two sources in path order, calling visit for every entry
+// added, removed or modified between before and after. Only the
+// current entry of each side is held.
+DiffCounts diffManifests(ManifestSource&  before,
+                         ManifestSource&  after,
+                         const DiffVisit& visit);
+
+#endif  //_Manifest_h_
@@ -0,0 +1,303 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Output.h"
+#include <chrono>
+#include <charconv>
+#include <system_error>
+#ifdef _WIN32
+#include <windows.h>
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// SGR foreground codes in Colors order.
+const int ANSI_TABLE[16] = {30, 34, 32, 36, 31, 35, 33, 37, 90, 94, 92, 96, 91, 95, 93, 97};
+
+// The longest sequence is ESC [ 0 ; 97 ; 107 m.
+const size_t SgrBufferSize = 32;
+
+static uint64_t ticks()
+{
+    return (uint64_t)chrono::steady_clock::now().time_since_epoch().count();
+}
+
+Output::Output() :
+    m_buffer(new char[BufferSize]),
+    m_used(0),
+    m_mode(CM_NONE),
+    m_terminal(false),
+    m_fore(-1),
+    m_back(-1),
+    m_bytes(0),
+    m_writes(0),
+    m_writeTicks(0),
+    m_created(ticks()),
+    m_firstWrite(0),
+    m_sink(nullptr),
+    m_stream(nullptr)
+{
+#ifdef _WIN32
+    HANDLE handle = ::GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD  mode   = 0;
+    if (::GetConsoleMode(handle, &mode))
+    {
+        m_terminal = true;
+        if (::SetConsoleMode(handle, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING))
+            m_mode = CM_VT;
+        else
+            m_mode = CM_CONSOLE;
+    }
+#else
+    if (::isatty(STDOUT_FILENO))
+    {
+        m_terminal = true;
+        m_mode     = CM_VT;
+    }
+#endif
+}
+
+Output::Output(string& sink) :
+    m_buffer(new char[BufferSize]),
+    m_used(0),
+    m_mode(CM_NONE),
+    m_terminal(false),
+    m_fore(-1),
+    m_back(-1),
+    m_bytes(0),
+    m_writes(0),
+    m_writeTicks(0),
+    m_created(ticks()),
+    m_firstWrite(0),
+    m_sink(&sink),
+    m_stream(nullptr)
+{
+}
+
+Output::Output(OutputSink& sink) :
+    m_buffer(new char[BufferSize]),
+    m_used(0),
+    m_mode(CM_NONE),
+    m_terminal(false),
+    m_fore(-1),
+    m_back(-1),
+    m_bytes(0),
+    m_writes(0),
+    m_writeTicks(0),
+    m_created(ticks()),
+    m_firstWrite(0),
+    m_sink(nullptr),
+    m_stream(&sink)
+{
+}
+
+Output::~Output()
+{
+    flush();
+    delete[] m_buffer;
+}
+
+void Output::setColor(int fore, int back)
+{
+    if (m_mode == CM_NONE)
+        return;
+    if (fore < 0 || fore >= CS_COLOR_MAX || back < 0 || back >= CS_COLOR_MAX)
+        return;
+    if (fore == m_fore && back == m_back)
+        return;
+
+    m_fore = fore;
+    m_back = back;
+    writeColor(fore, back);
+}
+
+void Output::writeColor(int fore, int back)
+{
+    if (m_mode == CM_CONSOLE)
+    {
+#ifdef _WIN32
+        flush();
+        ::SetConsoleTextAttribute(::GetStdHandle(STD_OUTPUT_HANDLE),
+                                  (WORD)(back << 4 | fore));
+#endif
+        return;
+    }
+
+    // White on black is the console default, so it
+    // resets to the terminal's own colors.
+    if (fore == CS_WHITE && back == CS_BLACK)
+    {
+        write("\x1b[0m", 4);
+        return;
+    }
+
+    char  buf[SgrBufferSize];
+    char* end = buf + sizeof buf - 1;
+    char* cp  = buf;
+    *cp++     = '\x1b';
+    *cp++     = '[';
+    *cp++     = '0';
+    *cp++     = ';';
+
+    to_chars_result res = to_chars(cp, end, ANSI_TABLE[fore]);
+    if (res.ec != errc())
+        return;
+    cp = res.ptr;
+
+    if (back != CS_BLACK)
+    {
+        *cp++ = ';';
+        res   = to_chars(cp, end, ANSI_TABLE[back] + 10);
+        if (res.ec != errc())
+            return;
+        cp = res.ptr;
+    }
+    *cp++ = 'm';
+    write(buf, (size_t)(cp - buf));
+}
+
+void Output::pad(size_t count, char ch)
+{
+    while (count > 0)
+    {
+        if (m_used >= BufferSize)
+            flush();
+
+        size_t n = min(count, BufferSize - m_used);
+        memset(m_buffer + m_used, ch, n);
+        m_used += n;
+        count -= n;
+    }
+}
+
+void Output::writeNumber(uint64_t val)
+{
+    char buf[24];
+    write(buf, (size_t)(to_chars(buf, buf + sizeof buf, val).ptr - buf));
+}
+
+void Output::writeSigned(int64_t val)
+{
+    char buf[24];
+    write(buf, (size_t)(to_chars(buf, buf + sizeof buf, val).ptr - buf));
+}
+
+void Output::writeLeft(const string& str, size_t width)
+{
+    write(str);
+    if (str.size() < width)
+        pad(width - str.size());
+}
+
+void Output::writeRight(const string& str, size_t width)
+{
+    writeRight(str.data(), str.size(), width);
+}
+
+void Output::writeRight(const char* str, size_t len, size_t width)
+{
+    if (len < width)
+        pad(width - len);
+    write(str, len);
+}
+
+void Output::flush()
+{
+    if (m_used > 0)
+        drain(m_buffer, m_used);
+    m_used = 0;
+}
+
+void Output::drain(const char* data, size_t len)
+{
+    uint64_t start = ticks();
+    if (m_firstWrite == 0)
+        m_firstWrite = start;
+
+    if (m_sink || m_stream)
+    {
+        if (m_sink)
+            m_sink->append(data, len);
+        else
+            m_stream->write(data, len);
+        m_bytes += len;
+        m_writes++;
+        m_writeTicks += ticks() - start;
+        return;
+    }
+
+    while (len > 0)
+    {
+#ifdef _WIN32
+        DWORD written = 0;
+        DWORD chunk   = (DWORD)min<size_t>(len, 0x40000000);
+        if (!::WriteFile(::GetStdHandle(STD_OUTPUT_HANDLE), data, chunk, &written, nullptr) || written == 0)
+            break;
+#else
+        ssize_t written = ::write(STDOUT_FILENO, data, len);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+#endif
+        data += written;
+        len -= (size_t)written;
+        m_bytes += (uint64_t)written;
+        m_writes++;
+    }
+    m_writeTicks += ticks() - start;
+}
+
+double Output::writeSeconds() const
+{
+    typedef chrono::steady_clock::duration dur_t;
+    return chrono::duration<double>(dur_t(m_writeTicks)).count();
+}
+
+double Output::firstWriteSeconds() const
+{
+    typedef chrono::steady_clock::duration dur_t;
+    if (m_firstWrite == 0)
+        return -1;
+    return chrono::duration<double>(dur_t(m_firstWrite - m_created)).count();
+}
+
+void Output::resetConsole()
+{
+#ifdef _WIN32
+    ::SetConsoleTextAttribute(::GetStdHandle(STD_OUTPUT_HANDLE), (WORD)CS_WHITE);
+#else
+    if (::isatty(STDOUT_FILENO))
+        (void)!::write(STDOUT_FILENO, "\x1b[0m", 4);
+#endif
+}
@@ -0,0 +1,225 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _Output_h_
+#define _Output_h_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+enum Colors
+{
+    CS_BLACK = 0,
+    CS_DARKBLUE,
+    CS_DARKGREEN,
+    CS_DARKCYAN,
+    CS_DARKRED,
+    CS_DARKMAGENTA,
+    CS_DARKYELLOW,
+    CS_LIGHT_GREY,
+    CS_GREY,
+    CS_BLUE,
+    CS_GREEN,
+    CS_CYAN,
+    CS_RED,
+    CS_MAGENTA,
+    CS_YELLOW,
+    CS_WHITE,
+    CS_COLOR_MAX
+};
+
+// Takes what an Output renders, a buffer at a time, in place of
+// standard output.
+class OutputSink
+{
+public:
+    virtual ~OutputSink() = default;
+
+    virtual void write(const char* data, size_t len) = 0;
+};
+
+// Buffered writer for standard output.
+//
+// Text is rendered into one large buffer and written with a single
+// system call whenever it fills. Color changes are emitted as VT escape
+// sequences, and only when the color actually differs from the current
+// one. Color is disabled when standard output is not a terminal. On
+// consoles without VT support, the buffer is flushed before each color
+// change and the console attribute is set directly.
+//
+// An Output can also be pointed at a string or a sink, in which case
+// everything is handed to it without color.
+class Output
+{
+public:
+    static const size_t BufferSize = 256 * 1024;
+
+private:
+    enum ColorMode
+    {
+        CM_NONE,
+        CM_VT,
+        CM_CONSOLE,
+    };
+
+    char*        m_buffer;
+    size_t       m_used;
+    ColorMode    m_mode;
+    bool         m_terminal;
+    int          m_fore;
+    int          m_back;
+    uint64_t     m_bytes;
+    uint64_t     m_writes;
+    uint64_t     m_writeTicks;
+    uint64_t     m_created;
+    uint64_t     m_firstWrite;
+    std::string* m_sink;
+    OutputSink*  m_stream;
+
+    void writeColor(int fore, int back);
+    void drain(const char* data, size_t len);
+
+public:
+    Output();
+    ~Output();
+
+    // Appends to sink instead of writing to standard output.
+    explicit Output(std::string& sink);
+
+    // Hands each full buffer to sink instead.
+    explicit Output(OutputSink& sink);
+
+    Output(const Output&) = delete;
+    Output& operator=(const Output&) = delete;
+
+    void setColor(int fore, int back = CS_BLACK);
+    void flush();
+
+    // Turns color off for the rest of the output.
+    void disableColor()
+    {
+        m_mode = CM_NONE;
+    }
+
+    // Colors the output the way other does, if the colors can be
+    // held in text; a console without VT support leaves it plain.
+    void colorLike(const Output& other)
+    {
+        m_mode = other.m_mode == CM_VT ? CM_VT : CM_NONE;
+    }
+
+    // Writes text another Output rendered. Its colors are passed
+    // through, so the next setColor is always written.
+    void writeRendered(const char* text, size_t len)
+    {
+        write(text, len);
+        m_fore = -1;
+        m_back = -1;
+    }
+
+    void writeRendered(const std::string& text)
+    {
+        writeRendered(text.data(), text.size());
+    }
+
+    void write(const char* str, size_t len)
+    {
+        if (m_used + len > BufferSize)
+        {
+            flush();
+            if (len > BufferSize)
+            {
+                drain(str, len);
+                return;
+            }
+        }
+        memcpy(m_buffer + m_used, str, len);
+        m_used += len;
+    }
+
+    void write(const char* str)
+    {
+        write(str, strlen(str));
+    }
+
+    void write(const std::string& str)
+    {
+        write(str.data(), str.size());
+    }
+
+    void put(char ch)
+    {
+        if (m_used >= BufferSize)
+            flush();
+        m_buffer[m_used++] = ch;
+    }
+
+    void pad(size_t count, char ch = ' ');
+    void writeNumber(uint64_t val);
+    void writeSigned(int64_t val);
+
+    // Writes str aligned to the left or right of a field width wide.
+    void writeLeft(const std::string& str, size_t width);
+    void writeRight(const std::string& str, size_t width);
+    void writeRight(const char* str, size_t len, size_t width);
+
+    // True if the output is an interactive console.
+    bool isTerminal() const
+    {
+        return m_terminal;
+    }
+
+    bool hasColor() const
+    {
+        return m_mode != CM_NONE;
+    }
+
+    // Bytes handed to the operating system so far.
+    uint64_t bytesWritten() const
+    {
+        return m_bytes;
+    }
+
+    // Number of write calls issued so far.
+    uint64_t writeCalls() const
+    {
+        return m_writes;
+    }
+
+    // Time spent inside the write calls, in seconds.
+    double writeSeconds() const;
+
+    // Seconds from construction until the first byte was handed
+    // to the operating system, or a negative value if nothing has
+    // been written yet.
+    double firstWriteSeconds() const;
+
+    // Restores the console color without touching the buffer;
+    // safe to call from a signal or console control handler.
+    static void resetConsole();
+};
+
+#endif  //_Output_h_
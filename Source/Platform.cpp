@@ -0,0 +1,282 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Platform.h"
+
+#ifdef _WIN32
+
+bool isDirectory(const char* path)
+{
+    DWORD attr = ::GetFileAttributesA(path);
+    return attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY) != 0;
+}
+
+bool directoryStamp(const char* path, DirectoryStamp& dest)
+{
+    // Directories can only be opened with backup semantics.
+    HANDLE handle = ::CreateFileA(*path ? path : ".",
+                                  0,
+                                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                  nullptr,
+                                  OPEN_EXISTING,
+                                  FILE_FLAG_BACKUP_SEMANTICS,
+                                  nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    BY_HANDLE_FILE_INFORMATION info;
+    BOOL                       result = ::GetFileInformationByHandle(handle, &info);
+    ::CloseHandle(handle);
+    if (!result)
+        return false;
+
+    // FILETIME counts 100ns intervals since 1601-01-01.
+    uint64_t ticks = (uint64_t)info.ftLastWriteTime.dwHighDateTime << 32 |
+                     info.ftLastWriteTime.dwLowDateTime;
+
+    dest.device    = info.dwVolumeSerialNumber;
+    dest.inode     = (uint64_t)info.nFileIndexHigh << 32 | info.nFileIndexLow;
+    dest.timeWrite = ((int64_t)ticks - 116444736000000000LL) * 100;
+    return true;
+}
+
+bool fileIdentity(const char* path, FileIdentity& dest)
+{
+    HANDLE handle = ::CreateFileA(path,
+                                  0,
+                                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                  nullptr,
+                                  OPEN_EXISTING,
+                                  FILE_FLAG_BACKUP_SEMANTICS,
+                                  nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    BY_HANDLE_FILE_INFORMATION info;
+    BOOL                       result = ::GetFileInformationByHandle(handle, &info);
+    ::CloseHandle(handle);
+    if (!result)
+        return false;
+
+    dest.device = info.dwVolumeSerialNumber;
+    dest.inode  = (uint64_t)info.nFileIndexHigh << 32 | info.nFileIndexLow;
+    return true;
+}
+
+bool replaceFile(const char* src, const char* dest)
+{
+    return ::MoveFileExA(src, dest, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+bool temporaryDirectory(std::string& dest)
+{
+    char  buf[MAX_PATH + 1];
+    DWORD len = ::GetTempPathA(sizeof buf, buf);
+    if (len == 0 || len >= sizeof buf)
+        return false;
+
+    // The directory for temporary files belongs to the user,
+    // so the name only has to be one not taken yet.
+    for (unsigned i = 0; i < 100; ++i)
+    {
+        dest.assign(buf, len).append("ls-");
+        dest.append(std::to_string(::GetCurrentProcessId())).push_back('-');
+        dest.append(std::to_string(i));
+        if (::CreateDirectoryA(dest.c_str(), nullptr))
+            return true;
+        if (::GetLastError() != ERROR_ALREADY_EXISTS)
+            return false;
+    }
+    return false;
+}
+
+bool removeDirectory(const char* path)
+{
+    return ::RemoveDirectoryA(path) != 0;
+}
+
+MappedFile::MappedFile() :
+    m_data(nullptr),
+    m_size(0),
+    m_file(INVALID_HANDLE_VALUE),
+    m_map(nullptr)
+{
+}
+
+bool MappedFile::open(const char* path)
+{
+    close();
+
+    m_file = ::CreateFileA(path,
+                           GENERIC_READ,
+                           FILE_SHARE_READ | FILE_SHARE_DELETE,
+                           nullptr,
+                           OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL,
+                           nullptr);
+    if (m_file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!::GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+
+    m_map = ::CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_map != nullptr)
+        m_data = (const char*)::MapViewOfFile(m_map, FILE_MAP_READ, 0, 0, 0);
+
+    if (m_data == nullptr)
+    {
+        close();
+        return false;
+    }
+    m_size = (size_t)size.QuadPart;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_data)
+        ::UnmapViewOfFile(m_data);
+    if (m_map)
+        ::CloseHandle(m_map);
+    if (m_file != INVALID_HANDLE_VALUE)
+        ::CloseHandle(m_file);
+
+    m_data = nullptr;
+    m_size = 0;
+    m_map  = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+}
+
+#else
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool isDirectory(const char* path)
+{
+    struct stat st = {};
+    return ::stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool directoryStamp(const char* path, DirectoryStamp& dest)
+{
+    struct stat st = {};
+    if (::stat(*path ? path : ".", &st) != 0)
+        return false;
+
+    dest.device = (uint64_t)st.st_dev;
+    dest.inode  = (uint64_t)st.st_ino;
+#ifdef __APPLE__
+    dest.timeWrite = (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    dest.timeWrite = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+bool fileIdentity(const char* path, FileIdentity& dest)
+{
+    struct stat st = {};
+    if (::stat(path, &st) != 0)
+        return false;
+
+    dest.device = (uint64_t)st.st_dev;
+    dest.inode  = (uint64_t)st.st_ino;
+    return true;
+}
+
+bool replaceFile(const char* src, const char* dest)
+{
+    return ::rename(src, dest) == 0;
+}
+
+bool temporaryDirectory(std::string& dest)
+{
+    const char* dir = ::getenv("TMPDIR");
+
+    dest.assign(dir && *dir ? dir : "/tmp");
+    if (dest.back() != '/')
+        dest.push_back('/');
+    dest.append("ls-XXXXXX");
+
+    // The name is picked and the directory made, mode 0700, at once.
+    return ::mkdtemp(&dest[0]) != nullptr;
+}
+
+bool removeDirectory(const char* path)
+{
+    return ::rmdir(path) == 0;
+}
+
+MappedFile::MappedFile() :
+    m_data(nullptr),
+    m_size(0)
+{
+}
+
+bool MappedFile::open(const char* path)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st = {};
+    if (::fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void* addr = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr != MAP_FAILED)
+        {
+            m_data = (const char*)addr;
+            m_size = (size_t)st.st_size;
+        }
+    }
+    ::close(fd);
+    return m_data != nullptr;
+}
+
+void MappedFile::close()
+{
+    if (m_data)
+        ::munmap((void*)m_data, m_size);
+    m_data = nullptr;
+    m_size = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
@@ -0,0 +1,118 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _Platform_h_
+#define _Platform_h_
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#include <windows.h>
+
+const char Seperator    = '\\';
+const char SeperatorAlt = '/';
+
+#else
+
+const char Seperator    = '/';
+const char SeperatorAlt = '\\';
+
+#endif
+
+// Returns true if path names an existing directory.
+bool isDirectory(const char* path);
+
+// Identifies a directory, and the last time an entry
+// was added to, removed from or renamed inside it.
+struct DirectoryStamp
+{
+    uint64_t device;
+    uint64_t inode;
+    int64_t  timeWrite;  // nanoseconds since 1970-01-01 UTC
+};
+
+// Fills dest for the directory at path; an empty
+// path is the current directory.
+bool directoryStamp(const char* path, DirectoryStamp& dest);
+
+// Identifies a file; the hard links to one file share it.
+struct FileIdentity
+{
+    uint64_t device;
+    uint64_t inode;
+};
+
+// Fills dest for the file at path, following links.
+bool fileIdentity(const char* path, FileIdentity& dest);
+
+// Atomically replaces dest with src.
+bool replaceFile(const char* src, const char* dest);
+
+// Creates a new directory that only this user can reach, in the
+// directory for temporary files, and puts its path in dest. Files
+// made inside it cannot be raced by other users.
+bool temporaryDirectory(std::string& dest);
+
+// Removes the empty directory at path.
+bool removeDirectory(const char* path);
+
+// A read only mapping of a whole file.
+class MappedFile
+{
+private:
+    const char* m_data;
+    size_t      m_size;
+#ifdef _WIN32
+    HANDLE m_file;
+    HANDLE m_map;
+#endif
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps the file at path. Empty files fail to map.
+    bool open(const char* path);
+    void close();
+
+    const char* data() const
+    {
+        return m_data;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+};
+
+#endif  //_Platform_h_
@@ -0,0 +1,150 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "RecordFormat.h"
+#include <cstring>
+
+using namespace std;
+
+const char RecordMagic[8] = {'L', 'S', 'R', 'E', 'C', 'O', 'R', 'D'};
+
+void writeJsonString(Output& out, const char* str, size_t len)
+{
+    static const char Hex[] = "0123456789abcdef";
+
+    // Copy runs of plain bytes, escaping only what JSON requires.
+    size_t i, start = 0;
+    for (i = 0; i < len; ++i)
+    {
+        unsigned char ch = (unsigned char)str[i];
+        if (ch >= 0x20 && ch != '"' && ch != '\\')
+            continue;
+
+        out.write(str + start, i - start);
+        start = i + 1;
+
+        out.put('\\');
+        switch (ch)
+        {
+        case '"':
+        case '\\':
+            out.put((char)ch);
+            break;
+        case '\n':
+            out.put('n');
+            break;
+        case '\r':
+            out.put('r');
+            break;
+        case '\t':
+            out.put('t');
+            break;
+        default:
+            out.write("u00", 3);
+            out.put(Hex[ch >> 4]);
+            out.put(Hex[ch & 15]);
+            break;
+        }
+    }
+    out.write(str + start, len - start);
+}
+
+bool parseRecordFormat(const char* name, RecordFormat& dest)
+{
+    if (strcmp(name, "ndjson") == 0)
+        dest = RF_NDJSON;
+    else if (strcmp(name, "nul") == 0)
+        dest = RF_NUL;
+    else if (strcmp(name, "bin") == 0)
+        dest = RF_BIN;
+    else if (strcmp(name, "text") == 0)
+        dest = RF_TEXT;
+    else
+        return false;
+    return true;
+}
+
+void writeRecordHeader(Output& out, RecordFormat fmt)
+{
+    if (fmt != RF_BIN)
+        return;
+
+    RecordFileHeader header = {};
+    memcpy(header.magic, RecordMagic, sizeof RecordMagic);
+    header.version    = 1;
+    header.headerSize = sizeof(RecordHeader);
+    out.write((const char*)&header, sizeof header);
+}
+
+void writeRecord(Output& out, RecordFormat fmt, const string& dir, const DirEntry& ent)
+{
+    switch (fmt)
+    {
+    case RF_NDJSON:
+        out.write("{\"path\":\"", 9);
+        writeJsonString(out, dir.data(), dir.size());
+        writeJsonString(out, ent.name, ent.nameLen);
+        out.write("\",\"size\":", 9);
+        out.writeNumber(ent.size);
+        out.write(",\"mtime\":", 9);
+        out.writeSigned(ent.timeWrite);
+        out.write(",\"attrib\":", 10);
+        out.writeNumber(ent.attrib);
+        out.write("}\n", 2);
+        break;
+    case RF_NUL:
+        out.writeNumber(ent.size);
+        out.put('\t');
+        out.writeSigned(ent.timeWrite);
+        out.put('\t');
+        out.writeNumber(ent.attrib);
+        out.put('\t');
+        out.write(dir);
+        out.write(ent.name, ent.nameLen);
+        out.put('\0');
+        break;
+    case RF_BIN:
+    {
+        RecordHeader rec = {};
+
+        size_t pathLen = dir.size() + ent.nameLen;
+        size_t padded  = (pathLen + 1 + 7) & ~(size_t)7;
+
+        rec.size       = ent.size;
+        rec.timeWrite  = ent.timeWrite;
+        rec.attrib     = ent.attrib;
+        rec.pathLen    = (uint32_t)pathLen;
+        rec.recordSize = (uint32_t)(sizeof rec + padded);
+
+        out.write((const char*)&rec, sizeof rec);
+        out.write(dir);
+        out.write(ent.name, ent.nameLen);
+        out.pad(padded - pathLen, '\0');
+        break;
+    }
+    default:
+        break;
+    }
+}
@@ -0,0 +1,82 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _RecordFormat_h_
+#define _RecordFormat_h_
+
+#include "DirectoryReader.h"
+#include "Output.h"
+#include <string>
+
+// Output formats for scripts. Every entry is written as a record
+// holding its path, size, write time in nanoseconds since the epoch
+// and its EA_* attributes. Paths are written as raw bytes.
+//
+//  ndjson  {"path":"...","size":0,"mtime":0,"attrib":0} per line,
+//          with quotes, backslashes and control characters escaped.
+//  nul     size TAB mtime TAB attrib TAB path, ending with a NUL.
+//  bin     a RecordFileHeader, then for every entry a RecordHeader
+//          and the path, NUL terminated and padded to 8 bytes.
+//          Fields are in native byte order; recordSize steps from one
+//          record to the next, so the output can be mapped as is.
+enum RecordFormat
+{
+    RF_TEXT = 0,
+    RF_NDJSON,
+    RF_NUL,
+    RF_BIN,
+};
+
+struct RecordFileHeader
+{
+    char     magic[8];  // "LSRECORD"
+    uint32_t version;   // 1
+    uint32_t headerSize;
+};
+
+struct RecordHeader
+{
+    uint64_t size;
+    int64_t  timeWrite;
+    uint32_t attrib;
+    uint32_t pathLen;     // not counting the NUL
+    uint32_t recordSize;  // this header, the path and its padding
+    uint32_t reserved;
+};
+
+// Parses ndjson, nul, bin or text. Returns false if unknown.
+bool parseRecordFormat(const char* name, RecordFormat& dest);
+
+// Writes what comes before the first record, if anything.
+void writeRecordHeader(Output& out, RecordFormat fmt);
+
+// Writes one entry; its path is dir followed by its name.
+void writeRecord(Output& out, RecordFormat fmt, const std::string& dir, const DirEntry& ent);
+
+// Writes str as the inside of a JSON string, escaping quotes,
+// backslashes and control characters.
+void writeJsonString(Output& out, const char* str, size_t len);
+
+#endif  //_RecordFormat_h_
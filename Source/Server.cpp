@@ -0,0 +1,756 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Server.h"
+#include "Walk.h"
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#ifndef _WIN32
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+using namespace std;
+
+#ifndef _WIN32
+
+// Writes to a socket. A peer that has gone away is an
+// error here, not a SIGPIPE that ends the process.
+static bool writeAll(int fd, const char* data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t rc = ::send(fd, data, len, MSG_NOSIGNAL);
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += rc;
+        len -= (size_t)rc;
+    }
+    return true;
+}
+
+static bool socketAddress(sockaddr_un& addr, const char* path)
+{
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof addr.sun_path)
+        return false;
+    strcpy(addr.sun_path, path);
+    return true;
+}
+
+#endif
+
+#ifdef __linux__
+
+const uint32_t WatchMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB |
+                           IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO |
+                           IN_ONLYDIR | IN_EXCL_UNLINK;
+
+struct WatchTotals
+{
+    int64_t bytes;
+    int64_t files;
+    int64_t directories;
+
+    void add(const WatchTotals& rhs, int64_t sign)
+    {
+        bytes += sign * rhs.bytes;
+        files += sign * rhs.files;
+        directories += sign * rhs.directories;
+    }
+};
+
+struct WatchEntry
+{
+    uint32_t attrib;
+    uint64_t size;
+    int64_t  timeWrite;
+};
+
+struct WatchNode
+{
+    string                             name;
+    string                             path;  // relative to the root
+    WatchNode*                         parent;
+    int                                wd;
+    bool                               unwatched;  // read from disk on request
+    map<string, WatchEntry>            entries;
+    map<string, unique_ptr<WatchNode>> children;
+    WatchTotals                        own;   // this directory
+    WatchTotals                        tree;  // and everything below
+};
+
+class WatchTree
+{
+private:
+    const ServeConfig&             m_config;
+    int                            m_notify;
+    unique_ptr<WatchNode>          m_root;
+    unordered_map<int, WatchNode*> m_watches;
+    unique_ptr<DirectoryReader>    m_reader;
+    size_t                         m_unwatched;
+
+    static void makeEntry(DirEntry& ent, const string& name, const WatchEntry& we)
+    {
+        ent.name      = name.c_str();
+        ent.nameLen   = name.size();
+        ent.attrib    = we.attrib;
+        ent.size      = we.size;
+        ent.timeWrite = we.timeWrite;
+    }
+
+    // The totals one entry contributes to its directory.
+    WatchTotals tally(const DirEntry& ent) const
+    {
+        WatchTotals val = {};
+        if (!m_config.include(ent))
+            return val;
+        if ((ent.attrib & EA_DIRECTORY) != 0)
+            val.directories = 1;
+        else
+        {
+            val.files = 1;
+            val.bytes = (int64_t)ent.size;
+        }
+        return val;
+    }
+
+    bool shouldWatch(const DirEntry& ent) const
+    {
+        // Links are not followed, so cycles cannot be watched forever.
+        return (ent.attrib & EA_DIRECTORY) != 0 &&
+               (ent.attrib & EA_LINK) == 0 &&
+               m_config.descend(ent);
+    }
+
+    void adjustTree(WatchNode* node, const WatchTotals& delta, int64_t sign)
+    {
+        for (; node; node = node->parent)
+            node->tree.add(delta, sign);
+    }
+
+    WatchNode* addChild(WatchNode* node, const string& name)
+    {
+        unique_ptr<WatchNode> child(new WatchNode());
+        child->name   = name;
+        child->path   = node->path + name + '/';
+        child->parent = node;
+        child->wd     = -1;
+
+        WatchNode* ptr = child.get();
+        node->children[name] = std::move(child);
+        return ptr;
+    }
+
+    void build(WatchNode* node)
+    {
+        string full = m_config.root + node->path;
+
+        // Watch first, so nothing is missed while reading.
+        node->wd = ::inotify_add_watch(m_notify, full.empty() ? "." : full.c_str(), WatchMask);
+        if (node->wd >= 0)
+            m_watches[node->wd] = node;
+        else
+        {
+            // Usually the watch limit was reached.
+            node->unwatched = true;
+            ++m_unwatched;
+        }
+
+        vector<WatchNode*> subdirs;
+
+        DirEntry ent = {};
+        if (m_reader->open(full.c_str(), EM_FULL))
+        {
+            while (m_reader->next(ent))
+            {
+                if (isDotEntry(ent.name))
+                    continue;
+
+                string name(ent.name, ent.nameLen);
+                node->entries[name] = {ent.attrib, ent.size, ent.timeWrite};
+                node->own.add(tally(ent), 1);
+
+                if (shouldWatch(ent))
+                    subdirs.push_back(addChild(node, name));
+            }
+            m_reader->close();
+        }
+
+        node->tree = node->own;
+        for (WatchNode* child : subdirs)
+        {
+            build(child);
+            node->tree.add(child->tree, 1);
+        }
+    }
+
+    void forget(WatchNode* node)
+    {
+        if (node->wd >= 0)
+        {
+            ::inotify_rm_watch(m_notify, node->wd);
+            m_watches.erase(node->wd);
+        }
+        if (node->unwatched)
+        {
+            node->unwatched = false;
+            --m_unwatched;
+        }
+        for (auto& child : node->children)
+            forget(child.second.get());
+    }
+
+    // Reads an unwatched directory and everything below it again.
+    void resync(WatchNode* node)
+    {
+        adjustTree(node->parent, node->tree, -1);
+        forget(node);
+        node->entries.clear();
+        node->children.clear();
+        node->own = {};
+
+        build(node);
+        adjustTree(node->parent, node->tree, 1);
+    }
+
+    void refresh(WatchNode* node)
+    {
+        if (node->unwatched)
+            resync(node);
+        else
+        {
+            for (auto& child : node->children)
+                refresh(child.second.get());
+        }
+    }
+
+    void removeChild(WatchNode* node, const string& name)
+    {
+        auto it = node->children.find(name);
+        if (it == node->children.end())
+            return;
+
+        adjustTree(node, it->second->tree, -1);
+        forget(it->second.get());
+        node->children.erase(it);
+    }
+
+    // Brings one entry of node in line with the file system.
+    void update(WatchNode* node, const string& name)
+    {
+        DirEntry old = {}, cur = {};
+        string   full  = m_config.root + node->path + name;
+        bool     had   = false;
+        auto     found = node->entries.find(name);
+
+        if (found != node->entries.end())
+        {
+            makeEntry(old, found->first, found->second);
+            node->own.add(tally(old), -1);
+            adjustTree(node, tally(old), -1);
+            had = true;
+        }
+
+        cur.name    = name.c_str();
+        cur.nameLen = name.size();
+        if (!describeEntry(full.c_str(), cur))
+        {
+            if (had)
+                node->entries.erase(found);
+            removeChild(node, name);
+            return;
+        }
+
+        node->entries[name] = {cur.attrib, cur.size, cur.timeWrite};
+        node->own.add(tally(cur), 1);
+        adjustTree(node, tally(cur), 1);
+
+        bool watched = node->children.count(name) != 0;
+        if (shouldWatch(cur) && !watched)
+        {
+            WatchNode* child = addChild(node, name);
+            build(child);
+            adjustTree(node, child->tree, 1);
+        }
+        else if (!shouldWatch(cur) && watched)
+            removeChild(node, name);
+    }
+
+public:
+    WatchTree(const ServeConfig& config, int notify) :
+        m_config(config),
+        m_notify(notify),
+        m_reader(DirectoryReader::create()),
+        m_unwatched(0)
+    {
+    }
+
+    size_t unwatched() const
+    {
+        return m_unwatched;
+    }
+
+    void rebuild()
+    {
+        if (m_root)
+            forget(m_root.get());
+        m_watches.clear();
+
+        m_root.reset(new WatchNode());
+        m_root->parent = nullptr;
+        m_root->wd     = -1;
+        build(m_root.get());
+    }
+
+    void apply(const inotify_event& evt)
+    {
+        if ((evt.mask & IN_Q_OVERFLOW) != 0)
+        {
+            // Events were dropped; start over.
+            rebuild();
+            return;
+        }
+
+        auto it = m_watches.find(evt.wd);
+        if (it == m_watches.end())
+            return;
+
+        WatchNode* node = it->second;
+        if ((evt.mask & IN_IGNORED) != 0)
+        {
+            node->wd = -1;
+            m_watches.erase(it);
+            return;
+        }
+
+        if (evt.len == 0 || evt.name[0] == 0)
+            return;
+
+        update(node, evt.name);
+
+        // The write time of the directory changed with it. The name
+        // is copied since node goes away if it was removed.
+        if (node->parent)
+        {
+            string name = node->name;
+            update(node->parent, name);
+        }
+    }
+
+    WatchNode* find(const string& path) const
+    {
+        WatchNode* node = m_root.get();
+
+        size_t pos = 0;
+        while (node && pos < path.size())
+        {
+            size_t end = path.find_first_of("/\\", pos);
+            if (end == string::npos)
+                end = path.size();
+
+            string part = path.substr(pos, end - pos);
+            if (!part.empty() && part != ".")
+            {
+                auto it = node->children.find(part);
+                node    = it != node->children.end() ? it->second.get() : nullptr;
+            }
+            pos = end + 1;
+        }
+        return node;
+    }
+
+    void respond(const string& line, string& reply)
+    {
+        string cmd = line, arg;
+
+        size_t sp = line.find(' ');
+        if (sp != string::npos)
+        {
+            cmd = line.substr(0, sp);
+            arg = line.substr(sp + 1);
+        }
+
+        if (cmd != "LIST" && cmd != "TOTALS")
+        {
+            reply = "ERR unknown request\n";
+            return;
+        }
+
+        if (m_unwatched > 0)
+            refresh(m_root.get());
+
+        WatchNode* node = find(arg);
+        if (!node)
+        {
+            reply = "ERR no such directory\n";
+            return;
+        }
+
+        string body;
+        if (cmd == "LIST")
+        {
+            EntryTable table;
+            DirEntry   ent = {};
+            for (const auto& it : node->entries)
+            {
+                makeEntry(ent, it.first, it.second);
+                if (m_config.include(ent))
+                    table.add(ent);
+            }
+
+            Output out(body);
+            m_config.write(out, node->path, table);
+            out.flush();
+        }
+        else
+        {
+            char buf[80];
+            snprintf(buf,
+                     sizeof buf,
+                     "%lld %lld %lld\n",
+                     (long long)node->tree.bytes,
+                     (long long)node->tree.files,
+                     (long long)node->tree.directories);
+            body = buf;
+        }
+
+        reply = "OK " + to_string(body.size()) + "\n" + body;
+    }
+};
+
+// Requests are one short line; a client sending more is dropped.
+const size_t MaxRequestSize = 4096;
+
+// Replies a client has not read yet are queued up to this much;
+// a client that stops reading is dropped past it.
+const size_t MaxReplyBacklog = 16 * 1024 * 1024;
+
+struct ServeClient
+{
+    int    fd;
+    string input;
+    string output;  // replies not sent yet
+    size_t sent;    // of output
+    bool   closing; // the client is done writing
+};
+
+// Sends as much of the queued replies as the socket takes
+// without blocking. Returns false if the client is gone.
+static bool sendReplies(ServeClient& client)
+{
+    while (client.sent < client.output.size())
+    {
+        ssize_t rc = ::send(client.fd,
+                            client.output.data() + client.sent,
+                            client.output.size() - client.sent,
+                            MSG_NOSIGNAL);
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        client.sent += (size_t)rc;
+    }
+    client.output.clear();
+    client.sent = 0;
+    return true;
+}
+
+int serve(const char* socketPath, const ServeConfig& config, Output& out)
+{
+    sockaddr_un addr;
+    if (!socketAddress(addr, socketPath))
+    {
+        out.write("the socket path is too long\n");
+        return 1;
+    }
+
+    // A socket left by an earlier server is replaced; anything else is kept.
+    struct stat st;
+    if (::lstat(socketPath, &st) == 0 && !S_ISSOCK(st.st_mode))
+    {
+        out.write(socketPath);
+        out.write(" exists and is not a socket\n");
+        return 1;
+    }
+
+    int notify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (notify < 0)
+    {
+        out.write("failed to start watching the file system\n");
+        return 1;
+    }
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    ::unlink(socketPath);
+    if (listener < 0 ||
+        ::bind(listener, (sockaddr*)&addr, sizeof addr) != 0 ||
+        ::listen(listener, 16) != 0)
+    {
+        out.write("failed to listen on ");
+        out.write(socketPath);
+        out.put('\n');
+        ::close(notify);
+        if (listener >= 0)
+            ::close(listener);
+        return 1;
+    }
+
+    WatchTree tree(config, notify);
+    tree.rebuild();
+
+    out.write("serving ");
+    out.write(config.root.empty() ? "." : config.root.c_str());
+    out.write(" on ");
+    out.write(socketPath);
+    out.put('\n');
+    if (tree.unwatched() > 0)
+    {
+        out.writeNumber(tree.unwatched());
+        out.write(" directories could not be watched and are read from disk"
+                  " on each request; raise fs.inotify.max_user_watches\n");
+    }
+    out.flush();
+
+    // inotify_event holds an int first; keep the buffer aligned for it.
+    alignas(inotify_event) char events[64 * 1024];
+
+    vector<ServeClient> clients;
+    vector<pollfd>      fds;
+    string              reply;
+
+    for (;;)
+    {
+        fds.clear();
+        fds.push_back({notify, POLLIN, 0});
+        fds.push_back({listener, POLLIN, 0});
+        for (const ServeClient& client : clients)
+        {
+            short events = client.closing ? 0 : POLLIN;
+            if (!client.output.empty())
+                events |= POLLOUT;
+            fds.push_back({client.fd, events, 0});
+        }
+
+        if (::poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            ssize_t len;
+            while ((len = ::read(notify, events, sizeof events)) > 0)
+            {
+                for (char* cp = events; cp < events + len;)
+                {
+                    const inotify_event* evt = (const inotify_event*)cp;
+                    tree.apply(*evt);
+                    cp += sizeof(inotify_event) + evt->len;
+                }
+            }
+        }
+
+        if (fds[1].revents & POLLIN)
+        {
+            // A client that does not read must not hold up the others.
+            int fd = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+            if (fd >= 0)
+                clients.push_back({fd, string(), string(), 0, false});
+        }
+
+        // Clients accepted above are not in fds yet.
+        size_t polled = fds.size() - 2;
+        for (size_t i = polled; i-- > 0;)
+        {
+            if (fds[i + 2].revents == 0)
+                continue;
+
+            ServeClient& client = clients[i];
+            short        revents = fds[i + 2].revents;
+            bool         done    = (revents & (POLLERR | POLLNVAL)) != 0;
+
+            if (!done && !client.closing && (revents & (POLLIN | POLLHUP)) != 0)
+            {
+                char    buf[4096];
+                ssize_t len = ::read(client.fd, buf, sizeof buf);
+                if (len > 0)
+                    client.input.append(buf, (size_t)len);
+                else if (len == 0)
+                    client.closing = true;
+                else if (errno != EAGAIN && errno != EINTR)
+                    done = true;
+            }
+
+            size_t nl;
+            while (!done && (nl = client.input.find('\n')) != string::npos)
+            {
+                string line = client.input.substr(0, nl);
+                client.input.erase(0, nl + 1);
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+
+                tree.respond(line, reply);
+                client.output.append(reply);
+            }
+
+            if (!done)
+                done = !sendReplies(client);
+            if (client.input.size() > MaxRequestSize ||
+                client.output.size() - client.sent > MaxReplyBacklog)
+                done = true;
+
+            // Once the client stops writing, it is closed as soon
+            // as everything asked for has been sent.
+            if (client.closing && client.output.empty())
+                done = true;
+
+            if (done)
+            {
+                ::close(client.fd);
+                clients.erase(clients.begin() + (ptrdiff_t)i);
+            }
+        }
+    }
+
+    for (const ServeClient& client : clients)
+        ::close(client.fd);
+    ::close(listener);
+    ::close(notify);
+    ::unlink(socketPath);
+    return 1;
+}
+
+#else
+
+int serve(const char* socketPath, const ServeConfig& config, Output& out)
+{
+    (void)socketPath;
+    (void)config;
+    out.write("--serve is only supported on Linux\n");
+    return 1;
+}
+
+#endif
+
+#ifndef _WIN32
+
+int query(const char* socketPath, const string& request, Output& out)
+{
+    sockaddr_un addr;
+    if (!socketAddress(addr, socketPath))
+    {
+        out.write("the socket path is too long\n");
+        return 1;
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, (sockaddr*)&addr, sizeof addr) != 0)
+    {
+        out.write("failed to connect to ");
+        out.write(socketPath);
+        out.put('\n');
+        if (fd >= 0)
+            ::close(fd);
+        return 1;
+    }
+
+    string line = request + '\n';
+    string input;
+    size_t header = string::npos, expect = 0;
+    bool   ok     = writeAll(fd, line.data(), line.size());
+
+    while (ok)
+    {
+        if (header == string::npos && (header = input.find('\n')) != string::npos)
+        {
+            if (input.compare(0, 3, "OK ") != 0)
+                break;
+            expect = header + 1 + strtoull(input.c_str() + 3, nullptr, 10);
+        }
+        if (header != string::npos && input.size() >= expect)
+            break;
+
+        char    buf[16 * 1024];
+        ssize_t len = ::read(fd, buf, sizeof buf);
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len <= 0)
+            ok = false;
+        else
+            input.append(buf, (size_t)len);
+    }
+    ::close(fd);
+
+    if (!ok || header == string::npos)
+    {
+        out.write("no reply from ");
+        out.write(socketPath);
+        out.put('\n');
+        return 1;
+    }
+
+    if (input.compare(0, 3, "OK ") != 0)
+    {
+        // ERR message
+        out.write(input.data() + min<size_t>(4, header), header + 1 - min<size_t>(4, header));
+        return 1;
+    }
+
+    out.write(input.data() + header + 1, expect - header - 1);
+    return 0;
+}
+
+#else
+
+int query(const char* socketPath, const string& request, Output& out)
+{
+    (void)socketPath;
+    (void)request;
+    out.write("--query is not supported on Windows\n");
+    return 1;
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _Server_h_
+#define _Server_h_
+
+#include "DirectoryReader.h"
+#include "EntryTable.h"
+#include "Output.h"
+#include <functional>
+#include <string>
+
+typedef std::function<bool(const DirEntry& ent)> EntryFilter;
+
+// Renders one directory of the tree. subDir is relative to
+// the root and the entries may be reordered.
+typedef std::function<void(Output& out, const std::string& subDir, EntryTable& entries)> ListingWriter;
+
+struct ServeConfig
+{
+    std::string   root;     // empty, or ends with a separator
+    EntryFilter   include;  // entries that are listed and counted
+    EntryFilter   descend;  // sub directories that are watched
+    ListingWriter write;
+};
+
+// Walks the tree under config.root once, then keeps it current from
+// file system change notifications and answers requests on a local
+// socket until the process is stopped. Each directory keeps its own
+// totals and the totals of everything below it; a change adjusts them
+// along the path to the root, so no request walks the tree.
+//
+// Requests are single lines:
+//
+//  LIST [path]     the directory as it would be listed
+//  TOTALS [path]   "bytes files directories" below the directory
+//
+// Paths are relative to the root. Each reply starts with "OK <length>"
+// followed by that many bytes, or is a single "ERR <message>" line.
+// Replies are queued for clients that read slowly; one that sends an
+// overlong request or lets too much go unread is disconnected.
+//
+// Only Linux is supported, through inotify and Unix domain sockets.
+// Progress and errors are written to out. Returns the exit code of
+// the program.
+int serve(const char* socketPath, const ServeConfig& config, Output& out);
+
+// Sends one request to a server and writes the reply to out.
+// Returns the exit code of the program.
+int query(const char* socketPath, const std::string& request, Output& out);
+
+#endif  //_Server_h_
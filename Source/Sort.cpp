@@ -0,0 +1,424 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Sort.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+using namespace std;
+
+// Runs shorter than this are finished with a comparison sort.
+const size_t RefineThreshold = 64;
+
+static inline unsigned char foldByte(unsigned char ch, bool ignoreCase)
+{
+    if (ignoreCase && ch >= 'A' && ch <= 'Z')
+        return (unsigned char)(ch - 'A' + 'a');
+    return ch;
+}
+
+// Big endian packing of the first eight bytes, so
+// comparing keys compares the bytes in order.
+static uint64_t prefixKey(const char* str, size_t len, bool ignoreCase)
+{
+    uint64_t key = 0;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        key <<= 8;
+        if (i < len)
+            key |= foldByte((unsigned char)str[i], ignoreCase);
+    }
+    return key;
+}
+
+static int compareBytes(const char* a, size_t alen, const char* b, size_t blen, bool ignoreCase)
+{
+    size_t i, n = min(alen, blen);
+    for (i = 0; i < n; ++i)
+    {
+        unsigned char ca = foldByte((unsigned char)a[i], ignoreCase);
+        unsigned char cb = foldByte((unsigned char)b[i], ignoreCase);
+        if (ca != cb)
+            return ca < cb ? -1 : 1;
+    }
+    if (alen == blen)
+        return 0;
+    return alen < blen ? -1 : 1;
+}
+
+// The text after the last '.', or an empty
+// string for names without an extension.
+static const char* extension(const char* name, size_t len, size_t& extLen)
+{
+    size_t i = len;
+    while (i > 1 && name[i - 1] != '.')
+        --i;
+    if (i > 1)
+    {
+        extLen = len - i;
+        return name + i;
+    }
+    extLen = 0;
+    return name + len;
+}
+
+struct SortContext
+{
+    const EntryTable*  table;
+    const SortOptions* opts;
+    vector<uint64_t>   keys;   // indexed by entry
+    bool               tails;  // keys are prefixes; ties need a full compare
+
+    int compareTail(uint32_t a, uint32_t b) const
+    {
+        bool        ic = opts->ignoreCase;
+        const char* na = table->name(a);
+        const char* nb = table->name(b);
+        size_t      la = table->nameLength(a);
+        size_t      lb = table->nameLength(b);
+
+        if (opts->key == SK_EXT)
+        {
+            size_t      ela, elb;
+            const char* ea = extension(na, la, ela);
+            const char* eb = extension(nb, lb, elb);
+
+            size_t s = min<size_t>(8, min(ela, elb));
+            int    c = compareBytes(ea + s, ela - s, eb + s, elb - s, ic);
+            if (c != 0)
+                return c;
+            return compareBytes(na, la, nb, lb, ic);
+        }
+
+        return compareFrom(a, b, 8);
+    }
+
+    // Compares names that are known to be equal up to depth.
+    int compareFrom(uint32_t a, uint32_t b, size_t depth) const
+    {
+        const char* na = table->name(a);
+        const char* nb = table->name(b);
+        size_t      la = table->nameLength(a);
+        size_t      lb = table->nameLength(b);
+
+        size_t s = min(depth, min(la, lb));
+        return compareBytes(na + s, la - s, nb + s, lb - s, opts->ignoreCase);
+    }
+
+    bool less(uint32_t a, uint32_t b) const
+    {
+        uint64_t ka = keys[a], kb = keys[b];
+        if (ka != kb)
+            return ka < kb;
+        if (!tails)
+            return false;
+
+        int c = compareTail(a, b);
+        return opts->reverse ? c > 0 : c < 0;
+    }
+};
+
+void radixSort(uint64_t* keys,
+               uint32_t* vals,
+               size_t    n,
+               uint64_t* tmpKeys,
+               uint32_t* tmpVals)
+{
+    if (n < 2)
+        return;
+
+    // One pass builds the histogram of every digit.
+    static const int Digits = 8;
+    vector<size_t>   counts(Digits * 256, 0);
+
+    size_t i;
+    int    d;
+    for (i = 0; i < n; ++i)
+    {
+        uint64_t k = keys[i];
+        for (d = 0; d < Digits; ++d)
+            counts[d * 256 + ((k >> (d * 8)) & 0xFF)]++;
+    }
+
+    uint64_t* srcK = keys;
+    uint32_t* srcV = vals;
+    uint64_t* dstK = tmpKeys;
+    uint32_t* dstV = tmpVals;
+
+    for (d = 0; d < Digits; ++d)
+    {
+        size_t* count = &counts[d * 256];
+        int     shift = d * 8;
+
+        // Every key has the same digit; nothing moves.
+        if (count[(srcK[0] >> shift) & 0xFF] == n)
+            continue;
+
+        size_t sum = 0;
+        for (int b = 0; b < 256; ++b)
+        {
+            size_t c = count[b];
+            count[b] = sum;
+            sum += c;
+        }
+
+        for (i = 0; i < n; ++i)
+        {
+            size_t pos = count[(srcK[i] >> shift) & 0xFF]++;
+            dstK[pos]  = srcK[i];
+            dstV[pos]  = srcV[i];
+        }
+
+        swap(srcK, dstK);
+        swap(srcV, dstV);
+    }
+
+    if (srcK != keys)
+    {
+        memcpy(keys, srcK, n * sizeof(uint64_t));
+        memcpy(vals, srcV, n * sizeof(uint32_t));
+    }
+}
+
+// Runs of names that share a prefix are split on the next eight
+// bytes instead of being compared a pair at a time, so directories
+// full of similar names stay close to linear.
+static void refineNames(const SortContext& ctx, uint32_t* first, size_t n, size_t depth)
+{
+    bool rev = ctx.opts->reverse;
+    if (n < RefineThreshold)
+    {
+        stable_sort(first, first + n, [&ctx, depth, rev](uint32_t a, uint32_t b) {
+            int c = ctx.compareFrom(a, b, depth);
+            return rev ? c > 0 : c < 0;
+        });
+        return;
+    }
+
+    vector<uint64_t> keys(n), tmpKeys(n);
+    vector<uint32_t> tmpVals(n);
+
+    bool   longer = false;
+    size_t i;
+    for (i = 0; i < n; ++i)
+    {
+        size_t   len = ctx.table->nameLength(first[i]);
+        uint64_t key = 0;
+        if (len > depth)
+        {
+            key = prefixKey(ctx.table->name(first[i]) + depth, len - depth, ctx.opts->ignoreCase);
+            longer |= len > depth + 8;
+        }
+        keys[i] = rev ? ~key : key;
+    }
+
+    radixSort(keys.data(), first, n, tmpKeys.data(), tmpVals.data());
+
+    // Equal keys are equal names when nothing is left to compare.
+    if (!longer)
+        return;
+
+    size_t start = 0;
+    for (i = 1; i <= n; ++i)
+    {
+        if (i == n || keys[i] != keys[start])
+        {
+            if (i - start > 1)
+                refineNames(ctx, first + start, i - start, depth + 8);
+            start = i;
+        }
+    }
+}
+
+static void sortRange(const SortContext& ctx, uint32_t* first, size_t n)
+{
+    if (n < 2)
+        return;
+
+    vector<uint64_t> keys(n), tmpKeys(n);
+    vector<uint32_t> tmpVals(n);
+
+    size_t i;
+    for (i = 0; i < n; ++i)
+        keys[i] = ctx.keys[first[i]];
+
+    radixSort(keys.data(), first, n, tmpKeys.data(), tmpVals.data());
+
+    if (!ctx.tails)
+        return;
+
+    // Resolve runs that share the same prefix.
+    auto cmp = [&ctx](uint32_t a, uint32_t b) { return ctx.less(a, b); };
+
+    size_t start = 0;
+    for (i = 1; i <= n; ++i)
+    {
+        if (i == n || keys[i] != keys[start])
+        {
+            if (i - start > 1)
+            {
+                if (ctx.opts->key == SK_NAME)
+                    refineNames(ctx, first + start, i - start, 8);
+                else
+                    stable_sort(first + start, first + i, cmp);
+            }
+            start = i;
+        }
+    }
+}
+
+static void sortGroup(const SortContext& ctx, uint32_t* first, size_t n)
+{
+    size_t threads = ctx.opts->threads;
+    if (threads == 0)
+        threads = max<size_t>(1, thread::hardware_concurrency());
+
+    if (n < ParallelSortThreshold || threads < 2)
+    {
+        sortRange(ctx, first, n);
+        return;
+    }
+
+    // Sort equal chunks on their own threads, then merge
+    // neighbouring runs in rounds until one run is left.
+    threads = min<size_t>(threads, 64);
+
+    vector<size_t> bounds;
+    size_t         i;
+    for (i = 0; i <= threads; ++i)
+        bounds.push_back(n * i / threads);
+
+    vector<thread> workers;
+    for (i = 0; i < threads; ++i)
+    {
+        uint32_t* lo = first + bounds[i];
+        size_t    ln = bounds[i + 1] - bounds[i];
+        workers.push_back(thread([&ctx, lo, ln] { sortRange(ctx, lo, ln); }));
+    }
+    for (thread& th : workers)
+        th.join();
+
+    auto cmp = [&ctx](uint32_t a, uint32_t b) { return ctx.less(a, b); };
+    while (bounds.size() > 2)
+    {
+        vector<size_t> next;
+        workers.clear();
+        for (i = 0; i + 2 < bounds.size(); i += 2)
+        {
+            uint32_t* lo  = first + bounds[i];
+            uint32_t* mid = first + bounds[i + 1];
+            uint32_t* hi  = first + bounds[i + 2];
+            workers.push_back(thread([lo, mid, hi, cmp] { inplace_merge(lo, mid, hi, cmp); }));
+            next.push_back(bounds[i]);
+        }
+        if (i + 1 < bounds.size())
+            next.push_back(bounds[i]);
+        if (next.back() != n)
+            next.push_back(n);
+
+        for (thread& th : workers)
+            th.join();
+        bounds.swap(next);
+    }
+}
+
+void sortEntries(EntryTable& table, const SortOptions& opts)
+{
+    if (opts.key == SK_NONE || table.size() < 2)
+        return;
+
+    EntryTable::order_t& order = table.order();
+
+    auto mid = stable_partition(order.begin(), order.end(), [&table](uint32_t idx) {
+        return table.isDirectory(idx);
+    });
+
+    if (opts.key == SK_DIRECTORY)
+    {
+        if (opts.reverse)
+        {
+            reverse(order.begin(), mid);
+            reverse(mid, order.end());
+        }
+        return;
+    }
+
+    SortContext ctx;
+    ctx.table = &table;
+    ctx.opts  = &opts;
+    ctx.tails = opts.key == SK_NAME || opts.key == SK_EXT;
+    ctx.keys.resize(table.size());
+
+    uint32_t i, s = (uint32_t)table.size();
+    for (i = 0; i < s; ++i)
+    {
+        uint64_t key = 0;
+        switch (opts.key)
+        {
+        case SK_SIZE:
+            key = table.fileSize(i);
+            break;
+        case SK_TIME:
+            // Flip the sign bit so negative times order first.
+            key = (uint64_t)table.timeWrite(i) ^ (uint64_t(1) << 63);
+            break;
+        case SK_NAME:
+            key = prefixKey(table.name(i), table.nameLength(i), opts.ignoreCase);
+            break;
+        case SK_EXT:
+        {
+            size_t      el;
+            const char* ext = extension(table.name(i), table.nameLength(i), el);
+            key             = prefixKey(ext, el, opts.ignoreCase);
+            break;
+        }
+        default:
+            break;
+        }
+        ctx.keys[i] = opts.reverse ? ~key : key;
+    }
+
+    size_t dirs = (size_t)(mid - order.begin());
+    sortGroup(ctx, order.data(), dirs);
+    sortGroup(ctx, order.data() + dirs, order.size() - dirs);
+}
+
+bool parseSortKey(const char* name, SortKey& dest)
+{
+    if (strcmp(name, "name") == 0)
+        dest = SK_NAME;
+    else if (strcmp(name, "size") == 0)
+        dest = SK_SIZE;
+    else if (strcmp(name, "time") == 0)
+        dest = SK_TIME;
+    else if (strcmp(name, "ext") == 0)
+        dest = SK_EXT;
+    else if (strcmp(name, "none") == 0)
+        dest = SK_NONE;
+    else
+        return false;
+    return true;
+}
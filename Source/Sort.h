@@ -0,0 +1,71 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _Sort_h_
+#define _Sort_h_
+
+#include "EntryTable.h"
+
+enum SortKey
+{
+    SK_NONE = 0,   // directory order
+    SK_DIRECTORY,  // directories first, otherwise directory order
+    SK_NAME,
+    SK_SIZE,
+    SK_TIME,
+    SK_EXT,
+};
+
+struct SortOptions
+{
+    SortKey key;
+    bool    reverse;
+    bool    ignoreCase;
+    size_t  threads;  // 0 picks the hardware concurrency
+};
+
+// Tables with at least this many entries are sorted on several threads.
+const size_t ParallelSortThreshold = 128 * 1024;
+
+// Sorts the order column of a table. Directories always come first;
+// within each group entries are ordered by key, and ties keep the
+// order they were read in. Size and time sort with an LSD radix sort
+// on 64 bit keys. Names and extensions radix sort on a cached 8 byte
+// prefix and only compare the remaining bytes when prefixes tie.
+void sortEntries(EntryTable& table, const SortOptions& opts);
+
+// Parses name, size, time, ext or none. Returns false if unknown.
+bool parseSortKey(const char* name, SortKey& dest);
+
+// Stable LSD radix sort of vals by keys, 8 bits per pass. Passes
+// where every key has the same digit are skipped. tmpKeys and tmpVals
+// must hold n elements.
+void radixSort(uint64_t* keys,
+               uint32_t* vals,
+               size_t    n,
+               uint64_t* tmpKeys,
+               uint32_t* tmpVals);
+
+#endif  //_Sort_h_
@@ -0,0 +1,397 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "StatBatch.h"
+#ifdef __linux__
+#include "Stats.h"
+#include "WorkPool.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+// Requests kept in flight by the ring.
+const unsigned RingEntries = 256;
+
+// Entries stated directly to tell if the batch is cached.
+const size_t ProbeEntries = 16;
+
+// Entries stated by one task of the pool.
+const size_t PoolChunk = 64;
+
+// A stat that takes less than this is assumed to come from the cache.
+const chrono::nanoseconds CachedStat(4000);
+
+const unsigned StatxMask = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME;
+
+static void fillFromStatx(DirEntry& ent, const struct statx& st)
+{
+    if (S_ISDIR(st.stx_mode))
+        ent.attrib |= EA_DIRECTORY;
+    else
+        ent.size = (uint64_t)st.stx_size;
+    if ((st.stx_mode & S_IWUSR) == 0)
+        ent.attrib |= EA_READONLY;
+
+    ent.timeWrite = (int64_t)st.stx_mtime.tv_sec * 1000000000 + st.stx_mtime.tv_nsec;
+}
+
+// Describes a dangling link by the link itself.
+static void statLink(int dirfd, DirEntry& ent)
+{
+    struct statx st = {};
+
+    LS_STAT_ADD(SC_STAT_CALLS, 1);
+    if (::statx(dirfd, ent.name, AT_SYMLINK_NOFOLLOW, StatxMask, &st) == 0)
+        fillFromStatx(ent, st);
+}
+
+static void statEntry(int dirfd, DirEntry& ent)
+{
+    struct statx st = {};
+
+    LS_STAT_ADD(SC_STAT_CALLS, 1);
+    if (::statx(dirfd, ent.name, 0, StatxMask, &st) == 0)
+        fillFromStatx(ent, st);
+    else
+        statLink(dirfd, ent);
+}
+
+static void statEach(int dirfd, DirEntry** ents, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        statEntry(dirfd, *ents[i]);
+}
+
+// Stats the first entries of a batch on the calling thread, and
+// returns the number stated. If those were quick enough to have come
+// from the cache, the rest most likely are as well; they are stated
+// here too, since handing them off would only add to the cost.
+static size_t statProbe(int dirfd, DirEntry** ents, size_t count)
+{
+    typedef chrono::steady_clock clock_type;
+
+    size_t                 n     = min(count, ProbeEntries);
+    clock_type::time_point start = clock_type::now();
+    statEach(dirfd, ents, n);
+
+    if (clock_type::now() - start < n * CachedStat)
+    {
+        statEach(dirfd, ents + n, count - n);
+        return count;
+    }
+    return n;
+}
+
+// The pool shared by every reader that has no ring.
+static WorkPool& statPool()
+{
+    static WorkPool pool(min<size_t>(max<size_t>(thread::hardware_concurrency(), 2), 8));
+    return pool;
+}
+
+class PoolStatBatch : public StatBatch
+{
+public:
+    void fill(int dirfd, DirEntry** ents, size_t count) override
+    {
+        size_t probed = statProbe(dirfd, ents, count);
+        if (probed == count)
+            return;
+        ents += probed;
+        count -= probed;
+
+        WorkPool&      pool = statPool();
+        atomic<size_t> left((count + PoolChunk - 1) / PoolChunk);
+
+        for (size_t i = 0; i < count; i += PoolChunk)
+        {
+            DirEntry** first = ents + i;
+            size_t     n     = min(PoolChunk, count - i);
+            pool.submit([dirfd, first, n, &left] {
+                statEach(dirfd, first, n);
+                left--;
+            });
+        }
+        pool.helpWhile([&left] { return left.load() > 0; });
+    }
+};
+
+// io_uring driven through its system calls, with nothing but the
+// kernel headers. Each entry's statx lands in a slot; a slot is free
+// again once its completion has been read.
+class RingStatBatch : public StatBatch
+{
+private:
+    int              m_fd;
+    void*            m_sqRing;
+    size_t           m_sqSize;
+    void*            m_cqRing;
+    size_t           m_cqSize;
+    io_uring_sqe*    m_sqes;
+    size_t           m_sqesSize;
+    unsigned*        m_sqHead;
+    unsigned*        m_sqTail;
+    unsigned         m_sqMask;
+    unsigned*        m_sqArray;
+    unsigned*        m_cqHead;
+    unsigned*        m_cqTail;
+    unsigned         m_cqMask;
+    io_uring_cqe*    m_cqes;
+    unsigned         m_entries;
+    bool             m_broken;
+    struct statx*    m_results;
+    vector<unsigned> m_free;
+    vector<size_t>   m_index;
+
+    bool supportsStatx()
+    {
+        size_t           size  = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+        vector<uint64_t> store((size + 7) / 8);
+        io_uring_probe*  probe = (io_uring_probe*)store.data();
+
+        if (::syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PROBE, probe, 256) < 0)
+            return false;
+        if (probe->last_op < IORING_OP_STATX)
+            return false;
+        return (probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+
+    // Submits what is queued and waits for at least wait completions.
+    // Returns false if the ring can no longer be used.
+    bool enter(unsigned submit, unsigned wait)
+    {
+        while (true)
+        {
+            long rc = ::syscall(__NR_io_uring_enter,
+                                m_fd,
+                                submit,
+                                wait,
+                                wait > 0 ? IORING_ENTER_GETEVENTS : 0,
+                                nullptr,
+                                0);
+            if (rc >= 0)
+            {
+                if ((unsigned)rc >= submit)
+                    return true;
+                submit -= (unsigned)rc;
+                continue;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                return false;
+        }
+    }
+
+public:
+    RingStatBatch() :
+        m_fd(-1),
+        m_sqRing(MAP_FAILED),
+        m_sqSize(0),
+        m_cqRing(MAP_FAILED),
+        m_cqSize(0),
+        m_sqes((io_uring_sqe*)MAP_FAILED),
+        m_sqesSize(0),
+        m_sqHead(nullptr),
+        m_sqTail(nullptr),
+        m_sqMask(0),
+        m_sqArray(nullptr),
+        m_cqHead(nullptr),
+        m_cqTail(nullptr),
+        m_cqMask(0),
+        m_cqes(nullptr),
+        m_entries(0),
+        m_broken(false),
+        m_results(nullptr)
+    {
+    }
+
+    ~RingStatBatch() override
+    {
+        // Closing the ring cancels anything still in flight.
+        if (m_fd != -1)
+            ::close(m_fd);
+        if (m_sqes != MAP_FAILED)
+            ::munmap(m_sqes, m_sqesSize);
+        if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing)
+            ::munmap(m_cqRing, m_cqSize);
+        if (m_sqRing != MAP_FAILED)
+            ::munmap(m_sqRing, m_sqSize);
+        delete[] m_results;
+    }
+
+    // Sets up the ring. Returns false if the kernel does not allow it.
+    bool open()
+    {
+        io_uring_params params = {};
+
+        long fd = ::syscall(__NR_io_uring_setup, RingEntries, &params);
+        if (fd < 0)
+            return false;
+        m_fd = (int)fd;
+
+        if (!supportsStatx())
+            return false;
+
+        m_sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+            m_sqSize = m_cqSize = max(m_sqSize, m_cqSize);
+
+        m_sqRing = ::mmap(nullptr, m_sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+        if (m_sqRing == MAP_FAILED)
+            return false;
+
+        if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+            m_cqRing = m_sqRing;
+        else
+        {
+            m_cqRing = ::mmap(nullptr, m_cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+            if (m_cqRing == MAP_FAILED)
+                return false;
+        }
+
+        m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        m_sqes     = (io_uring_sqe*)::mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+        if (m_sqes == MAP_FAILED)
+            return false;
+
+        char* sq  = (char*)m_sqRing;
+        char* cq  = (char*)m_cqRing;
+        m_sqHead  = (unsigned*)(sq + params.sq_off.head);
+        m_sqTail  = (unsigned*)(sq + params.sq_off.tail);
+        m_sqMask  = *(unsigned*)(sq + params.sq_off.ring_mask);
+        m_sqArray = (unsigned*)(sq + params.sq_off.array);
+        m_cqHead  = (unsigned*)(cq + params.cq_off.head);
+        m_cqTail  = (unsigned*)(cq + params.cq_off.tail);
+        m_cqMask  = *(unsigned*)(cq + params.cq_off.ring_mask);
+        m_cqes    = (io_uring_cqe*)(cq + params.cq_off.cqes);
+        m_entries = params.sq_entries;
+
+        m_results = new struct statx[m_entries];
+        m_index.resize(m_entries);
+        for (unsigned i = m_entries; i > 0; --i)
+            m_free.push_back(i - 1);
+        return true;
+    }
+
+    void fill(int dirfd, DirEntry** ents, size_t count) override
+    {
+        if (m_broken)
+        {
+            statEach(dirfd, ents, count);
+            return;
+        }
+
+        size_t probed = statProbe(dirfd, ents, count);
+        if (probed == count)
+            return;
+        ents += probed;
+        count -= probed;
+
+        LS_STAT_ADD(SC_STAT_CALLS, count);
+
+        size_t next = 0, done = 0;
+        while (done < count)
+        {
+            // Queue as many as there are free slots.
+            unsigned tail   = *m_sqTail;
+            unsigned queued = 0;
+            while (next < count && !m_free.empty())
+            {
+                unsigned slot = m_free.back();
+                m_free.pop_back();
+                m_index[slot] = next;
+
+                unsigned      pos = (tail + queued) & m_sqMask;
+                io_uring_sqe& sqe = m_sqes[pos];
+                memset(&sqe, 0, sizeof sqe);
+                sqe.opcode      = IORING_OP_STATX;
+                sqe.fd          = dirfd;
+                sqe.addr        = (uint64_t)(uintptr_t)ents[next]->name;
+                sqe.len         = StatxMask;
+                sqe.statx_flags = 0;
+                sqe.off         = (uint64_t)(uintptr_t)&m_results[slot];
+                sqe.user_data   = slot;
+
+                m_sqArray[pos] = pos;
+                queued++;
+                next++;
+            }
+            __atomic_store_n(m_sqTail, tail + queued, __ATOMIC_RELEASE);
+
+            if (!enter(queued, 1))
+            {
+                // Whatever has not completed is stated here instead.
+                m_broken = true;
+                for (unsigned slot = 0; slot < m_entries; ++slot)
+                {
+                    if (find(m_free.begin(), m_free.end(), slot) == m_free.end())
+                        statEntry(dirfd, *ents[m_index[slot]]);
+                }
+                statEach(dirfd, ents + next, count - next);
+                return;
+            }
+
+            unsigned head = *m_cqHead;
+            unsigned end  = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+            for (; head != end; ++head)
+            {
+                const io_uring_cqe& cqe  = m_cqes[head & m_cqMask];
+                unsigned            slot = (unsigned)cqe.user_data;
+                DirEntry&           ent  = *ents[m_index[slot]];
+
+                if (cqe.res == 0)
+                    fillFromStatx(ent, m_results[slot]);
+                else
+                    statLink(dirfd, ent);
+
+                m_free.push_back(slot);
+                done++;
+            }
+            __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+        }
+    }
+};
+
+StatBatch* StatBatch::create()
+{
+    RingStatBatch* ring = new RingStatBatch();
+    if (ring->open())
+        return ring;
+
+    delete ring;
+    return new PoolStatBatch();
+}
+
+#endif
@@ -0,0 +1,57 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _StatBatch_h_
+#define _StatBatch_h_
+
+#include "DirectoryReader.h"
+
+// Fills the size, write time and attributes of a batch of entries
+// read from one directory, as one stat per entry would, but without
+// waiting on each stat in turn.
+//
+// The requests go through io_uring where the kernel allows it, with
+// a few hundred statx calls in flight at once. Otherwise the batch is
+// split over a small thread pool. Either way the calls overlap, which
+// is what matters on a cold cache or a network file system, where
+// each stat waits on the disk or the server. A stat served from the
+// cache costs less than handing it off, so the first few entries of
+// every batch are stated directly, and the rest only go out if those
+// had to wait. Linux only.
+class StatBatch
+{
+public:
+    virtual ~StatBatch()
+    {
+    }
+
+    // Describes each entry by its name, relative to dirfd. Entries
+    // that cannot be stated are left as they are.
+    virtual void fill(int dirfd, DirEntry** ents, size_t count) = 0;
+
+    static StatBatch* create();
+};
+
+#endif  //_StatBatch_h_
@@ -0,0 +1,316 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Stats.h"
+
+#ifdef LS_STATS
+
+#include "Format.h"
+#include "RecordFormat.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+struct TraceEvent
+{
+    uint64_t  start;
+    uint64_t  duration;
+    StatPhase phase;
+    string    name;
+};
+
+// The counters of one thread. Blocks are never freed, so they
+// can still be summed after their thread has exited.
+struct StatBlock
+{
+    uint64_t           counters[SC_MAX];
+    uint64_t           phases[SP_MAX];
+    vector<TraceEvent> events;
+    size_t             thread;
+};
+
+const char* const PhaseNames[SP_MAX] = {
+    "enumerate",
+    "sort",
+    "format",
+    "names",
+};
+
+bool StatsEnabled = false;
+
+static bool                    TraceEnabled = false;
+static string                  TracePath;
+static uint64_t                StartTicks = 0;
+static mutex                   BlockLock;
+static vector<StatBlock*>      Blocks;
+static thread_local StatBlock* ThreadBlock = nullptr;
+
+atomic<uint64_t> StatsAllocations(0);
+
+static uint64_t ticks()
+{
+    return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+               chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static StatBlock& threadBlock()
+{
+    if (!ThreadBlock)
+    {
+        StatBlock* block = new StatBlock();
+
+        lock_guard<mutex> lk(BlockLock);
+        block->thread = Blocks.size();
+        Blocks.push_back(block);
+        ThreadBlock = block;
+    }
+    return *ThreadBlock;
+}
+
+void statsEnable(const char* tracePath)
+{
+    StartTicks   = ticks();
+    TracePath    = tracePath ? tracePath : "";
+    TraceEnabled = !TracePath.empty();
+    StatsEnabled = true;
+}
+
+void statsAdd(StatCounter counter, uint64_t count)
+{
+    threadBlock().counters[counter] += count;
+}
+
+StatScope::StatScope(StatPhase phase, const string* name) :
+    m_phase(phase),
+    m_start(StatsEnabled ? ticks() : 0),
+    m_name(TraceEnabled ? name : nullptr)
+{
+}
+
+StatScope::~StatScope()
+{
+    if (m_start == 0)
+        return;
+
+    uint64_t   now   = ticks();
+    StatBlock& block = threadBlock();
+    block.phases[m_phase] += now - m_start;
+
+    if (m_name)
+        block.events.push_back({m_start, now - m_start, m_phase, *m_name});
+}
+
+static uint64_t peakMemory()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc = {};
+    if (::K32GetProcessMemoryInfo(::GetCurrentProcess(), &pmc, sizeof pmc))
+        return (uint64_t)pmc.PeakWorkingSetSize;
+    return 0;
+#else
+    rusage usage = {};
+    if (::getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return (uint64_t)usage.ru_maxrss;
+#else
+    return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+static void writeLabel(Output& out, const char* label)
+{
+    size_t len = strlen(label);
+    out.setColor(CS_LIGHT_GREY);
+    out.pad(4);
+    out.write(label, len);
+    out.pad(len < 16 ? 16 - len : 1);
+    out.setColor(CS_YELLOW);
+}
+
+static void writeCount(Output& out, const char* label, uint64_t val)
+{
+    char  buf[FormatBufferSize];
+    char* end = formatGrouped(buf, val);
+
+    writeLabel(out, label);
+    out.writeRight(buf, (size_t)(end - buf), 14);
+}
+
+static void writeSeconds(Output& out, const char* label, double val)
+{
+    char buf[FormatBufferSize];
+    int  len = snprintf(buf, sizeof buf, "%.3f s", val);
+
+    writeLabel(out, label);
+    out.writeRight(buf, len > 0 ? (size_t)len : 0, 16);
+}
+
+void writeStats(Output& out, const Output& listing)
+{
+    StatBlock total = {};
+    {
+        lock_guard<mutex> lk(BlockLock);
+        for (const StatBlock* block : Blocks)
+        {
+            for (int i = 0; i < SC_MAX; ++i)
+                total.counters[i] += block->counters[i];
+            for (int i = 0; i < SP_MAX; ++i)
+                total.phases[i] += block->phases[i];
+        }
+    }
+
+    double wall    = (double)(ticks() - StartTicks) / 1e9;
+    double entries = (double)total.counters[SC_ENTRIES];
+
+    out.setColor(CS_WHITE);
+    out.write("\nStatistics:\n");
+
+    writeSeconds(out, "wall time", wall);
+    out.put('\n');
+    writeCount(out, "directories", total.counters[SC_DIRECTORIES]);
+    out.put('\n');
+    writeCount(out, "entries", total.counters[SC_ENTRIES]);
+    if (wall > 0)
+    {
+        char  buf[FormatBufferSize];
+        char* end = formatGrouped(buf, (uint64_t)(entries / wall));
+
+        out.setColor(CS_LIGHT_GREY);
+        out.write(", ");
+        out.write(buf, (size_t)(end - buf));
+        out.write(" per second");
+    }
+    out.put('\n');
+    writeCount(out, "read calls", total.counters[SC_READ_CALLS]);
+    out.put('\n');
+    writeCount(out, "stat calls", total.counters[SC_STAT_CALLS]);
+    out.put('\n');
+    writeCount(out, "allocations", StatsAllocations.load(memory_order_relaxed));
+    out.put('\n');
+    writeCount(out, "peak memory", peakMemory() / 1024);
+    out.write(" KB\n");
+
+    // Phases are summed over all threads.
+    for (int i = 0; i < SP_MAX; ++i)
+    {
+        writeSeconds(out, PhaseNames[i], (double)total.phases[i] / 1e9);
+        out.put('\n');
+    }
+
+    double first = listing.firstWriteSeconds();
+    writeSeconds(out, "output", listing.writeSeconds());
+    out.setColor(CS_LIGHT_GREY);
+    out.write(", ");
+    out.writeNumber(listing.writeCalls());
+    out.write(" writes\n");
+    if (first >= 0)
+    {
+        writeSeconds(out, "first output", first);
+        out.put('\n');
+    }
+    out.setColor(CS_WHITE);
+}
+
+// Hands what an Output renders to the trace file.
+class TraceFile : public OutputSink
+{
+private:
+    FILE* m_fp;
+
+public:
+    explicit TraceFile(FILE* fp) :
+        m_fp(fp)
+    {
+    }
+
+    void write(const char* data, size_t len) override
+    {
+        fwrite(data, 1, len, m_fp);
+    }
+};
+
+bool writeTrace()
+{
+    if (!TraceEnabled)
+        return true;
+
+    FILE* fp = fopen(TracePath.c_str(), "wb");
+    if (!fp)
+        return false;
+
+    TraceFile file(fp);
+    {
+        lock_guard<mutex> lk(BlockLock);
+
+        Output out(file);
+        out.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+        bool first = true;
+        char buf[160];
+        for (const StatBlock* block : Blocks)
+        {
+            for (const TraceEvent& evt : block->events)
+            {
+                out.write(first ? "\n" : ",\n");
+                first = false;
+
+                out.write("{\"name\":\"");
+                if (evt.name.empty())
+                    out.put('.');
+                else
+                    writeJsonString(out, evt.name.data(), evt.name.size());
+
+                int len = snprintf(buf,
+                                   sizeof buf,
+                                   "\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                                   PhaseNames[evt.phase],
+                                   (double)(evt.start - StartTicks) / 1e3,
+                                   (double)evt.duration / 1e3,
+                                   (unsigned)block->thread);
+                if (len > 0 && (size_t)len < sizeof buf)
+                    out.write(buf, (size_t)len);
+            }
+        }
+        out.write("\n]}\n");
+    }
+    return fclose(fp) == 0;
+}
+
+#endif
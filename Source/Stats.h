@@ -0,0 +1,119 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _Stats_h_
+#define _Stats_h_
+
+// Counters and phase timers behind --stats and --trace.
+//
+// Everything here exists only when built with LS_STATS, which the
+// ListDir_USE_STATS CMake option defines. Without it the LS_STAT
+// macros expand to nothing, so instrumented code costs nothing. With
+// it, the macros check a single flag until statsEnable is called.
+//
+// Each thread counts into its own block, so the walk threads do not
+// share cache lines. The blocks are summed when the report is written,
+// after the workers are done.
+#ifdef LS_STATS
+
+#include "Output.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+enum StatCounter
+{
+    SC_DIRECTORIES = 0,
+    SC_ENTRIES,
+    SC_READ_CALLS,  // opening, reading and closing directories
+    SC_STAT_CALLS,  // describing single entries
+    SC_MAX
+};
+
+enum StatPhase
+{
+    SP_ENUMERATE = 0,
+    SP_SORT,
+    SP_FORMAT,
+    SP_NAMES,
+    SP_MAX
+};
+
+extern bool StatsEnabled;
+
+// Allocations counted while enabled. The library leaves operator new
+// alone; a program that wants them counted adds to this itself.
+extern std::atomic<uint64_t> StatsAllocations;
+
+// Starts counting. If tracePath is not empty, a span is also
+// recorded for every traced scope and written by writeTrace.
+void statsEnable(const char* tracePath);
+
+void statsAdd(StatCounter counter, uint64_t count);
+
+// Adds the time until it goes out of scope to a phase. Given a
+// name, it is also recorded as a span in the trace.
+class StatScope
+{
+private:
+    StatPhase          m_phase;
+    uint64_t           m_start;
+    const std::string* m_name;
+
+public:
+    explicit StatScope(StatPhase phase, const std::string* name = nullptr);
+    ~StatScope();
+
+    StatScope(const StatScope&) = delete;
+    StatScope& operator=(const StatScope&) = delete;
+};
+
+// Writes the totals to out, with the counters of listing, the
+// output the listing went to.
+void writeStats(Output& out, const Output& listing);
+
+// Writes the recorded spans as a Chrome trace, which Perfetto and
+// chrome://tracing open directly.
+bool writeTrace();
+
+#define LS_STAT_ADD(counter, count)   \
+    do                                \
+    {                                 \
+        if (StatsEnabled)             \
+            statsAdd(counter, count); \
+    } while (0)
+
+#define LS_STAT_SCOPE(phase) StatScope statScope_(phase)
+#define LS_TRACE_SCOPE(phase, name) StatScope statScope_(phase, &(name))
+
+#else
+
+#define LS_STAT_ADD(counter, count) ((void)0)
+#define LS_STAT_SCOPE(phase) ((void)0)
+#define LS_TRACE_SCOPE(phase, name) ((void)0)
+
+#endif
+
+#endif  //_Stats_h_
@@ -0,0 +1,224 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "TreeGenerator.h"
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+const size_t DeepFiles    = 4;
+const size_t MixedFanout  = 8;
+const size_t MaxFiles     = 64;
+const size_t MaxRandom    = 48;
+const size_t DeepRandom   = 4;
+const size_t PathReserve  = 128;
+const char   NameChars[]  = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-";
+
+// splitmix64; the standard distributions are not the same
+// everywhere, so the tree is built from raw 64 bit values.
+class TreeRandom
+{
+private:
+    uint64_t m_state;
+
+public:
+    explicit TreeRandom(uint64_t seed) :
+        m_state(seed)
+    {
+    }
+
+    uint64_t next()
+    {
+        uint64_t z = (m_state += 0x9E3779B97F4A7C15ULL);
+        z          = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z          = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    size_t below(size_t n)
+    {
+        return (size_t)(next() % n);
+    }
+};
+
+class TreeBuilder
+{
+private:
+    TreeRandom m_random;
+    TreeStats& m_stats;
+    string     m_path;
+
+    void makeName(size_t index, bool hidden, size_t maxRandom)
+    {
+        size_t len = 1 + m_random.below(maxRandom);
+        if (hidden)
+            m_path.push_back('.');
+        for (size_t i = 0; i < len; ++i)
+            m_path.push_back(NameChars[m_random.below(sizeof NameChars - 1)]);
+
+        // The suffix keeps names unique within a directory.
+        m_path.push_back('.');
+        m_path.append(to_string(index));
+    }
+
+public:
+    TreeBuilder(uint64_t seed, TreeStats& stats) :
+        m_random(seed),
+        m_stats(stats)
+    {
+    }
+
+    bool addDirectory(const string& path)
+    {
+        if (::mkdir(path.c_str(), 0755) != 0)
+            return false;
+        m_stats.directories++;
+        return true;
+    }
+
+    // Adds a sub directory with a random name to dir; dest gets its path.
+    bool addSubDirectory(const string& dir, size_t index, size_t maxRandom, string& dest)
+    {
+        m_path.assign(dir).push_back('/');
+        makeName(index, m_random.below(20) == 0, maxRandom);
+        dest = m_path;
+        return addDirectory(dest);
+    }
+
+    bool addFile(const string& dir, size_t index)
+    {
+        m_path.assign(dir).push_back('/');
+        makeName(index, m_random.below(20) == 0, MaxRandom);
+
+        // Mostly small, with a long tail up to 4 GB.
+        uint64_t size = m_random.next() & ((1ULL << m_random.below(33)) - 1);
+
+        int fd = ::open(m_path.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+        if (fd < 0)
+            return false;
+
+        bool result = ::ftruncate(fd, (off_t)size) == 0;
+        ::close(fd);
+
+        m_stats.files++;
+        m_stats.bytes += size;
+        return result;
+    }
+
+    size_t below(size_t n)
+    {
+        return m_random.below(n);
+    }
+};
+
+bool parseTreeShape(const char* name, TreeShape& dest)
+{
+    if (strcmp(name, "wide") == 0)
+        dest = GS_WIDE;
+    else if (strcmp(name, "deep") == 0)
+        dest = GS_DEEP;
+    else if (strcmp(name, "mixed") == 0)
+        dest = GS_MIXED;
+    else
+        return false;
+    return true;
+}
+
+bool generateTree(const string& root, const TreeSpec& spec, TreeStats& stats)
+{
+    stats = {};
+
+    TreeBuilder builder(spec.seed, stats);
+    if (!builder.addDirectory(root))
+        return false;
+
+    size_t i;
+    switch (spec.shape)
+    {
+    case GS_WIDE:
+        for (i = 0; i < spec.count; ++i)
+        {
+            if (!builder.addFile(root, i))
+                return false;
+        }
+        break;
+    case GS_DEEP:
+    {
+        string dir = root, sub;
+        for (size_t level = 0; level < spec.count; ++level)
+        {
+            for (i = 0; i < DeepFiles; ++i)
+            {
+                if (!builder.addFile(dir, i))
+                    return false;
+            }
+
+            // Leave room for the longest name below.
+            if (dir.size() + 2 * PathReserve >= PATH_MAX)
+                break;
+            if (!builder.addSubDirectory(dir, DeepFiles, DeepRandom, sub))
+                return false;
+            dir.swap(sub);
+        }
+        break;
+    }
+    case GS_MIXED:
+    {
+        deque<string> pending;
+        pending.push_back(root);
+
+        size_t entries = 0;
+        while (!pending.empty() && entries < spec.count)
+        {
+            string dir = std::move(pending.front());
+            pending.pop_front();
+
+            size_t files = 1 + builder.below(MaxFiles);
+            for (i = 0; i < files && entries < spec.count; ++i, ++entries)
+            {
+                if (!builder.addFile(dir, i))
+                    return false;
+            }
+
+            string sub;
+            for (i = 0; i < MixedFanout && entries < spec.count; ++i, ++entries)
+            {
+                if (dir.size() + PathReserve >= PATH_MAX)
+                    break;
+                if (!builder.addSubDirectory(dir, files + i, MaxRandom, sub))
+                    return false;
+                pending.push_back(sub);
+            }
+        }
+        break;
+    }
+    }
+    return true;
+}
@@ -0,0 +1,73 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _TreeGenerator_h_
+#define _TreeGenerator_h_
+
+#include <cstdint>
+#include <string>
+
+// Shapes of synthetic trees for ls_bench.
+//
+//  wide   one directory holding count files.
+//  deep   a chain of nested directories with short names and a few
+//         files in each, as deep as the path length allows, up to
+//         count levels.
+//  mixed  directories of 8 sub directories and 1 to 64 files,
+//         filled breadth first until count entries exist.
+//
+// Names are 1 to 48 random characters followed by a unique suffix,
+// about one in twenty is hidden, and file sizes are spread over
+// several orders of magnitude. Files are created sparse, so large
+// trees fit in a tmpfs.
+enum TreeShape
+{
+    GS_WIDE = 0,
+    GS_DEEP,
+    GS_MIXED,
+};
+
+struct TreeSpec
+{
+    TreeShape shape;
+    size_t    count;
+    uint64_t  seed;  // the same seed makes the same tree
+};
+
+struct TreeStats
+{
+    uint64_t files;
+    uint64_t directories;
+    uint64_t bytes;
+};
+
+// Parses wide, deep or mixed. Returns false if unknown.
+bool parseTreeShape(const char* name, TreeShape& dest);
+
+// Creates the tree described by spec below root, which must not
+// exist yet. Returns false if anything could not be created.
+bool generateTree(const std::string& root, const TreeSpec& spec, TreeStats& stats);
+
+#endif  //_TreeGenerator_h_
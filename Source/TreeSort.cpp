@@ -0,0 +1,287 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "TreeSort.h"
+#include "Platform.h"
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+
+// The extension of the last component of a path,
+// or an empty string if it has none.
+static string pathExtension(const string& path)
+{
+    size_t start = path.find_last_of(Seperator);
+    start        = start == string::npos ? 0 : start + 1;
+
+    size_t dot = path.find_last_of('.');
+    if (dot == string::npos || dot <= start)
+        return string();
+    return path.substr(dot + 1);
+}
+
+TreeOrder::TreeOrder(SortKey key, bool reverse, bool ignoreCase) :
+    m_key(key),
+    m_reverse(reverse),
+    m_ignoreCase(ignoreCase)
+{
+}
+
+uint64_t TreeOrder::key(uint64_t size, int64_t timeWrite) const
+{
+    uint64_t key = 0;
+    if (m_key == SK_SIZE)
+        key = size;
+    else if (m_key == SK_TIME)
+    {
+        // Flip the sign bit so negative times order first.
+        key = (uint64_t)timeWrite ^ (uint64_t(1) << 63);
+    }
+    return m_reverse ? ~key : key;
+}
+
+bool TreeOrder::less(const ManifestEntry& a, const ManifestEntry& b) const
+{
+    uint64_t ka = key(a.size, a.timeWrite);
+    uint64_t kb = key(b.size, b.timeWrite);
+    if (ka != kb)
+        return ka < kb;
+
+    // Folded as sortEntries folds, then exactly, so the order is total.
+    int c = 0;
+    if (m_key == SK_EXT)
+    {
+        string ea = pathExtension(a.path), eb = pathExtension(b.path);
+        c         = comparePaths(ea, eb, m_ignoreCase);
+    }
+    if (c == 0)
+        c = comparePaths(a.path, b.path, m_ignoreCase);
+    if (c == 0 && m_ignoreCase)
+        c = comparePaths(a.path, b.path);
+    return m_reverse ? c > 0 : c < 0;
+}
+
+EntryRanking::EntryRanking(size_t count, const TreeOrder& order) :
+    m_count(count),
+    m_order(order)
+{
+}
+
+bool EntryRanking::accepts(uint64_t size, int64_t timeWrite) const
+{
+    if (m_count == 0)
+        return false;
+    if (m_heap.size() < m_count)
+        return true;
+
+    const ManifestEntry& last = m_heap.front();
+    return m_order.key(size, timeWrite) <= m_order.key(last.size, last.timeWrite);
+}
+
+void EntryRanking::add(const ManifestEntry& ent)
+{
+    auto less = [this](const ManifestEntry& a, const ManifestEntry& b) {
+        return m_order.less(a, b);
+    };
+
+    if (m_count == 0)
+        return;
+    if (m_heap.size() < m_count)
+    {
+        m_heap.push_back(ent);
+        push_heap(m_heap.begin(), m_heap.end(), less);
+    }
+    else if (less(ent, m_heap.front()))
+    {
+        pop_heap(m_heap.begin(), m_heap.end(), less);
+        m_heap.back() = ent;
+        push_heap(m_heap.begin(), m_heap.end(), less);
+    }
+}
+
+void EntryRanking::take(vector<ManifestEntry>& dest)
+{
+    sort_heap(m_heap.begin(), m_heap.end(), [this](const ManifestEntry& a, const ManifestEntry& b) {
+        return m_order.less(a, b);
+    });
+    dest = std::move(m_heap);
+    m_heap.clear();
+}
+
+TreeSorter::TreeSorter(const TreeOrder& order, uint64_t budget) :
+    m_order(order),
+    m_budget(budget),
+    m_pathBytes(0),
+    m_pos(0),
+    m_unspillable(false),
+    m_failed(false)
+{
+}
+
+TreeSorter::~TreeSorter()
+{
+    // The mappings have to go before the files on Windows.
+    m_readers.clear();
+    for (const string& path : m_spills)
+        remove(path.c_str());
+    if (!m_directory.empty())
+        removeDirectory(m_directory.c_str());
+}
+
+void TreeSorter::sortRun()
+{
+    sort(m_run.begin(), m_run.end(), [this](const ManifestEntry& a, const ManifestEntry& b) {
+        return m_order.less(a, b);
+    });
+}
+
+bool TreeSorter::spill()
+{
+    sortRun();
+
+    // The runs go in a directory of their own, so no one
+    // else can put a file or a link where one is written.
+    bool ok = !m_directory.empty() || temporaryDirectory(m_directory);
+    if (ok)
+    {
+        string path = m_directory;
+        path.push_back(Seperator);
+        path.append("sort-").append(to_string(m_spills.size())).append(".run");
+
+        ManifestWriter writer;
+        ok = writer.open(path.c_str());
+        if (ok)
+        {
+            for (const ManifestEntry& ent : m_run)
+                writer.add(ent);
+            ok = writer.close();
+        }
+
+        if (ok)
+            m_spills.push_back(path);
+    }
+    else
+        m_directory.clear();
+
+    // A run that could not be written stays in memory; an entry
+    // is never dropped to stay within the budget.
+    if (ok)
+    {
+        m_run.clear();
+        m_pathBytes = 0;
+    }
+    return ok;
+}
+
+void TreeSorter::add(const ManifestEntry& ent)
+{
+    // The run is spilled before the vector would grow past the budget.
+    size_t   capacity = m_run.size() < m_run.capacity() ? m_run.capacity() : max<size_t>(16, m_run.capacity() * 2);
+    uint64_t needed   = (uint64_t)capacity * sizeof(ManifestEntry) + m_pathBytes + ent.path.size();
+    if (needed > m_budget && !m_run.empty() && !m_unspillable)
+    {
+        if (!spill())
+            m_unspillable = true;
+    }
+
+    m_run.push_back(ent);
+    m_pathBytes += ent.path.size();
+}
+
+bool TreeSorter::finish()
+{
+    sortRun();
+    m_pos = 0;
+    m_heads.clear();
+    m_readers.clear();
+
+    for (const string& path : m_spills)
+    {
+        unique_ptr<ManifestReader> reader(new ManifestReader());
+        if (!reader->open(path.c_str()))
+            m_failed = true;
+        m_readers.push_back(std::move(reader));
+    }
+
+    // The run still in memory is the last source.
+    size_t i;
+    for (i = 0; i <= m_readers.size(); ++i)
+    {
+        Head head;
+        head.source = i;
+        if (nextFrom(i, head.ent))
+            m_heads.push_back(std::move(head));
+    }
+
+    make_heap(m_heads.begin(), m_heads.end(), [this](const Head& a, const Head& b) {
+        return headLess(a, b);
+    });
+    return !m_failed;
+}
+
+bool TreeSorter::headLess(const Head& a, const Head& b) const
+{
+    // The heap keeps the greatest at the front,
+    // so the first in order is the greatest here.
+    return m_order.less(b.ent, a.ent);
+}
+
+bool TreeSorter::nextFrom(size_t source, ManifestEntry& dest)
+{
+    if (source < m_readers.size())
+    {
+        if (m_readers[source]->next(dest))
+            return true;
+        if (m_readers[source]->damaged())
+            m_failed = true;
+        return false;
+    }
+
+    if (m_pos >= m_run.size())
+        return false;
+    dest = std::move(m_run[m_pos++]);
+    return true;
+}
+
+bool TreeSorter::next(ManifestEntry& dest)
+{
+    if (m_heads.empty())
+        return false;
+
+    auto less = [this](const Head& a, const Head& b) {
+        return headLess(a, b);
+    };
+
+    pop_heap(m_heads.begin(), m_heads.end(), less);
+
+    Head& head = m_heads.back();
+    dest       = std::move(head.ent);
+    if (nextFrom(head.source, head.ent))
+        push_heap(m_heads.begin(), m_heads.end(), less);
+    else
+        m_heads.pop_back();
+    return true;
+}
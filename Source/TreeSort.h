@@ -0,0 +1,147 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _TreeSort_h_
+#define _TreeSort_h_
+
+#include "Manifest.h"
+#include "Sort.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// An order over the entries of a whole tree. Size and time order by
+// a 64 bit key, name by path, and extension by the extension of the
+// last component. Ties fall back to the path, so the order is total.
+// Without a key, entries are in path order. With ignoreCase, paths and
+// extensions compare with letters folded, as sortEntries does.
+class TreeOrder
+{
+private:
+    SortKey m_key;
+    bool    m_reverse;
+    bool    m_ignoreCase;
+
+public:
+    explicit TreeOrder(SortKey key = SK_NONE, bool reverse = false, bool ignoreCase = false);
+
+    // The numeric part of the order; a smaller key comes first.
+    uint64_t key(uint64_t size, int64_t timeWrite) const;
+
+    bool less(const ManifestEntry& a, const ManifestEntry& b) const;
+};
+
+// Keeps the count entries offered to it that come first in an order,
+// in a heap with the last of them at the front, for --largest and
+// --newest. Memory is bounded by count no matter how many entries
+// are offered.
+class EntryRanking
+{
+private:
+    size_t                     m_count;
+    TreeOrder                  m_order;
+    std::vector<ManifestEntry> m_heap;
+
+public:
+    EntryRanking(size_t count, const TreeOrder& order);
+
+    // False if an entry with this size and time would not be kept,
+    // so the caller can skip building its path.
+    bool accepts(uint64_t size, int64_t timeWrite) const;
+
+    void add(const ManifestEntry& ent);
+
+    // Moves the kept entries into dest, in order.
+    void take(std::vector<ManifestEntry>& dest);
+};
+
+// Sorts the entries of a whole tree within a memory budget, for
+// --global-sort.
+//
+// Entries are gathered into a run until the run would grow past the
+// budget. The run is then sorted and spilled to a temporary file in
+// the manifest format, and a new run is started. The files go in a
+// directory only this user can reach, made on the first spill. Once
+// every entry is added, the runs are merged through a heap holding one
+// entry per run, each read from a mapping of its file. Nothing is
+// spilled when the tree fits; the files and their directory are
+// removed with the sorter. If a run cannot be written, it and every
+// entry after it are kept in memory instead, past the budget.
+class TreeSorter : public ManifestSource
+{
+private:
+    struct Head
+    {
+        ManifestEntry ent;
+        size_t        source;
+    };
+
+    TreeOrder                                    m_order;
+    uint64_t                                     m_budget;
+    uint64_t                                     m_pathBytes;
+    std::vector<ManifestEntry>                   m_run;
+    size_t                                       m_pos;
+    std::string                                  m_directory;  // of the spills
+    std::vector<std::string>                     m_spills;
+    std::vector<std::unique_ptr<ManifestReader>> m_readers;
+    std::vector<Head>                            m_heads;
+    bool                                         m_unspillable;  // the rest stays in memory
+    bool                                         m_failed;
+
+    void sortRun();
+    bool spill();
+    bool nextFrom(size_t source, ManifestEntry& dest);
+    bool headLess(const Head& a, const Head& b) const;
+
+public:
+    TreeSorter(const TreeOrder& order, uint64_t budget);
+    ~TreeSorter();
+
+    TreeSorter(const TreeSorter&) = delete;
+    TreeSorter& operator=(const TreeSorter&) = delete;
+
+    void add(const ManifestEntry& ent);
+
+    // Starts the merge. Returns false if a spilled run could not be
+    // read back, in which case entries would be missing from it.
+    bool finish();
+
+    bool next(ManifestEntry& dest) override;
+
+    // True if a spilled run could not be read back in full.
+    bool failed() const
+    {
+        return m_failed;
+    }
+
+    // The runs spilled to disk.
+    size_t runs() const
+    {
+        return m_spills.size();
+    }
+};
+
+#endif  //_TreeSort_h_
@@ -0,0 +1,254 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Walk.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+using namespace std;
+
+DirectoryReader& threadReader()
+{
+    // Readers keep a large buffer, so there is one per thread.
+    static thread_local unique_ptr<DirectoryReader> reader(DirectoryReader::create());
+    return *reader;
+}
+
+bool isDotEntry(const char* cp)
+{
+    return (cp[0] == '.' && cp[1] == '\0') ||
+           (cp[0] == '.' && cp[1] == '.' && cp[2] == '\0');
+}
+
+void readDirectory(DirectoryListing& dest,
+                   const string&     callDir,
+                   const string&     subDir,
+                   const GlobSet&    args,
+                   const Options&    opts)
+{
+    EntryTable& table = dest.entries;
+
+    dest.subDir = subDir;
+
+    // One pass over the directory; the patterns are matched here
+    // rather than by the file system, and the sub directories for
+    // -R are collected from the same entries.
+    string path;
+    combinePath(path, callDir, subDir, string());
+    enterScope(dest.scope, path, subDir, opts);
+
+    // Pruned entries are dropped before anything else looks at them,
+    // so nothing below a pruned directory is ever read.
+    bool descend = opts.recursive && withinDepth(dest.scope.depth + 1, opts);
+    forEachEntry(path, opts, [&](const DirEntry& ent) {
+        if (isPruned(ent, subDir, dest.scope, opts))
+            return;
+        if (descend && shouldDescend(ent, opts))
+            dest.dirs.push_back(string(ent.name, ent.nameLen));
+
+        if (shouldBeIncluded(ent, opts) && args.match(ent.name, ent.nameLen))
+            table.add(ent);
+    });
+
+    if (!table.empty())
+    {
+        LS_STAT_SCOPE(SP_SORT);
+        sortEntries(table, sortOptions(opts));
+    }
+}
+
+DirectoryWalk::DirectoryWalk() :
+    m_patterns(nullptr),
+    m_opts(nullptr),
+    m_current()
+{
+}
+
+void DirectoryWalk::open(const string& root, const GlobSet& patterns, const Options& opts)
+{
+    m_root     = root;
+    m_patterns = &patterns;
+    m_opts     = &opts;
+    m_levels.clear();
+    push(string(), WalkScope());
+}
+
+void DirectoryWalk::push(const string& subDir, const WalkScope& scope)
+{
+    m_levels.push_back(Level());
+
+    Level& level        = m_levels.back();
+    level.pos           = 0;
+    level.dir           = 0;
+    level.listing.scope = scope;
+    readDirectory(level.listing, m_root, subDir, *m_patterns, *m_opts);
+}
+
+bool DirectoryWalk::next(WalkEntry& dest)
+{
+    while (!m_levels.empty())
+    {
+        Level&            level = m_levels.back();
+        const EntryTable& table = level.listing.entries;
+        if (level.pos < table.size())
+        {
+            table.get(table.at(level.pos++), dest.ent);
+            dest.subDir = &level.listing.subDir;
+            dest.depth  = m_levels.size() - 1;
+            return true;
+        }
+
+        // The entries are done; on to the sub directories.
+        if (level.dir < level.listing.dirs.size())
+        {
+            string subDir;
+            combinePath(subDir, level.listing.subDir, level.listing.dirs[level.dir++], string());
+            push(subDir, childScope(level.listing.scope));
+            continue;
+        }
+        m_levels.pop_back();
+    }
+    return false;
+}
+
+void DirectoryWalk::skipDirectory()
+{
+    if (m_levels.empty())
+        return;
+
+    Level& level = m_levels.back();
+    level.pos    = level.listing.entries.size();
+    level.dir    = level.listing.dirs.size();
+}
+
+DirectoryWalk::iterator DirectoryWalk::begin()
+{
+    if (!next(m_current))
+        return end();
+    return iterator(this);
+}
+
+bool walkTree(const string& root, const GlobSet& patterns, const Options& opts, ListVisitor& visitor)
+{
+    DirectoryWalk walk;
+    WalkEntry     item;
+
+    walk.open(root, patterns, opts);
+    while (walk.next(item))
+    {
+        switch (visitor.visit(item))
+        {
+        case WA_SKIP:
+            walk.skipDirectory();
+            break;
+        case WA_STOP:
+            return false;
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+ManifestWalk::ManifestWalk() :
+    m_patterns(nullptr),
+    m_opts(nullptr),
+    m_writer(nullptr)
+{
+}
+
+void ManifestWalk::open(const string& root, const GlobSet& patterns, const Options& opts)
+{
+    m_root     = root;
+    m_patterns = &patterns;
+    m_opts     = &opts;
+    m_levels.clear();
+    push(string(), WalkScope());
+}
+
+void ManifestWalk::push(const string& subDir, const WalkScope& scope)
+{
+    m_levels.push_back(Level());
+
+    Level& level = m_levels.back();
+    level.pos    = 0;
+    level.subDir = subDir;
+    level.scope  = scope;
+
+    string path;
+    combinePath(path, m_root, subDir, string());
+    enterScope(level.scope, path, subDir, *m_opts);
+
+    forEachEntry(path, *m_opts, [&](const DirEntry& ent) {
+        if (!isPruned(ent, subDir, level.scope, *m_opts))
+            level.entries.add(ent);
+    });
+
+    // By name alone; the walk puts each directory's
+    // contents straight after it.
+    EntryTable& table = level.entries;
+    sort(table.order().begin(), table.order().end(), [&table](uint32_t a, uint32_t b) {
+        return strcmp(table.name(a), table.name(b)) < 0;
+    });
+}
+
+bool ManifestWalk::next(ManifestEntry& dest)
+{
+    DirEntry ent = {};
+    while (!m_levels.empty())
+    {
+        Level& level = m_levels.back();
+        if (level.pos >= level.entries.size())
+        {
+            m_levels.pop_back();
+            continue;
+        }
+
+        level.entries.get(level.entries.at(level.pos++), ent);
+        dest.path.assign(level.subDir).append(ent.name, ent.nameLen);
+        dest.size      = ent.size;
+        dest.timeWrite = ent.timeWrite;
+        dest.attrib    = ent.attrib;
+
+        bool include = shouldBeIncluded(ent, *m_opts) && m_patterns->match(ent.name, ent.nameLen);
+        if (m_opts->recursive && shouldDescend(ent, *m_opts) && withinDepth(level.scope.depth + 1, *m_opts))
+        {
+            // Invalidates level.
+            WalkScope scope  = childScope(level.scope);
+            string    subDir = dest.path;
+            subDir.push_back(Seperator);
+            push(subDir, scope);
+        }
+
+        if (include)
+        {
+            if (m_writer)
+                m_writer->add(dest);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,274 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _Walk_h_
+#define _Walk_h_
+
+#include "DirectoryIndex.h"
+#include "DirectoryReader.h"
+#include "EntryTable.h"
+#include "Glob.h"
+#include "Listing.h"
+#include "Manifest.h"
+#include "Platform.h"
+#include "Stats.h"
+#include <string>
+#include <vector>
+
+// The reader of the calling thread.
+DirectoryReader& threadReader();
+
+// True for the . and .. entries.
+bool isDotEntry(const char* cp);
+
+// Calls visit for each entry of a directory, except . and ..
+// With --index, an unchanged directory is served from the index;
+// any other is read from the file system and stored back.
+template <typename Visit>
+void forEachEntry(const std::string& path, const Options& opts, Visit visit)
+{
+    DirEntry       ent   = {};
+    DirectoryStamp stamp = {};
+
+    LS_TRACE_SCOPE(SP_ENUMERATE, path);
+    LS_STAT_ADD(SC_DIRECTORIES, 1);
+
+    bool stamped = opts.index && directoryStamp(path.c_str(), stamp);
+    if (stamped)
+    {
+        IndexCursor cur;
+        if (opts.index->find(stamp, cur))
+        {
+            DirectoryStamp sub;
+            std::string    child;
+            while (cur.next(ent))
+            {
+                // A sub directory changes without changing its parent.
+                if ((ent.attrib & EA_DIRECTORY) != 0)
+                {
+                    child.assign(path).append(ent.name, ent.nameLen);
+                    if (directoryStamp(child.c_str(), sub))
+                        ent.timeWrite = sub.timeWrite;
+                }
+                LS_STAT_ADD(SC_ENTRIES, 1);
+                visit(ent);
+            }
+            return;
+        }
+    }
+
+    EntryTable       read;
+    DirectoryReader& reader = threadReader();
+    if (!reader.open(path.c_str(), opts.metadata))
+        return;
+
+    while (reader.next(ent))
+    {
+        if (isDotEntry(ent.name))
+            continue;
+        if (stamped)
+            read.add(ent);
+        LS_STAT_ADD(SC_ENTRIES, 1);
+        visit(ent);
+    }
+    reader.close();
+
+    if (stamped)
+        opts.index->store(stamp, read);
+}
+
+// Reads and sorts one directory below callDir. With opts.recursive,
+// the sub directories to descend into are collected into dest.dirs.
+// dest.scope must hold what the directory inherits; the directory's
+// own ignore file is added to it.
+void readDirectory(DirectoryListing&  dest,
+                   const std::string& callDir,
+                   const std::string& subDir,
+                   const GlobSet&     args,
+                   const Options&     opts);
+
+// An entry yielded by a walk. The name points into the walk and is
+// only valid until the walk moves on; nothing is copied for it.
+struct WalkEntry
+{
+    const std::string* subDir;  // relative to the root; empty or ends with a separator
+    DirEntry           ent;
+    size_t             depth;   // 0 for the entries of the root
+};
+
+// Pulls the entries of a tree one at a time, in the order the
+// listing writes them: the entries of a directory, then each of its
+// sub directories in turn. One directory per level is held in memory,
+// and the caller can stop at any point.
+//
+//  DirectoryWalk walk;
+//  walk.open(root, patterns, opts);
+//  for (const WalkEntry& item : walk)
+//      ...
+//
+// The entries follow the filters, the sort order and the index of
+// opts; sub directories are entered only with opts.recursive.
+class DirectoryWalk
+{
+private:
+    struct Level
+    {
+        DirectoryListing listing;
+        size_t           pos;
+        size_t           dir;
+    };
+
+    std::string        m_root;
+    const GlobSet*     m_patterns;
+    const Options*     m_opts;
+    std::vector<Level> m_levels;
+    WalkEntry          m_current;
+
+    void push(const std::string& subDir, const WalkScope& scope);
+
+public:
+    DirectoryWalk();
+
+    // Starts a walk over root. patterns and opts must outlive the walk.
+    void open(const std::string& root, const GlobSet& patterns, const Options& opts);
+
+    // Fills dest with the next entry. Returns false at the end.
+    bool next(WalkEntry& dest);
+
+    // Skips whatever is left of the directory the last entry came
+    // from, including its sub directories.
+    void skipDirectory();
+
+    class iterator
+    {
+    private:
+        DirectoryWalk* m_walk;
+
+    public:
+        explicit iterator(DirectoryWalk* walk) :
+            m_walk(walk)
+        {
+        }
+
+        const WalkEntry& operator*() const
+        {
+            return m_walk->m_current;
+        }
+
+        const WalkEntry* operator->() const
+        {
+            return &m_walk->m_current;
+        }
+
+        iterator& operator++()
+        {
+            if (!m_walk->next(m_walk->m_current))
+                m_walk = nullptr;
+            return *this;
+        }
+
+        bool operator!=(const iterator& rhs) const
+        {
+            return m_walk != rhs.m_walk;
+        }
+
+        bool operator==(const iterator& rhs) const
+        {
+            return m_walk == rhs.m_walk;
+        }
+    };
+
+    // Iterating advances the walk itself; it can only be done once.
+    iterator begin();
+
+    iterator end()
+    {
+        return iterator(nullptr);
+    }
+};
+
+// Walks a tree in manifest order. One directory per level is held,
+// its entries sorted by name. Entries follow the filters, patterns and
+// pruning of opts; sub directories are entered with opts.recursive,
+// down to --max-depth.
+class ManifestWalk : public ManifestSource
+{
+private:
+    struct Level
+    {
+        EntryTable  entries;
+        size_t      pos;
+        std::string subDir;
+        WalkScope   scope;
+    };
+
+    std::string        m_root;
+    const GlobSet*     m_patterns;
+    const Options*     m_opts;
+    std::vector<Level> m_levels;
+    ManifestWriter*    m_writer;
+
+    void push(const std::string& subDir, const WalkScope& scope);
+
+public:
+    ManifestWalk();
+
+    // Starts a walk over root. patterns and opts must outlive the walk.
+    void open(const std::string& root, const GlobSet& patterns, const Options& opts);
+
+    // Also adds every entry the walk yields to writer.
+    void record(ManifestWriter* writer)
+    {
+        m_writer = writer;
+    }
+
+    bool next(ManifestEntry& dest) override;
+};
+
+enum WalkAction
+{
+    WA_CONTINUE = 0,
+    WA_SKIP,  // skip the rest of this directory
+    WA_STOP,  // end the walk
+};
+
+class ListVisitor
+{
+public:
+    virtual ~ListVisitor()
+    {
+    }
+
+    virtual WalkAction visit(const WalkEntry& item) = 0;
+};
+
+// Walks root, handing every entry to visitor.
+// Returns false if the visitor stopped the walk.
+bool walkTree(const std::string& root,
+              const GlobSet&     patterns,
+              const Options&     opts,
+              ListVisitor&       visitor);
+
+#endif  //_Walk_h_
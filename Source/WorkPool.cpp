@@ -0,0 +1,140 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "WorkPool.h"
+
+using namespace std;
+
+// The queue index of the calling thread; outside threads
+// share the last queue in the pool.
+static thread_local const WorkPool* CurrentPool  = nullptr;
+static thread_local size_t          CurrentIndex = 0;
+
+WorkPool::WorkPool(size_t workers) :
+    m_pending(0),
+    m_completed(0),
+    m_stop(false)
+{
+    if (workers < 1)
+        workers = 1;
+
+    for (size_t i = 0; i <= workers; ++i)
+        m_queues.push_back(unique_ptr<Queue>(new Queue));
+
+    for (size_t i = 0; i < workers; ++i)
+        m_threads.push_back(thread(&WorkPool::workerMain, this, i));
+}
+
+WorkPool::~WorkPool()
+{
+    {
+        lock_guard<mutex> lk(m_sleepLock);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (thread& th : m_threads)
+        th.join();
+}
+
+size_t WorkPool::self() const
+{
+    if (CurrentPool == this)
+        return CurrentIndex;
+    return m_queues.size() - 1;
+}
+
+void WorkPool::submit(Task task)
+{
+    Queue* q = m_queues[self()].get();
+    {
+        lock_guard<mutex> lk(q->lock);
+        q->tasks.push_back(std::move(task));
+    }
+    {
+        lock_guard<mutex> lk(m_sleepLock);
+        ++m_pending;
+    }
+    m_wake.notify_all();
+}
+
+bool WorkPool::tryRun(size_t index)
+{
+    Task   task;
+    size_t s = m_queues.size(), i;
+
+    // Own work first, newest to oldest.
+    {
+        Queue*            q = m_queues[index].get();
+        lock_guard<mutex> lk(q->lock);
+        if (!q->tasks.empty())
+        {
+            task = std::move(q->tasks.back());
+            q->tasks.pop_back();
+        }
+    }
+
+    // Then steal the oldest task from someone else.
+    for (i = 1; !task && i < s; ++i)
+    {
+        Queue*            q = m_queues[(index + i) % s].get();
+        lock_guard<mutex> lk(q->lock);
+        if (!q->tasks.empty())
+        {
+            task = std::move(q->tasks.front());
+            q->tasks.pop_front();
+        }
+    }
+
+    if (!task)
+        return false;
+
+    --m_pending;
+    task();
+
+    {
+        lock_guard<mutex> lk(m_sleepLock);
+        ++m_completed;
+    }
+    m_wake.notify_all();
+    return true;
+}
+
+void WorkPool::workerMain(size_t index)
+{
+    CurrentPool  = this;
+    CurrentIndex = index;
+
+    for (;;)
+    {
+        if (tryRun(index))
+            continue;
+
+        unique_lock<mutex> lk(m_sleepLock);
+        m_wake.wait(lk, [this] { return m_stop || m_pending.load() > 0; });
+        if (m_stop)
+            break;
+    }
+}
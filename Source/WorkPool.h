@@ -0,0 +1,99 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _WorkPool_h_
+#define _WorkPool_h_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A small work-stealing thread pool.
+//
+// Each worker owns a deque. Tasks submitted from a worker go to the back
+// of its own deque and are popped LIFO, so a directory's children are
+// visited while they are still warm. Idle workers steal from the front
+// of the other deques. Threads that are not part of the pool submit into
+// a shared injection queue and may help run tasks while they wait.
+class WorkPool
+{
+public:
+    typedef std::function<void()> Task;
+
+private:
+    struct Queue
+    {
+        std::mutex       lock;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread>            m_threads;
+    std::mutex                          m_sleepLock;
+    std::condition_variable             m_wake;
+    std::atomic<size_t>                 m_pending;
+    size_t                              m_completed;
+    bool                                m_stop;
+
+    size_t self() const;
+    bool   tryRun(size_t self);
+    void   workerMain(size_t index);
+
+public:
+    explicit WorkPool(size_t workers);
+    ~WorkPool();
+
+    void submit(Task task);
+
+    // Runs queued tasks on the calling thread until pred() returns false.
+    template <typename Pred>
+    void helpWhile(Pred pred)
+    {
+        size_t index = self();
+        while (pred())
+        {
+            if (tryRun(index))
+                continue;
+
+            std::unique_lock<std::mutex> lk(m_sleepLock);
+            size_t                       gen = m_completed;
+            m_wake.wait(lk, [&] {
+                return m_pending.load() > 0 || m_completed != gen || !pred();
+            });
+        }
+    }
+
+    size_t size() const
+    {
+        return m_threads.size();
+    }
+};
+
+#endif  //_WorkPool_h_
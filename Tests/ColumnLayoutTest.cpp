@@ -0,0 +1,84 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "ColumnLayout.h"
+#include "Test.h"
+#include <vector>
+
+using namespace std;
+
+TEST(ColumnLayout, Empty)
+{
+    ColumnLayout layout;
+    layout.compute(nullptr, 0, 80, 2);
+    EXPECT_EQ(0u, layout.columns());
+}
+
+TEST(ColumnLayout, OneLine)
+{
+    vector<uint32_t> widths = {3, 5, 4};
+
+    ColumnLayout layout;
+    layout.compute(widths.data(), widths.size(), 80, 2);
+    EXPECT_EQ(1u, layout.rows());
+    EXPECT_EQ(3u, layout.columns());
+    EXPECT_EQ(5u, layout.columnWidth(1));
+}
+
+TEST(ColumnLayout, FillsColumnsFirst)
+{
+    // Five items of ten on a line of 35 fit three columns of two rows.
+    vector<uint32_t> widths(5, 10);
+
+    ColumnLayout layout;
+    layout.compute(widths.data(), widths.size(), 35, 2);
+    EXPECT_EQ(2u, layout.rows());
+    EXPECT_EQ(3u, layout.columns());
+    EXPECT_EQ(1u, layout.index(1, 0));
+    EXPECT_EQ(2u, layout.index(0, 1));
+    EXPECT_EQ(5u, layout.index(1, 2));
+}
+
+TEST(ColumnLayout, WidestPerColumn)
+{
+    vector<uint32_t> widths = {2, 9, 4, 3};
+
+    ColumnLayout layout;
+    layout.compute(widths.data(), widths.size(), 16, 1);
+    EXPECT_EQ(2u, layout.rows());
+    EXPECT_EQ(9u, layout.columnWidth(0));
+    EXPECT_EQ(4u, layout.columnWidth(1));
+}
+
+TEST(ColumnLayout, TooWide)
+{
+    // An item wider than the line still gets a row of its own.
+    vector<uint32_t> widths = {100, 3};
+
+    ColumnLayout layout;
+    layout.compute(widths.data(), widths.size(), 40, 2);
+    EXPECT_EQ(1u, layout.columns());
+    EXPECT_EQ(2u, layout.rows());
+}
@@ -0,0 +1,158 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "DirectoryReader.h"
+#include "Test.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+
+static void readAll(const string&          dir,
+                    map<string, DirEntry>& dest,
+                    EntryMetadata          level    = EM_FULL,
+                    bool                   useTypes = true)
+{
+    unique_ptr<DirectoryReader> reader(DirectoryReader::create(DirectoryReader::DefaultBufferSize, useTypes));
+    EXPECT(reader->open(dir.c_str(), level));
+
+    DirEntry ent;
+    while (reader->next(ent))
+    {
+        string name(ent.name, ent.nameLen);
+        ent.name   = nullptr;
+        dest[name] = ent;
+    }
+    reader->close();
+}
+
+TEST(DirectoryReader, Attributes)
+{
+    string root = testDirectory();
+    testFile(root, "file", 123);
+    testFile(root, ".hidden", 7);
+    testSubDirectory(root, "dir");
+    EXPECT(::symlink("nowhere", (root + "dangling").c_str()) == 0);
+    EXPECT(::symlink("file", (root + "link").c_str()) == 0);
+
+    map<string, DirEntry> ents;
+    readAll(root, ents);
+
+    EXPECT_EQ(7u, ents.size());
+    EXPECT_EQ(123u, ents["file"].size);
+    EXPECT(ents["file"].timeWrite > 0);
+    EXPECT_EQ((uint32_t)EA_HIDDEN, ents[".hidden"].attrib);
+    EXPECT_EQ(7u, ents[".hidden"].size);
+    EXPECT_EQ((uint32_t)EA_DIRECTORY, ents["dir"].attrib);
+    EXPECT_EQ(0u, ents["dir"].size);
+
+    // A link is described by its target, unless it has none.
+    EXPECT_EQ((uint32_t)EA_LINK, ents["link"].attrib);
+    EXPECT_EQ(123u, ents["link"].size);
+    EXPECT_EQ((uint32_t)EA_LINK, ents["dangling"].attrib);
+    EXPECT_EQ(7u, ents["dangling"].size);
+}
+
+TEST(DirectoryReader, TypeOnly)
+{
+    string root = testDirectory();
+    testFile(root, "file", 123);
+    testSubDirectory(root, "dir");
+    EXPECT(::symlink("dir", (root + "link").c_str()) == 0);
+    EXPECT(::symlink("nowhere", (root + "dangling").c_str()) == 0);
+
+    map<string, DirEntry> ents;
+    readAll(root, ents, EM_TYPE);
+
+    EXPECT_EQ(6u, ents.size());
+    EXPECT_EQ(0u, ents["file"].attrib);
+    EXPECT_EQ(0u, ents["file"].size);
+    EXPECT_EQ((uint32_t)EA_DIRECTORY, ents["dir"].attrib);
+    EXPECT_EQ((uint32_t)(EA_HIDDEN | EA_DIRECTORY), ents["."].attrib);
+
+    // Links are still stated for the type of their target.
+    EXPECT_EQ((uint32_t)(EA_LINK | EA_DIRECTORY), ents["link"].attrib);
+    EXPECT_EQ((uint32_t)EA_LINK, ents["dangling"].attrib);
+}
+
+TEST(DirectoryReader, UnknownTypes)
+{
+    // As on a file system that leaves d_type unknown. A link to a
+    // directory is still a link, or a walk would loop through it.
+    string root = testDirectory();
+    testFile(root, "file", 123);
+    testSubDirectory(root, "dir");
+    EXPECT(::symlink("dir", (root + "link").c_str()) == 0);
+    EXPECT(::symlink("..", (root + "dir/loop").c_str()) == 0);
+
+    for (EntryMetadata level : {EM_TYPE, EM_FULL})
+    {
+        map<string, DirEntry> ents, inner;
+        readAll(root, ents, level, false);
+        readAll(root + "dir/", inner, level, false);
+
+        EXPECT_EQ(5u, ents.size());
+        EXPECT_EQ(0u, ents["file"].attrib);
+        EXPECT_EQ(123u, ents["file"].size);
+        EXPECT_EQ((uint32_t)EA_DIRECTORY, ents["dir"].attrib);
+        EXPECT_EQ((uint32_t)(EA_HIDDEN | EA_DIRECTORY), ents["."].attrib);
+        EXPECT_EQ((uint32_t)(EA_LINK | EA_DIRECTORY), ents["link"].attrib);
+        EXPECT_EQ((uint32_t)(EA_LINK | EA_DIRECTORY), inner["loop"].attrib);
+    }
+}
+
+TEST(DirectoryReader, ManyEntries)
+{
+    // Enough entries to fill several reads of the buffer.
+    string root = testDirectory();
+    for (size_t i = 0; i < 3000; ++i)
+        testFile(root, "entry" + to_string(i), i % 100);
+
+    map<string, DirEntry> ents;
+    readAll(root, ents);
+
+    EXPECT_EQ(3002u, ents.size());
+
+    size_t wrong = 0;
+    for (size_t i = 0; i < 3000; ++i)
+    {
+        if (ents["entry" + to_string(i)].size != i % 100)
+            wrong++;
+    }
+    EXPECT_EQ(0u, wrong);
+}
+
+TEST(DirectoryReader, Missing)
+{
+    string root = testDirectory();
+
+    unique_ptr<DirectoryReader> reader(DirectoryReader::create());
+    EXPECT(!reader->open((root + "missing").c_str(), EM_FULL));
+
+    DirEntry ent;
+    EXPECT(!reader->next(ent));
+}
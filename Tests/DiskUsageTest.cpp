@@ -0,0 +1,225 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "DiskUsage.h"
+#include "Output.h"
+#include "Test.h"
+#include "Walk.h"
+#include "WorkPool.h"
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+static UsageTotals totals(uint64_t bytes, uint64_t files, uint64_t directories)
+{
+    UsageTotals ut = {bytes, files, directories};
+    return ut;
+}
+
+TEST(DiskUsage, RankingKeepsHeaviest)
+{
+    UsageRanking ranking(2);
+    ranking.add("a", totals(10, 1, 0));
+    ranking.add("b", totals(30, 1, 0));
+    ranking.add("c", totals(20, 1, 0));
+    EXPECT(!ranking.accepts(5));
+    ranking.add("d", totals(5, 1, 0));
+
+    vector<RankedUsage> top;
+    ranking.take(top);
+    EXPECT_EQ(2u, top.size());
+    if (top.size() == 2)
+    {
+        EXPECT_EQ(string("b"), top[0].path);
+        EXPECT_EQ(string("c"), top[1].path);
+    }
+}
+
+TEST(DiskUsage, RankingTies)
+{
+    // Equal sizes order by path, whatever order they arrive in.
+    UsageRanking ranking(2);
+    ranking.add("z", totals(10, 1, 0));
+    ranking.add("m", totals(10, 1, 0));
+    ranking.add("a", totals(10, 1, 0));
+
+    vector<RankedUsage> top;
+    ranking.take(top);
+    EXPECT_EQ(2u, top.size());
+    if (top.size() == 2)
+    {
+        EXPECT_EQ(string("a"), top[0].path);
+        EXPECT_EQ(string("m"), top[1].path);
+    }
+}
+
+TEST(DiskUsage, RankingNone)
+{
+    UsageRanking ranking(0);
+    EXPECT(!ranking.accepts(UINT64_MAX));
+}
+
+// root/           650 bytes, 4 files, 3 directories
+//   a             100
+//   sub1/         350
+//     b           300
+//     inner/       50
+//       c          50
+//   sub2/         200
+//     d           200
+static string makeTree()
+{
+    string root = testDirectory();
+    testFile(root, "a", 100);
+    testSubDirectory(root, "sub1");
+    testFile(root, "sub1/b", 300);
+    testSubDirectory(root, "sub1/inner");
+    testFile(root, "sub1/inner/c", 50);
+    testSubDirectory(root, "sub2");
+    testFile(root, "sub2/d", 200);
+    return root;
+}
+
+static Options usageOptions(int top)
+{
+    Options opts    = {};
+    opts.usage      = true;
+    opts.usageDepth = -1;
+    opts.usageTop   = top;
+    return opts;
+}
+
+static void checkTop(const string& root, vector<RankedUsage>& top)
+{
+    EXPECT_EQ(3u, top.size());
+    if (top.size() != 3)
+        return;
+
+    EXPECT_EQ(root, top[0].path);
+    EXPECT_EQ(650u, top[0].totals.bytes);
+    EXPECT_EQ(4u, top[0].totals.files);
+    EXPECT_EQ(3u, top[0].totals.directories);
+
+    EXPECT_EQ(root + "sub1/", top[1].path);
+    EXPECT_EQ(350u, top[1].totals.bytes);
+    EXPECT_EQ(1u, top[1].totals.directories);
+
+    EXPECT_EQ(root + "sub2/", top[2].path);
+    EXPECT_EQ(200u, top[2].totals.bytes);
+}
+
+TEST(DiskUsage, Top)
+{
+    string  root = makeTree();
+    Options opts = usageOptions(3);
+    GlobSet all;
+    all.add("*");
+    all.compile(false);
+
+    string       text;
+    UsageRanking ranking(3);
+    {
+        Output out(text);
+        usageAll(out, root, all, opts, ranking);
+    }
+    EXPECT(text.empty());
+
+    vector<RankedUsage> top;
+    ranking.take(top);
+    checkTop(root, top);
+}
+
+TEST(DiskUsage, TopParallel)
+{
+    string  root = makeTree();
+    Options opts = usageOptions(3);
+    GlobSet all;
+    all.add("*");
+    all.compile(false);
+
+    opts.jobs = 2;
+
+    string       text;
+    UsageRanking ranking(3);
+    {
+        Output   out(text);
+        WorkPool pool(2);
+        usageParallel(out, root, all, opts, ranking, pool);
+    }
+
+    vector<RankedUsage> top;
+    ranking.take(top);
+    checkTop(root, top);
+}
+
+TEST(DiskUsage, LinkedDirectory)
+{
+    // A link to sub1 is not counted as a second copy of it.
+    string  root = makeTree();
+    Options opts = usageOptions(3);
+    GlobSet all;
+    all.add("*");
+    all.compile(false);
+
+    EXPECT(::symlink("sub1", (root + "link").c_str()) == 0);
+
+    string       text;
+    UsageRanking ranking(3), pooled(3);
+    {
+        Output   out(text);
+        WorkPool pool(2);
+        usageAll(out, root, all, opts, ranking);
+        usageParallel(out, root, all, opts, pooled, pool);
+    }
+
+    vector<RankedUsage> top;
+    ranking.take(top);
+    checkTop(root, top);
+    pooled.take(top);
+    checkTop(root, top);
+}
+
+TEST(DiskUsage, Depth)
+{
+    string  root = makeTree();
+    Options opts = usageOptions(0);
+    GlobSet all;
+    all.add("*");
+    all.compile(false);
+
+    opts.usageDepth = 0;
+
+    string       text;
+    UsageRanking ranking(0);
+    {
+        Output out(text);
+        usageAll(out, root, all, opts, ranking);
+    }
+    EXPECT(text.find(root) != string::npos);
+    EXPECT(text.find("sub1") == string::npos);
+    EXPECT(text.find("650") != string::npos);
+}
@@ -0,0 +1,169 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Duplicates.h"
+#include "Test.h"
+#include "Walk.h"
+#include "WorkPool.h"
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+static void writeFile(const string& dir, const string& path, const string& contents)
+{
+    FILE* fp = fopen((dir + path).c_str(), "wb");
+    if (!fp)
+    {
+        testFailed(__FILE__, __LINE__, "create " + dir + path);
+        return;
+    }
+    fwrite(contents.data(), 1, contents.size(), fp);
+    fclose(fp);
+}
+
+// root/
+//   a.bin   10000 x
+//   b.bin   the same as a.bin
+//   c.bin   a.bin with a different byte in the middle
+//   d.bin   100 y
+//   f.bin   100 z
+//   g.bin   7 bytes
+//   h.bin   empty
+//   i.bin   empty
+//   sub/
+//     e.bin the same as d.bin
+static string makeTree()
+{
+    string root = testDirectory();
+    string big(10000, 'x'), changed(big);
+    changed[5000] = '-';
+
+    writeFile(root, "a.bin", big);
+    writeFile(root, "b.bin", big);
+    writeFile(root, "c.bin", changed);
+    writeFile(root, "d.bin", string(100, 'y'));
+    writeFile(root, "f.bin", string(100, 'z'));
+    writeFile(root, "g.bin", "1234567");
+    testFile(root, "h.bin");
+    testFile(root, "i.bin");
+    testSubDirectory(root, "sub");
+    writeFile(root, "sub/e.bin", string(100, 'y'));
+    return root;
+}
+
+static void findAll(const string& root, vector<DuplicateSet>& sets, DuplicateFinder& finder, WorkPool* pool)
+{
+    Options opts    = {};
+    opts.recursive  = true;
+    opts.fileOnly   = true;
+    opts.dupes      = true;
+    opts.hasSortKey = true;
+    opts.sortKey    = SK_NONE;
+
+    GlobSet all;
+    all.add("*");
+    all.compile(false);
+
+    finder.walk(root, all, opts);
+    finder.find(sets, pool);
+}
+
+TEST(Duplicates, Hash)
+{
+    // The reference values of XXH64 with a seed of zero.
+    EXPECT(hashBytes("", 0) == 0xEF46DB3751D8E999ULL);
+    EXPECT(hashBytes("a", 1) == 0xD24EC4F1A98C6E5BULL);
+    EXPECT(hashBytes("abc", 3) == 0x44BC2CF5AD770999ULL);
+
+    string text(100, 'q');
+    EXPECT(hashBytes(text.data(), text.size()) != hashBytes(text.data(), text.size(), 1));
+    EXPECT(hashBytes(text.data(), text.size()) != hashBytes(text.data(), text.size() - 1));
+}
+
+TEST(Duplicates, Sets)
+{
+    string               root = makeTree();
+    vector<DuplicateSet> sets;
+    DuplicateFinder      finder;
+    findAll(root, sets, finder, nullptr);
+
+    // The larger set wastes more space, so it comes first.
+    EXPECT_EQ(2u, sets.size());
+    if (sets.size() == 2)
+    {
+        EXPECT_EQ(10000u, sets[0].size);
+        EXPECT_EQ(2u, sets[0].paths.size());
+        EXPECT_EQ(root + "a.bin", sets[0].paths[0]);
+        EXPECT_EQ(root + "b.bin", sets[0].paths[1]);
+
+        EXPECT_EQ(100u, sets[1].size);
+        EXPECT_EQ(2u, sets[1].paths.size());
+        EXPECT_EQ(root + "d.bin", sets[1].paths[0]);
+        EXPECT_EQ(root + "sub/e.bin", sets[1].paths[1]);
+    }
+}
+
+TEST(Duplicates, Links)
+{
+    // A hard link to g.bin is g.bin under another name, and the
+    // files below a link to sub are the files of sub.
+    string root = makeTree();
+    EXPECT(::link((root + "g.bin").c_str(), (root + "g2.bin").c_str()) == 0);
+    EXPECT(::link((root + "a.bin").c_str(), (root + "a2.bin").c_str()) == 0);
+    EXPECT(::symlink("sub", (root + "linked").c_str()) == 0);
+
+    vector<DuplicateSet> sets;
+    DuplicateFinder      finder;
+    findAll(root, sets, finder, nullptr);
+
+    EXPECT_EQ(2u, sets.size());
+    if (sets.size() == 2)
+    {
+        EXPECT_EQ(10000u, sets[0].size);
+        EXPECT_EQ(2u, sets[0].paths.size());
+        EXPECT_EQ(2u, sets[1].paths.size());
+        EXPECT_EQ(root + "d.bin", sets[1].paths[0]);
+        EXPECT_EQ(root + "sub/e.bin", sets[1].paths[1]);
+    }
+}
+
+TEST(Duplicates, ReadsOnlyCollisions)
+{
+    // g.bin has a size of its own and is never opened; only the
+    // files of 10000 bytes still collide after the sample.
+    string               root = makeTree();
+    vector<DuplicateSet> sets;
+    DuplicateFinder      finder;
+    WorkPool             pool(2);
+    findAll(root, sets, finder, &pool);
+
+    EXPECT_EQ(7u, finder.files());
+    EXPECT_EQ(6u, finder.filesSampled());
+    EXPECT_EQ(3u, finder.filesHashed());
+    EXPECT_EQ(2u, sets.size());
+}
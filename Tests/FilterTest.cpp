@@ -0,0 +1,168 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Filter.h"
+#include "Test.h"
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+static DirEntry entry(const char* name, uint64_t size, uint32_t attrib = 0, int64_t timeWrite = 0)
+{
+    DirEntry ent  = {};
+    ent.name      = name;
+    ent.nameLen   = strlen(name);
+    ent.size      = size;
+    ent.attrib    = attrib;
+    ent.timeWrite = timeWrite;
+    return ent;
+}
+
+TEST(Filter, Empty)
+{
+    FilterProgram filter;
+    EXPECT(filter.compile(false));
+    EXPECT(filter.empty());
+    EXPECT(!filter.needsMetadata());
+    EXPECT(filter.match(entry("a", 0)));
+}
+
+TEST(Filter, Size)
+{
+    FilterProgram filter;
+    EXPECT(filter.add("min-size", "1K"));
+    EXPECT(filter.add("max-size", "2048"));
+    EXPECT(filter.compile(false));
+    EXPECT(filter.needsMetadata());
+
+    EXPECT(!filter.match(entry("a", 1023)));
+    EXPECT(filter.match(entry("a", 1024)));
+    EXPECT(filter.match(entry("a", 2048)));
+    EXPECT(!filter.match(entry("a", 2049)));
+}
+
+TEST(Filter, BadValues)
+{
+    FilterProgram filter;
+    EXPECT(!filter.add("min-size", ""));
+    EXPECT(!filter.add("min-size", "1X"));
+    EXPECT(!filter.add("min-size", "1KB"));
+    EXPECT(!filter.add("newer", "yesterday"));
+    EXPECT(!filter.add("newer", "2026-10-16T20"));
+    EXPECT(!filter.add("newer", "1dd"));
+
+    // Too large to hold, rather than wrapped around.
+    EXPECT(!filter.add("min-size", "18446744073709551617"));
+    EXPECT(!filter.add("min-size", "9223372036854775808"));
+    EXPECT(!filter.add("max-size", "8388608T"));
+    EXPECT(!filter.add("newer", "9223372036854775807s"));
+    EXPECT(!filter.add("older", "15251w"));
+    EXPECT(!filter.add("type", "x"));
+    EXPECT(!filter.add("colour", "red"));
+    EXPECT(filter.empty());
+}
+
+TEST(Filter, Type)
+{
+    FilterProgram filter;
+    EXPECT(filter.add("type", "dl"));
+    EXPECT(filter.compile(false));
+    EXPECT(!filter.needsMetadata());
+
+    EXPECT(!filter.match(entry("file", 0)));
+    EXPECT(filter.match(entry("dir", 0, EA_DIRECTORY)));
+    EXPECT(filter.match(entry("link", 0, EA_LINK)));
+    EXPECT(filter.match(entry("link", 0, EA_LINK | EA_DIRECTORY)));
+}
+
+TEST(Filter, Time)
+{
+    const int64_t Day = 86400LL * 1000000000;
+
+    int64_t now = (int64_t)chrono::duration_cast<chrono::nanoseconds>(
+                      chrono::system_clock::now().time_since_epoch())
+                      .count();
+
+    FilterProgram filter;
+    EXPECT(filter.add("newer", "2d"));
+    EXPECT(filter.add("older", "1d"));
+    EXPECT(filter.compile(false));
+
+    EXPECT(!filter.match(entry("a", 0, 0, now)));
+    EXPECT(filter.match(entry("a", 0, 0, now - Day - Day / 2)));
+    EXPECT(!filter.match(entry("a", 0, 0, now - 3 * Day)));
+}
+
+TEST(Filter, Date)
+{
+    tm local       = {};
+    local.tm_year  = 126;
+    local.tm_mon   = 9;
+    local.tm_mday  = 16;
+    local.tm_hour  = 20;
+    local.tm_min   = 12;
+    local.tm_isdst = -1;
+
+    int64_t at = (int64_t)mktime(&local) * 1000000000;
+
+    FilterProgram filter;
+    EXPECT(filter.add("newer", "2026-10-16T20:12"));
+    EXPECT(filter.compile(false));
+
+    EXPECT(!filter.match(entry("a", 0, 0, at)));
+    EXPECT(filter.match(entry("a", 0, 0, at + 1)));
+
+    FilterProgram seconds;
+    EXPECT(seconds.add("older", "2026-10-16 20:12:01"));
+    EXPECT(seconds.compile(false));
+    EXPECT(seconds.match(entry("a", 0, 0, at)));
+    EXPECT(!seconds.match(entry("a", 0, 0, at + 1000000000)));
+}
+
+TEST(Filter, Name)
+{
+    FilterProgram filter;
+    EXPECT(filter.add("name-regex", "\\.(cpp|h)$"));
+    EXPECT(filter.compile(false));
+    EXPECT(!filter.needsMetadata());
+
+    EXPECT(filter.match(entry("Main.cpp", 0)));
+    EXPECT(filter.match(entry("Glob.h", 0)));
+    EXPECT(!filter.match(entry("Glob.H", 0)));
+    EXPECT(!filter.match(entry("notes.cppx", 0)));
+
+    FilterProgram folded;
+    EXPECT(folded.add("name-regex", "^read"));
+    EXPECT(folded.compile(true));
+    EXPECT(folded.match(entry("README.md", 0)));
+}
+
+TEST(Filter, BadExpression)
+{
+    FilterProgram filter;
+    EXPECT(filter.add("name-regex", "(unclosed"));
+    EXPECT(!filter.compile(false));
+}
@@ -0,0 +1,102 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Format.h"
+#include "Test.h"
+#include <string>
+
+using namespace std;
+
+static string grouped(uint64_t val)
+{
+    char buf[FormatBufferSize];
+    return string(buf, formatGrouped(buf, val));
+}
+
+static string human(uint64_t val)
+{
+    char buf[FormatBufferSize];
+    return string(buf, formatHuman(buf, val));
+}
+
+TEST(Format, Grouped)
+{
+    EXPECT_EQ(string("0"), grouped(0));
+    EXPECT_EQ(string("999"), grouped(999));
+    EXPECT_EQ(string("1,000"), grouped(1000));
+    EXPECT_EQ(string("12,345"), grouped(12345));
+    EXPECT_EQ(string("1,234,567"), grouped(1234567));
+    EXPECT_EQ(string("18,446,744,073,709,551,615"), grouped(UINT64_MAX));
+}
+
+TEST(Format, Human)
+{
+    EXPECT_EQ(string("0"), human(0));
+    EXPECT_EQ(string("1023"), human(1023));
+    EXPECT_EQ(string("1.0K"), human(1024));
+    EXPECT_EQ(string("1.5K"), human(1536));
+    EXPECT_EQ(string("10K"), human(10 * 1024));
+    EXPECT_EQ(string("1.0M"), human(1024 * 1024));
+}
+
+TEST(Format, HumanRoundsUp)
+{
+    // Never shown smaller than it is.
+    EXPECT_EQ(string("1.1K"), human(1025));
+    EXPECT_EQ(string("11K"), human(10 * 1024 + 1));
+    EXPECT_EQ(string("1.0M"), human(1024 * 1024 - 1));
+}
+
+TEST(Format, ParseTimeStyle)
+{
+    TimeStyle style = TS_DEFAULT;
+    EXPECT(parseTimeStyle("iso", style));
+    EXPECT_EQ(TS_ISO, style);
+    EXPECT(parseTimeStyle("default", style));
+    EXPECT_EQ(TS_DEFAULT, style);
+    EXPECT(!parseTimeStyle("long", style));
+}
+
+TEST(Format, IsoTime)
+{
+    char          buf[FormatBufferSize];
+    TimeFormatter fmt;
+
+    // Local noon keeps the date the same in every time zone.
+    tm local     = {};
+    local.tm_year = 126;
+    local.tm_mon  = 9;
+    local.tm_mday = 16;
+    local.tm_hour = 12;
+    local.tm_min  = 34;
+    local.tm_sec  = 56;
+    local.tm_isdst = -1;
+
+    int64_t ns = (int64_t)mktime(&local) * 1000000000;
+    EXPECT_EQ(string("2026-10-16T12:34:56"), string(buf, fmt.format(buf, ns, TS_ISO)));
+
+    // The second call is answered from the cached day.
+    EXPECT_EQ(string("2026-10-16T12:35:56"), string(buf, fmt.format(buf, ns + 60000000000, TS_ISO)));
+}
@@ -0,0 +1,97 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Glob.h"
+#include "Test.h"
+
+TEST(Glob, Star)
+{
+    GlobSet globs;
+    globs.add("*.cpp");
+    globs.compile(false);
+
+    EXPECT(globs.match("Main.cpp"));
+    EXPECT(globs.match(".cpp"));
+    EXPECT(!globs.match("Main.h"));
+    EXPECT(!globs.match("Main.cppx"));
+    EXPECT(!globs.matchAll());
+}
+
+TEST(Glob, MatchAll)
+{
+    GlobSet globs;
+    globs.add("*");
+    globs.compile(false);
+
+    EXPECT(globs.matchAll());
+    EXPECT(globs.match("anything"));
+}
+
+TEST(Glob, AnyCharacter)
+{
+    GlobSet globs;
+    globs.add("a?c");
+    globs.compile(false);
+
+    EXPECT(globs.match("abc"));
+    EXPECT(!globs.match("ac"));
+    EXPECT(!globs.match("abbc"));
+}
+
+TEST(Glob, Classes)
+{
+    GlobSet globs;
+    globs.add("[a-c]x[!0-9]");
+    globs.compile(false);
+
+    EXPECT(globs.match("bxy"));
+    EXPECT(!globs.match("dxy"));
+    EXPECT(!globs.match("bx1"));
+}
+
+TEST(Glob, Several)
+{
+    GlobSet globs;
+    globs.add("*.h");
+    globs.add("Makefile");
+    globs.compile(false);
+
+    EXPECT(globs.match("Glob.h"));
+    EXPECT(globs.match("Makefile"));
+    EXPECT(!globs.match("makefile"));
+    EXPECT(!globs.match("Glob.cpp"));
+}
+
+TEST(Glob, IgnoreCase)
+{
+    GlobSet globs;
+    globs.add("*.TXT");
+    globs.add("readme");
+    globs.compile(true);
+
+    EXPECT(globs.match("notes.txt"));
+    EXPECT(globs.match("README"));
+    EXPECT(!globs.match("notes.text"));
+}
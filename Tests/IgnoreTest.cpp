@@ -0,0 +1,116 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Ignore.h"
+#include "Test.h"
+#include <cstring>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+static bool match(const char* pattern, const char* text, bool ignoreCase = false)
+{
+    return matchPath(pattern, strlen(pattern), text, strlen(text), ignoreCase);
+}
+
+static IgnoreChain rules(const IgnoreChain& parent, const string& base, const char* text)
+{
+    shared_ptr<IgnoreRules> dest = make_shared<IgnoreRules>(parent, base, false);
+    dest->parse(text, strlen(text));
+    return dest;
+}
+
+static bool ignores(const IgnoreChain& chain, const string& subDir, const char* name, bool isDir = false)
+{
+    return chain->ignores(subDir, name, strlen(name), isDir);
+}
+
+TEST(Ignore, Match)
+{
+    EXPECT(match("*.o", "main.o"));
+    EXPECT(!match("*.o", "src/main.o"));
+    EXPECT(match("src/*.o", "src/main.o"));
+    EXPECT(!match("src/*.o", "src/sub/main.o"));
+    EXPECT(match("a?c", "abc"));
+    EXPECT(!match("a?c", "a/c"));
+    EXPECT(match("[a-c]x", "bx"));
+    EXPECT(!match("[!a-c]x", "bx"));
+    EXPECT(match("[x", "[x"));
+    EXPECT(match("\\*", "*"));
+    EXPECT(!match("\\*", "a"));
+    EXPECT(match("README", "readme", true));
+}
+
+TEST(Ignore, DoubleStar)
+{
+    EXPECT(match("**/foo", "foo"));
+    EXPECT(match("**/foo", "a/b/foo"));
+    EXPECT(match("a/**/b", "a/b"));
+    EXPECT(match("a/**/b", "a/x/y/b"));
+    EXPECT(!match("a/**/b", "a/x/y/c"));
+    EXPECT(match("abc/**", "abc/x/y"));
+    EXPECT(!match("abc/**", "abd/x"));
+}
+
+TEST(Ignore, Parse)
+{
+    IgnoreChain chain = rules(nullptr,
+                              "",
+                              "# comment\n"
+                              "\n"
+                              "*.log\r\n"
+                              "!keep.log\n"
+                              "\\#hash\n"
+                              "trailing   \n"
+                              "out/\n"
+                              "/top\n");
+
+    EXPECT(ignores(chain, "", "a.log"));
+    EXPECT(ignores(chain, "x/y/", "a.log"));
+    EXPECT(!ignores(chain, "", "keep.log"));
+    EXPECT(ignores(chain, "", "#hash"));
+    EXPECT(!ignores(chain, "", "# comment"));
+    EXPECT(ignores(chain, "", "trailing"));
+    EXPECT(ignores(chain, "a/", "out", true));
+    EXPECT(!ignores(chain, "a/", "out", false));
+    EXPECT(ignores(chain, "", "top"));
+    EXPECT(!ignores(chain, "a/", "top"));
+}
+
+TEST(Ignore, Chain)
+{
+    // The rules of a directory come before those above it.
+    IgnoreChain top   = rules(nullptr, "", "*.log\nbuild/\n");
+    IgnoreChain inner = rules(top, "src/", "!debug.log\nlocal/*.c\n");
+
+    EXPECT(ignores(inner, "src/", "a.log"));
+    EXPECT(!ignores(inner, "src/", "debug.log"));
+    EXPECT(ignores(top, "", "debug.log"));
+    EXPECT(ignores(inner, "src/", "build", true));
+    EXPECT(ignores(inner, "src/local/", "x.c"));
+    EXPECT(!ignores(inner, "src/other/", "x.c"));
+    EXPECT(!ignores(inner, "src/", "main.c"));
+}
@@ -0,0 +1,137 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Test.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <ftw.h>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+static TestCase*      tests    = nullptr;
+static TestCase*      last     = nullptr;
+static size_t         failures = 0;
+static vector<string> directories;
+
+static int removeEntry(const char* path, const struct stat*, int, struct FTW*)
+{
+    return ::remove(path);
+}
+
+static void removeDirectories()
+{
+    for (const string& dir : directories)
+        ::nftw(dir.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+    directories.clear();
+}
+
+bool registerTest(TestCase& test)
+{
+    // Keep the order the tests appear in.
+    if (last)
+        last->next = &test;
+    else
+        tests = &test;
+    last = &test;
+    return true;
+}
+
+void testFailed(const char* file, int line, const string& what)
+{
+    cout << "    " << file << ':' << line << ": " << what << '\n';
+    failures++;
+}
+
+string testDirectory()
+{
+    const char* tmp = getenv("TMPDIR");
+
+    string path = tmp && *tmp ? tmp : "/tmp";
+    path.append("/ListDirTests.XXXXXX");
+
+    if (!::mkdtemp(&path[0]))
+    {
+        testFailed(__FILE__, __LINE__, "mkdtemp " + path);
+        return path;
+    }
+    directories.push_back(path);
+    return path + '/';
+}
+
+void testFile(const string& dir, const string& path, size_t size)
+{
+    string full = dir + path;
+
+    int fd = ::open(full.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || (size > 0 && ::ftruncate(fd, (off_t)size) != 0))
+        testFailed(__FILE__, __LINE__, "create " + full);
+    if (fd >= 0)
+        ::close(fd);
+}
+
+void testSubDirectory(const string& dir, const string& path)
+{
+    string full = dir + path;
+    if (::mkdir(full.c_str(), 0755) != 0)
+        testFailed(__FILE__, __LINE__, "mkdir " + full);
+}
+
+// ListDirTests [suite]
+int main(int argc, char** argv)
+{
+    const char* suite = argc > 1 ? argv[1] : nullptr;
+
+    size_t run = 0, failed = 0;
+    for (TestCase* test = tests; test; test = test->next)
+    {
+        if (suite && strcmp(suite, test->suite) != 0)
+            continue;
+
+        cout << test->suite << '.' << test->name << '\n';
+
+        size_t before = failures;
+        test->function();
+        removeDirectories();
+
+        run++;
+        if (failures != before)
+            failed++;
+    }
+
+    if (run == 0)
+    {
+        cout << "no tests match " << (suite ? suite : "") << '\n';
+        return 1;
+    }
+
+    cout << run - failed << " of " << run << " passed\n";
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,253 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Manifest.h"
+#include "Test.h"
+#include "Walk.h"
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+// A source over entries held in memory.
+class VectorSource : public ManifestSource
+{
+public:
+    vector<ManifestEntry> entries;
+    size_t                pos = 0;
+
+    void add(const string& path, uint64_t size, int64_t time, uint32_t attrib = 0)
+    {
+        ManifestEntry ent = {path, size, time, attrib};
+        entries.push_back(ent);
+    }
+
+    bool next(ManifestEntry& dest) override
+    {
+        if (pos >= entries.size())
+            return false;
+        dest = entries[pos++];
+        return true;
+    }
+};
+
+static Options manifestOptions()
+{
+    Options opts    = {};
+    opts.recursive  = true;
+    opts.usageDepth = -1;
+    return opts;
+}
+
+static GlobSet allPatterns()
+{
+    GlobSet globs;
+    globs.add("*");
+    globs.compile(false);
+    return globs;
+}
+
+TEST(Manifest, PathOrder)
+{
+    // A directory comes before everything below it,
+    // and everything below it before its next sibling.
+    EXPECT(comparePaths("a", "a/x") < 0);
+    EXPECT(comparePaths("a/x", "a-b") < 0);
+    EXPECT(comparePaths("a/x", "a.txt") < 0);
+    EXPECT(comparePaths("a-b", "a/x") > 0);
+    EXPECT(comparePaths("a/z", "ab") < 0);
+    EXPECT(comparePaths("b", "a/x") > 0);
+    EXPECT_EQ(0, comparePaths("a/x", "a/x"));
+}
+
+TEST(Manifest, RoundTrip)
+{
+    string dir  = testDirectory();
+    string path = dir + "tree.manifest";
+
+    VectorSource source;
+    source.add("a", 0, 100, EA_DIRECTORY);
+    source.add("a/deep", 0, -5, EA_DIRECTORY);
+    source.add("a/deep/file.txt", 1ULL << 40, 1700000000123456789LL);
+    source.add("a/file.txt", 12, -1700000000123456789LL, EA_HIDDEN);
+    source.add("b", 7, 0);
+
+    ManifestWriter writer;
+    EXPECT(writer.open(path.c_str()));
+    for (const ManifestEntry& ent : source.entries)
+        writer.add(ent);
+    EXPECT(writer.close());
+
+    ManifestReader reader;
+    EXPECT(reader.open(path.c_str()));
+    EXPECT_EQ(5u, reader.entries());
+
+    ManifestEntry ent;
+    for (const ManifestEntry& expected : source.entries)
+    {
+        EXPECT(reader.next(ent));
+        EXPECT_EQ(expected.path, ent.path);
+        EXPECT_EQ(expected.size, ent.size);
+        EXPECT_EQ(expected.timeWrite, ent.timeWrite);
+        EXPECT_EQ(expected.attrib, ent.attrib);
+    }
+    EXPECT(!reader.next(ent));
+    EXPECT(!reader.damaged());
+}
+
+TEST(Manifest, NotAManifest)
+{
+    string dir = testDirectory();
+    testFile(dir, "empty");
+    testFile(dir, "zeros", 64);
+
+    ManifestReader reader;
+    EXPECT(!reader.open((dir + "empty").c_str()));
+    EXPECT(!reader.open((dir + "zeros").c_str()));
+    EXPECT(!reader.open((dir + "missing").c_str()));
+}
+
+TEST(Manifest, WalkOrder)
+{
+    string root = testDirectory();
+    testSubDirectory(root, "a");
+    testFile(root, "a/x", 2);
+    testFile(root, "a.txt", 3);
+    testSubDirectory(root, "a-b");
+    testFile(root, "a-b/q", 1);
+    testFile(root, "b");
+
+    Options opts = manifestOptions();
+    GlobSet all  = allPatterns();
+
+    ManifestWalk walk;
+    walk.open(root, all, opts);
+
+    string        paths, last;
+    ManifestEntry ent;
+    bool          ordered = true;
+    while (walk.next(ent))
+    {
+        if (!last.empty() && comparePaths(last, ent.path) >= 0)
+            ordered = false;
+        last = ent.path;
+        paths.append(ent.path).push_back(',');
+    }
+    EXPECT(ordered);
+    EXPECT_EQ(string("a,a/x,a-b,a-b/q,a.txt,b,"), paths);
+}
+
+TEST(Manifest, WalkLink)
+{
+    // A link to a directory is one entry; its target is not walked.
+    string root = testDirectory();
+    testSubDirectory(root, "a");
+    testSubDirectory(root, "a/b");
+    testFile(root, "a/b/c");
+    EXPECT(::symlink("..", (root + "a/b/loop").c_str()) == 0);
+
+    Options opts = manifestOptions();
+    GlobSet all  = allPatterns();
+
+    ManifestWalk walk;
+    walk.open(root, all, opts);
+
+    string        paths;
+    ManifestEntry ent;
+    while (walk.next(ent))
+        paths.append(ent.path).push_back(',');
+    EXPECT_EQ(string("a,a/b,a/b/c,a/b/loop,"), paths);
+}
+
+TEST(Manifest, Diff)
+{
+    VectorSource before, after;
+    before.add("a", 0, 1, EA_DIRECTORY);
+    before.add("a/gone", 4, 1);
+    before.add("a/same", 5, 1);
+    before.add("a/size", 6, 1);
+    before.add("b", 1, 1);
+
+    // The time of a directory changes with its entries.
+    after.add("a", 0, 2, EA_DIRECTORY);
+    after.add("a/new", 1, 2);
+    after.add("a/same", 5, 1);
+    after.add("a/size", 7, 1);
+    after.add("b", 1, 1, EA_DIRECTORY);
+    after.add("b/c", 1, 1);
+
+    string     seen;
+    DiffCounts counts = diffManifests(before, after, [&](DiffKind kind, const ManifestEntry& ent) {
+        seen.push_back("+-~"[kind]);
+        seen.append(ent.path).push_back(',');
+    });
+
+    EXPECT_EQ(string("-a/gone,+a/new,~a/size,~b,+b/c,"), seen);
+    EXPECT_EQ(2u, counts.added);
+    EXPECT_EQ(1u, counts.removed);
+    EXPECT_EQ(2u, counts.modified);
+}
+
+TEST(Manifest, DiffTree)
+{
+    string root = testDirectory();
+    testSubDirectory(root, "sub");
+    testFile(root, "sub/a", 1);
+    testFile(root, "b", 2);
+
+    Options opts = manifestOptions();
+    GlobSet all  = allPatterns();
+
+    string manifest = testDirectory() + "tree.manifest";
+    {
+        ManifestWriter writer;
+        ManifestWalk   walk;
+        EXPECT(writer.open(manifest.c_str()));
+        walk.open(root, all, opts);
+        walk.record(&writer);
+
+        ManifestEntry ent;
+        while (walk.next(ent))
+            ;
+        EXPECT(writer.close());
+    }
+
+    testFile(root, "sub/a", 10);
+    testFile(root, "c");
+
+    ManifestReader before;
+    ManifestWalk   now;
+    EXPECT(before.open(manifest.c_str()));
+    now.open(root, all, opts);
+
+    string seen;
+    diffManifests(before, now, [&](DiffKind kind, const ManifestEntry& ent) {
+        seen.push_back("+-~"[kind]);
+        seen.append(ent.path).push_back(',');
+    });
+    EXPECT_EQ(string("+c,~sub/a,"), seen);
+}
@@ -0,0 +1,131 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "EntryTable.h"
+#include "Sort.h"
+#include "Test.h"
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+static void addEntry(EntryTable& table, const char* name, uint64_t size, uint32_t attrib = 0)
+{
+    DirEntry ent  = {};
+    ent.name      = name;
+    ent.nameLen   = strlen(name);
+    ent.size      = size;
+    ent.attrib    = attrib;
+    ent.timeWrite = (int64_t)size * 1000;
+    table.add(ent);
+}
+
+static string order(const EntryTable& table)
+{
+    string names;
+    for (size_t i = 0; i < table.size(); ++i)
+    {
+        if (!names.empty())
+            names.push_back(' ');
+        uint32_t idx = table.at(i);
+        names.append(table.name(idx), table.nameLength(idx));
+    }
+    return names;
+}
+
+static void sortBy(EntryTable& table, SortKey key, bool reverse = false)
+{
+    SortOptions opts = {key, reverse, false, 1};
+    sortEntries(table, opts);
+}
+
+TEST(Sort, Name)
+{
+    EntryTable table;
+    addEntry(table, "pear", 1);
+    addEntry(table, "apple", 2);
+    addEntry(table, "applesauce", 3);
+    addEntry(table, "Banana", 4);
+
+    sortBy(table, SK_NAME);
+    EXPECT_EQ(string("Banana apple applesauce pear"), order(table));
+
+    sortBy(table, SK_NAME, true);
+    EXPECT_EQ(string("pear applesauce apple Banana"), order(table));
+}
+
+TEST(Sort, DirectoriesFirst)
+{
+    EntryTable table;
+    addEntry(table, "b", 1);
+    addEntry(table, "d", 0, EA_DIRECTORY);
+    addEntry(table, "a", 2);
+    addEntry(table, "c", 0, EA_DIRECTORY);
+
+    sortBy(table, SK_DIRECTORY);
+    EXPECT_EQ(string("d c b a"), order(table));
+
+    sortBy(table, SK_NAME, true);
+    EXPECT_EQ(string("d c b a"), order(table));
+}
+
+TEST(Sort, SizeIsStable)
+{
+    EntryTable table;
+    addEntry(table, "a", 30);
+    addEntry(table, "b", 10);
+    addEntry(table, "c", 20);
+    addEntry(table, "d", 10);
+
+    sortBy(table, SK_SIZE);
+    EXPECT_EQ(string("b d c a"), order(table));
+
+    sortBy(table, SK_TIME, true);
+    EXPECT_EQ(string("a c b d"), order(table));
+}
+
+TEST(Sort, Parse)
+{
+    SortKey key = SK_NONE;
+    EXPECT(parseSortKey("ext", key));
+    EXPECT_EQ(SK_EXT, key);
+    EXPECT(!parseSortKey("length", key));
+}
+
+TEST(Sort, Radix)
+{
+    uint64_t keys[6] = {5, 1ull << 40, 3, 5, 0, 3};
+    uint32_t vals[6] = {0, 1, 2, 3, 4, 5};
+    uint64_t tmpKeys[6];
+    uint32_t tmpVals[6];
+
+    radixSort(keys, vals, 6, tmpKeys, tmpVals);
+    EXPECT_EQ(4u, vals[0]);
+    EXPECT_EQ(2u, vals[1]);
+    EXPECT_EQ(5u, vals[2]);
+    EXPECT_EQ(0u, vals[3]);
+    EXPECT_EQ(3u, vals[4]);
+    EXPECT_EQ(1u, vals[5]);
+}
@@ -0,0 +1,96 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _Test_h_
+#define _Test_h_
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+// A small test harness, so the tests build with nothing but the
+// compiler. Each TEST registers a function under a suite and a name;
+// the runner in Main.cpp calls them and counts failed expectations.
+//
+//  TEST(Glob, Star)
+//  {
+//      EXPECT(...);
+//      EXPECT_EQ(expected, actual);
+//  }
+
+typedef void (*TestFunction)();
+
+struct TestCase
+{
+    const char*  suite;
+    const char*  name;
+    TestFunction function;
+    TestCase*    next;
+};
+
+// Adds a test to the list the runner walks. Returns true.
+bool registerTest(TestCase& test);
+
+// Reports a failed expectation of the running test.
+void testFailed(const char* file, int line, const std::string& what);
+
+// Creates an empty directory for a test to fill. The directory and
+// everything in it is removed when the test finishes. The returned
+// path ends with a separator.
+std::string testDirectory();
+
+// Creates the file path below dir, holding size bytes.
+void testFile(const std::string& dir, const std::string& path, size_t size = 0);
+
+// Creates the directory path below dir.
+void testSubDirectory(const std::string& dir, const std::string& path);
+
+#define TEST(suite, name)                                               \
+    static void       suite##_##name();                                 \
+    static TestCase   suite##_##name##_case = {#suite, #name, suite##_##name, nullptr}; \
+    static const bool suite##_##name##_registered = registerTest(suite##_##name##_case); \
+    static void       suite##_##name()
+
+#define EXPECT(cond)                                   \
+    do                                                 \
+    {                                                  \
+        if (!(cond))                                   \
+            testFailed(__FILE__, __LINE__, #cond);     \
+    } while (0)
+
+#define EXPECT_EQ(expected, actual)                                  \
+    do                                                               \
+    {                                                                \
+        const auto& e_ = (expected);                                 \
+        const auto& a_ = (actual);                                   \
+        if (!(e_ == a_))                                             \
+        {                                                            \
+            std::ostringstream ss_;                                  \
+            ss_ << #actual << " is " << a_ << ", expected " << e_;   \
+            testFailed(__FILE__, __LINE__, ss_.str());               \
+        }                                                            \
+    } while (0)
+
+#endif  //_Test_h_
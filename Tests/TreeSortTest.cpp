@@ -0,0 +1,203 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Test.h"
+#include "TreeSort.h"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static ManifestEntry entry(const string& path, uint64_t size, int64_t time = 0)
+{
+    ManifestEntry ent = {path, size, time, 0};
+    return ent;
+}
+
+// A scrambled tree of count files with sizes that repeat.
+static vector<ManifestEntry> scrambled(size_t count)
+{
+    vector<ManifestEntry> entries;
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t n = i * 7919 % count;
+        entries.push_back(entry("dir" + to_string(n % 13) + "/file" + to_string(n), n % 97, (int64_t)n - 500));
+    }
+    return entries;
+}
+
+static string paths(const vector<ManifestEntry>& entries)
+{
+    string str;
+    for (const ManifestEntry& ent : entries)
+        str.append(ent.path).push_back(',');
+    return str;
+}
+
+TEST(TreeSort, Order)
+{
+    TreeOrder bySize(SK_SIZE);
+    EXPECT(bySize.less(entry("b", 1), entry("a", 2)));
+    EXPECT(bySize.less(entry("a", 2), entry("b", 2)));
+    EXPECT(!bySize.less(entry("b", 2), entry("a", 2)));
+
+    TreeOrder largest(SK_SIZE, true);
+    EXPECT(largest.less(entry("a", 2), entry("b", 1)));
+
+    TreeOrder byTime(SK_TIME);
+    EXPECT(byTime.less(entry("a", 0, -10), entry("b", 0, 10)));
+
+    TreeOrder byPath;
+    EXPECT(byPath.less(entry("a/x", 0), entry("a.txt", 0)));
+
+    TreeOrder byExt(SK_EXT);
+    EXPECT(byExt.less(entry("z.cpp", 0), entry("a.h", 0)));
+    EXPECT(byExt.less(entry("x.d/a", 0), entry("b.c", 0)));
+
+    TreeOrder byName(SK_NAME, false, true);
+    EXPECT(byName.less(entry("a", 0), entry("B", 0)));
+    EXPECT(!byName.less(entry("B", 0), entry("a", 0)));
+    EXPECT(byName.less(entry("B", 0), entry("b", 0)));
+    EXPECT(byPath.less(entry("B", 0), entry("a", 0)));
+
+    TreeOrder byExtFolded(SK_EXT, false, true);
+    EXPECT(byExtFolded.less(entry("z.a", 0), entry("a.B", 0)));
+}
+
+TEST(TreeSort, Ranking)
+{
+    EntryRanking ranking(3, TreeOrder(SK_SIZE, true));
+
+    vector<ManifestEntry> entries = scrambled(1000);
+    size_t                offered = 0;
+    for (const ManifestEntry& ent : entries)
+    {
+        if (!ranking.accepts(ent.size, ent.timeWrite))
+            continue;
+        ranking.add(ent);
+        offered++;
+    }
+
+    // Most entries are turned away on size alone.
+    EXPECT(offered < 100);
+
+    vector<ManifestEntry> top;
+    ranking.take(top);
+    EXPECT_EQ(3u, top.size());
+
+    // Ties of size are broken by path, last first.
+    sort(entries.begin(), entries.end(), [](const ManifestEntry& a, const ManifestEntry& b) {
+        return TreeOrder(SK_SIZE, true).less(a, b);
+    });
+    entries.resize(3);
+    EXPECT_EQ(paths(entries), paths(top));
+    EXPECT_EQ(96u, top[0].size);
+}
+
+TEST(TreeSort, InMemory)
+{
+    TreeOrder  order(SK_TIME);
+    TreeSorter sorter(order, 1 << 20);
+
+    vector<ManifestEntry> entries = scrambled(200);
+    for (const ManifestEntry& ent : entries)
+        sorter.add(ent);
+    EXPECT(sorter.finish());
+    EXPECT_EQ(0u, sorter.runs());
+
+    vector<ManifestEntry> sorted;
+    ManifestEntry         ent;
+    while (sorter.next(ent))
+        sorted.push_back(ent);
+
+    sort(entries.begin(), entries.end(), [&order](const ManifestEntry& a, const ManifestEntry& b) {
+        return order.less(a, b);
+    });
+    EXPECT_EQ(paths(entries), paths(sorted));
+}
+
+TEST(TreeSort, Spilled)
+{
+    // A budget of a few KB spills many runs, which merge back in order.
+    TreeOrder  order(SK_SIZE);
+    TreeSorter sorter(order, 4096);
+
+    vector<ManifestEntry> entries = scrambled(5000);
+    for (const ManifestEntry& ent : entries)
+        sorter.add(ent);
+    EXPECT(sorter.finish());
+    EXPECT(sorter.runs() > 10);
+
+    vector<ManifestEntry> sorted;
+    ManifestEntry         ent;
+    while (sorter.next(ent))
+        sorted.push_back(ent);
+
+    sort(entries.begin(), entries.end(), [&order](const ManifestEntry& a, const ManifestEntry& b) {
+        return order.less(a, b);
+    });
+    EXPECT_EQ(entries.size(), sorted.size());
+    EXPECT(paths(entries) == paths(sorted));
+
+    bool same = true;
+    for (size_t i = 0; i < sorted.size() && i < entries.size(); ++i)
+        same = same && sorted[i].size == entries[i].size && sorted[i].timeWrite == entries[i].timeWrite;
+    EXPECT(same);
+}
+
+TEST(TreeSort, SpillFails)
+{
+    // With nowhere to spill, every run stays in memory and no entry is lost.
+    const char* saved = getenv("TMPDIR");
+    string      old   = saved ? saved : "";
+    setenv("TMPDIR", (testDirectory() + "missing").c_str(), 1);
+
+    TreeOrder  order(SK_SIZE);
+    TreeSorter sorter(order, 4096);
+
+    vector<ManifestEntry> entries = scrambled(2000);
+    for (const ManifestEntry& ent : entries)
+        sorter.add(ent);
+    EXPECT(sorter.finish());
+    EXPECT_EQ(0u, sorter.runs());
+
+    vector<ManifestEntry> sorted;
+    ManifestEntry         ent;
+    while (sorter.next(ent))
+        sorted.push_back(ent);
+    EXPECT(!sorter.failed());
+
+    sort(entries.begin(), entries.end(), [&order](const ManifestEntry& a, const ManifestEntry& b) {
+        return order.less(a, b);
+    });
+    EXPECT(paths(entries) == paths(sorted));
+
+    if (saved)
+        setenv("TMPDIR", old.c_str(), 1);
+    else
+        unsetenv("TMPDIR");
+}
@@ -0,0 +1,358 @@
+/*
+-------------------------------------------------------------------------------
+
+    Copyright (c) Charles Carley.
+
+    Contributor(s): none yet.
+
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Test.h"
+#include "Walk.h"
+#include "WorkPool.h"
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+// root/
+//   .hidden
+//   a.txt     10 bytes
+//   b.cpp     20 bytes
+//   sub/
+//     c.txt   5 bytes
+//     deep/
+//       d.txt
+static string makeTree()
+{
+    string root = testDirectory();
+    testFile(root, ".hidden");
+    testFile(root, "a.txt", 10);
+    testFile(root, "b.cpp", 20);
+    testSubDirectory(root, "sub");
+    testFile(root, "sub/c.txt", 5);
+    testSubDirectory(root, "sub/deep");
+    testFile(root, "sub/deep/d.txt");
+    return root;
+}
+
+static Options walkOptions()
+{
+    Options opts    = {};
+    opts.recursive  = true;
+    opts.sortKey    = SK_NAME;
+    opts.hasSortKey = true;
+    opts.usageDepth = -1;
+    return opts;
+}
+
+static GlobSet patterns(const char* pattern)
+{
+    GlobSet globs;
+    globs.add(pattern);
+    globs.compile(false);
+    return globs;
+}
+
+static string describe(const WalkEntry& item)
+{
+    string str = *item.subDir;
+    str.append(item.ent.name, item.ent.nameLen);
+    str.push_back(' ');
+    str.append(to_string(item.depth));
+    return str;
+}
+
+static string walkAll(const string& root, const GlobSet& globs, const Options& opts)
+{
+    string        result;
+    DirectoryWalk walk;
+    walk.open(root, globs, opts);
+    for (const WalkEntry& item : walk)
+        result.append(describe(item)).push_back(',');
+    return result;
+}
+
+TEST(Walk, Order)
+{
+    string  root = makeTree();
+    Options opts = walkOptions();
+    GlobSet all  = patterns("*");
+
+    EXPECT_EQ(string("sub 0,a.txt 0,b.cpp 0,sub/deep 1,sub/c.txt 1,sub/deep/d.txt 2,"),
+              walkAll(root, all, opts));
+}
+
+TEST(Walk, NotRecursive)
+{
+    string  root = makeTree();
+    Options opts = walkOptions();
+    GlobSet all  = patterns("*");
+
+    opts.recursive = false;
+    EXPECT_EQ(string("sub 0,a.txt 0,b.cpp 0,"), walkAll(root, all, opts));
+}
+
+TEST(Walk, Hidden)
+{
+    string  root = makeTree();
+    Options opts = walkOptions();
+    GlobSet all  = patterns("*");
+
+    opts.recursive = false;
+    opts.all       = true;
+    EXPECT_EQ(string("sub 0,.hidden 0,a.txt 0,b.cpp 0,"), walkAll(root, all, opts));
+}
+
+TEST(Walk, LinkLoop)
+{
+    // A link back up the tree is listed once and not walked into.
+    string root = testDirectory();
+    testSubDirectory(root, "a");
+    testSubDirectory(root, "a/b");
+    testFile(root, "a/b/c.txt");
+    EXPECT(::symlink("..", (root + "a/b/loop").c_str()) == 0);
+
+    Options opts = walkOptions();
+    GlobSet all  = patterns("*");
+    EXPECT_EQ(string("a 0,a/b 1,a/b/loop 2,a/b/c.txt 2,"), walkAll(root, all, opts));
+}
+
+TEST(Walk, Patterns)
+{
+    // Patterns filter the entries, not the directories walked into.
+    string  root = makeTree();
+    Options opts = walkOptions();
+    GlobSet txt  = patterns("*.txt");
+
+    EXPECT_EQ(string("a.txt 0,sub/c.txt 1,sub/deep/d.txt 2,"), walkAll(root, txt, opts));
+}
+
+TEST(Walk, Sizes)
+{
+    string  root = makeTree();
+    Options opts = walkOptions();
+    GlobSet all  = patterns("*");
+
+    opts.sortKey   = SK_SIZE;
+    opts.fileOnly  = true;
+    opts.recursive = false;
+
+    vector<uint64_t> sizes;
+    DirectoryWalk    walk;
+    walk.open(root, all, opts);
+
+    WalkEntry item;
+    while (walk.next(item))
+        sizes.push_back(item.ent.size);
+
+    EXPECT_EQ(2u, sizes.size());
+    if (sizes.size() == 2)
+    {
+        EXPECT_EQ(10u, sizes[0]);
+        EXPECT_EQ(20u, sizes[1]);
+    }
+}
+
+TEST(Walk, SkipDirectory)
+{
+    string  root = makeTree();
+    Options opts = walkOptions();
+    GlobSet all  = patterns("*");
+
+    string        result;
+    DirectoryWalk walk;
+    walk.open(root, all, opts);
+
+    WalkEntry item;
+    while (walk.next(item))
+    {
+        result.append(describe(item)).push_back(',');
+        if (item.depth == 1)
+            walk.skipDirectory();
+    }
+    EXPECT_EQ(string("sub 0,a.txt 0,b.cpp 0,sub/deep 1,"), result);
+}
+
+TEST(Walk, MissingRoot)
+{
+    string  root = testDirectory() + "missing/";
+    Options opts = walkOptions();
+    GlobSet all  = patterns("*");
+
+    EXPECT_EQ(string(), walkAll(root, all, opts));
+}
+
+TEST(Walk, Exclude)
+{
+    string  root = makeTree();
+    Options opts = walkOptions();
+    GlobSet all  = patterns("*");
+
+    opts.exclude.add("deep");
+    opts.exclude.add("*.cpp");
+    opts.exclude.compile(false);
+    EXPECT_EQ(string("sub 0,a.txt 0,sub/c.txt 1,"), walkAll(root, all, opts));
+}
+
+TEST(Walk, MaxDepth)
+{
+    string  root = makeTree();
+    Options opts = walkOptions();
+    GlobSet all  = patterns("*");
+
+    opts.hasMaxDepth = true;
+    opts.maxDepth    = 1;
+    EXPECT_EQ(string("sub 0,a.txt 0,b.cpp 0,sub/deep 1,sub/c.txt 1,"), walkAll(root, all, opts));
+
+    opts.maxDepth = 0;
+    EXPECT_EQ(string("sub 0,a.txt 0,b.cpp 0,"), walkAll(root, all, opts));
+}
+
+TEST(Walk, IgnoreFile)
+{
+    string  root = makeTree();
+    Options opts = walkOptions();
+    GlobSet all  = patterns("*");
+
+    testFile(root, "sub/deep/e.txt");
+    testFile(root, "sub/deep/.ignore");
+    testFile(root, "sub/.ignore");
+
+    FILE* fp = fopen((root + ".ignore").c_str(), "w");
+    fputs("*.txt\n!d.txt\n", fp);
+    fclose(fp);
+    fp = fopen((root + "sub/.ignore").c_str(), "w");
+    fputs("!c.txt\n", fp);
+    fclose(fp);
+
+    opts.ignoreFile = ".ignore";
+    EXPECT_EQ(string("sub 0,b.cpp 0,sub/deep 1,sub/c.txt 1,sub/deep/d.txt 2,"), walkAll(root, all, opts));
+}
+
+static ListRoot listRoot(const string& path)
+{
+    ListRoot root;
+    root.path = path;
+    root.globs.add("*");
+    root.globs.compile(false);
+    return root;
+}
+
+TEST(Walk, Roots)
+{
+    // Roots read at the same time come out as if listed in turn.
+    string  root = makeTree();
+    Options opts = walkOptions();
+    opts.list    = true;
+
+    rootvec_t roots;
+    roots.push_back(listRoot(root));
+    roots.push_back(listRoot(root + "sub/"));
+    roots.push_back(listRoot(root + "missing/"));
+    roots.push_back(listRoot(root + "sub/deep/"));
+
+    string     expected;
+    ListReport serial = {};
+    {
+        Output out(expected);
+        for (const ListRoot& item : roots)
+            listAll(out, string(), item.path, item.globs, opts, &serial);
+    }
+
+    string     text, pooled;
+    ListReport together = {}, parallel = {};
+    {
+        Output out(text);
+        listRoots(out, roots, opts, &together, nullptr);
+    }
+    {
+        WorkPool pool(2);
+        Output   out(pooled);
+        listRoots(out, roots, opts, &parallel, &pool);
+    }
+
+    EXPECT_EQ(expected, text);
+    EXPECT_EQ(expected, pooled);
+    EXPECT_EQ(40u, together.totalBytes);
+    EXPECT_EQ(7u, together.totalFiles);
+    EXPECT_EQ(3u, together.totalDirectories);
+    EXPECT_EQ(serial.totalFiles, parallel.totalFiles);
+}
+
+class CountVisitor : public ListVisitor
+{
+public:
+    size_t     count;
+    size_t     limit;
+    WalkAction atDirectory;
+
+    CountVisitor(size_t stopAt, WalkAction action) :
+        count(0),
+        limit(stopAt),
+        atDirectory(action)
+    {
+    }
+
+    WalkAction visit(const WalkEntry& item) override
+    {
+        if (++count == limit)
+            return WA_STOP;
+        if ((item.ent.attrib & EA_DIRECTORY) != 0)
+            return atDirectory;
+        return WA_CONTINUE;
+    }
+};
+
+TEST(Walk, VisitAll)
+{
+    string  root = makeTree();
+    Options opts = walkOptions();
+    GlobSet all  = patterns("*");
+
+    CountVisitor visitor(0, WA_CONTINUE);
+    EXPECT(walkTree(root, all, opts, visitor));
+    EXPECT_EQ(6u, visitor.count);
+}
+
+TEST(Walk, VisitStop)
+{
+    string  root = makeTree();
+    Options opts = walkOptions();
+    GlobSet all  = patterns("*");
+
+    CountVisitor visitor(2, WA_CONTINUE);
+    EXPECT(!walkTree(root, all, opts, visitor));
+    EXPECT_EQ(2u, visitor.count);
+}
+
+TEST(Walk, VisitSkip)
+{
+    // The first entry is sub, and skipping there leaves the rest of
+    // the root unread, its sub directories included.
+    string  root = makeTree();
+    Options opts = walkOptions();
+    GlobSet all  = patterns("*");
+
+    CountVisitor visitor(0, WA_SKIP);
+    EXPECT(walkTree(root, all, opts, visitor));
+    EXPECT_EQ(1u, visitor.count);
+}